@@ -13,6 +13,9 @@ G_BEGIN_DECLS
 gboolean
 xb_builder_fixup_node(XbBuilderFixup *self, XbBuilderNode *bn, GError **error)
     G_GNUC_NON_NULL(1, 2);
+gboolean
+xb_builder_fixup_nodes(GPtrArray *fixups, XbBuilderNode *bn, GError **error)
+    G_GNUC_NON_NULL(1, 2);
 const gchar *
 xb_builder_fixup_get_id(XbBuilderFixup *self) G_GNUC_NON_NULL(1);
 gchar *
@@ -18,6 +18,7 @@ typedef struct {
 	gpointer user_data;
 	GDestroyNotify user_data_free;
 	gint max_depth;
+	GPtrArray *elements; /* (nullable) (element-type utf8) */
 } XbBuilderFixupPrivate;
 
 G_DEFINE_TYPE_WITH_PRIVATE(XbBuilderFixup, xb_builder_fixup, G_TYPE_OBJECT)
@@ -71,6 +72,176 @@ xb_builder_fixup_node(XbBuilderFixup *self, XbBuilderNode *bn, GError **error)
 	return TRUE;
 }
 
+typedef struct {
+	GPtrArray *fixups;    /* of XbBuilderFixup */
+	GHashTable *dispatch; /* element : GArray of index into @fixups */
+	gint max_depth;
+} XbBuilderFixupGroup;
+
+static gboolean
+xb_builder_fixup_group_node(XbBuilderFixupGroup *group,
+			    XbBuilderNode *bn,
+			    gint depth,
+			    GError **error)
+{
+	const gchar *element = xb_builder_node_get_element(bn);
+	GArray *idxs = NULL;
+	GPtrArray *children;
+	guint i = 0;
+	guint idx_next = 0;
+
+	/* only the fixups that asked for this element, in the order added */
+	if (element != NULL)
+		idxs = g_hash_table_lookup(group->dispatch, element);
+	while (idxs != NULL && i < idxs->len) {
+		guint idx = g_array_index(idxs, guint, i++);
+		XbBuilderFixup *self = g_ptr_array_index(group->fixups, idx);
+		XbBuilderFixupPrivate *priv = GET_PRIVATE(self);
+
+		if (idx < idx_next)
+			continue;
+		idx_next = idx + 1;
+		if (priv->max_depth >= 0 && depth > priv->max_depth)
+			continue;
+		if (!priv->func(self, bn, priv->user_data, error))
+			return FALSE;
+
+		/* renamed, so the later fixups for the new element apply */
+		if (xb_builder_node_get_element(bn) != element) {
+			element = xb_builder_node_get_element(bn);
+			idxs = NULL;
+			if (element != NULL)
+				idxs = g_hash_table_lookup(group->dispatch, element);
+			i = 0;
+		}
+	}
+
+	/* recurse */
+	if (group->max_depth >= 0 && depth >= group->max_depth)
+		return TRUE;
+	children = xb_builder_node_get_children(bn);
+	for (guint i = 0; i < children->len; i++) {
+		XbBuilderNode *bc = g_ptr_array_index(children, i);
+		if (!xb_builder_fixup_group_node(group, bc, depth + 1, error))
+			return FALSE;
+	}
+	return TRUE;
+}
+
+/* a single traversal only gives the same result as running the fixups one after
+ * another if no node has a descendant that is handled by an earlier fixup */
+static gboolean
+xb_builder_fixup_group_is_ordered(XbBuilderFixupGroup *group,
+				  XbBuilderNode *bn,
+				  gint depth,
+				  gint idx_ancestor)
+{
+	const gchar *element = xb_builder_node_get_element(bn);
+	GArray *idxs = NULL;
+	GPtrArray *children;
+
+	if (element != NULL)
+		idxs = g_hash_table_lookup(group->dispatch, element);
+	for (guint i = 0; idxs != NULL && i < idxs->len; i++) {
+		guint idx = g_array_index(idxs, guint, i);
+		XbBuilderFixup *self = g_ptr_array_index(group->fixups, idx);
+		XbBuilderFixupPrivate *priv = GET_PRIVATE(self);
+
+		if (priv->max_depth >= 0 && depth > priv->max_depth)
+			continue;
+		if ((gint)idx < idx_ancestor)
+			return FALSE;
+		idx_ancestor = MAX(idx_ancestor, (gint)idx);
+	}
+
+	/* recurse */
+	if (group->max_depth >= 0 && depth >= group->max_depth)
+		return TRUE;
+	children = xb_builder_node_get_children(bn);
+	for (guint i = 0; i < children->len; i++) {
+		XbBuilderNode *bc = g_ptr_array_index(children, i);
+		if (!xb_builder_fixup_group_is_ordered(group, bc, depth + 1, idx_ancestor))
+			return FALSE;
+	}
+	return TRUE;
+}
+
+/* runs fixups[start..end], which all have element filters, in one traversal */
+static gboolean
+xb_builder_fixup_group(GPtrArray *fixups, guint start, guint end, XbBuilderNode *bn, GError **error)
+{
+	g_autoptr(GPtrArray) fixups_group = g_ptr_array_new();
+	g_autoptr(GHashTable) dispatch =
+	    g_hash_table_new_full(g_str_hash, g_str_equal, NULL, (GDestroyNotify)g_array_unref);
+	XbBuilderFixupGroup group = {
+	    .fixups = fixups_group,
+	    .dispatch = dispatch,
+	    .max_depth = 0,
+	};
+
+	for (guint i = start; i < end; i++) {
+		XbBuilderFixup *self = g_ptr_array_index(fixups, i);
+		XbBuilderFixupPrivate *priv = GET_PRIVATE(self);
+		guint idx = fixups_group->len;
+
+		g_ptr_array_add(fixups_group, self);
+		if (priv->max_depth < 0 || group.max_depth < 0)
+			group.max_depth = -1;
+		else
+			group.max_depth = MAX(group.max_depth, priv->max_depth);
+		for (guint j = 0; j < priv->elements->len; j++) {
+			const gchar *element = g_ptr_array_index(priv->elements, j);
+			GArray *idxs = g_hash_table_lookup(dispatch, element);
+			if (idxs == NULL) {
+				idxs = g_array_new(FALSE, FALSE, sizeof(guint));
+				g_hash_table_insert(dispatch, (gpointer)element, idxs);
+			}
+			if (idxs->len == 0 || g_array_index(idxs, guint, idxs->len - 1) != idx)
+				g_array_append_val(idxs, idx);
+		}
+	}
+
+	/* fall back to one traversal for each fixup */
+	if (end - start > 1 && !xb_builder_fixup_group_is_ordered(&group, bn, 0, -1)) {
+		for (guint i = start; i < end; i++) {
+			if (!xb_builder_fixup_group(fixups, i, i + 1, bn, error))
+				return FALSE;
+		}
+		return TRUE;
+	}
+	return xb_builder_fixup_group_node(&group, bn, 0, error);
+}
+
+/* private */
+gboolean
+xb_builder_fixup_nodes(GPtrArray *fixups, XbBuilderNode *bn, GError **error)
+{
+	for (guint i = 0; i < fixups->len; i++) {
+		XbBuilderFixup *self = g_ptr_array_index(fixups, i);
+		XbBuilderFixupPrivate *priv = GET_PRIVATE(self);
+		guint end = i + 1;
+
+		/* the fixup has to see every node */
+		if (priv->elements == NULL) {
+			if (!xb_builder_fixup_node(self, bn, error))
+				return FALSE;
+			continue;
+		}
+
+		/* fuse with any filtered fixups added after this one */
+		while (end < fixups->len) {
+			XbBuilderFixup *fixup_tmp = g_ptr_array_index(fixups, end);
+			if (GET_PRIVATE(fixup_tmp)->elements == NULL)
+				break;
+			end++;
+		}
+		if (!xb_builder_fixup_group(fixups, i, end, bn, error))
+			return FALSE;
+		i = end - 1;
+	}
+	return TRUE;
+}
+
 /**
  * xb_builder_fixup_get_id:
  * @self: a #XbBuilderFixup
@@ -102,6 +273,10 @@ xb_builder_fixup_get_guid(XbBuilderFixup *self)
 	g_string_append(str, priv->id);
 	if (priv->max_depth != -1)
 		g_string_append_printf(str, "@%i", priv->max_depth);
+	for (guint i = 0; priv->elements != NULL && i < priv->elements->len; i++) {
+		const gchar *element = g_ptr_array_index(priv->elements, i);
+		g_string_append_printf(str, ":%s", element);
+	}
 	return g_string_free(g_steal_pointer(&str), FALSE);
 }
 
@@ -144,6 +319,35 @@ xb_builder_fixup_set_max_depth(XbBuilderFixup *self, gint max_depth)
 	priv->max_depth = max_depth;
 }
 
+/**
+ * xb_builder_fixup_add_element:
+ * @self: a #XbBuilderFixup
+ * @element: an element name, e.g. `description`
+ *
+ * Only runs the fixup on nodes with the element name. This can be called
+ * multiple times to match more than one element name.
+ *
+ * Fixups with an element filter that are added one after another are run
+ * during a single traversal of the tree, unless a node handled by one fixup has
+ * a descendant handled by an earlier fixup. The fixup should only modify the
+ * node it is given, or its children. If the node is renamed, the later fixups
+ * for the new element name are run on the node straight away.
+ *
+ * This has to be called before the fixup is added to the builder or source.
+ *
+ * Since: 0.3.30
+ **/
+void
+xb_builder_fixup_add_element(XbBuilderFixup *self, const gchar *element)
+{
+	XbBuilderFixupPrivate *priv = GET_PRIVATE(self);
+	g_return_if_fail(XB_IS_BUILDER_FIXUP(self));
+	g_return_if_fail(element != NULL);
+	if (priv->elements == NULL)
+		priv->elements = g_ptr_array_new_with_free_func(g_free);
+	g_ptr_array_add(priv->elements, g_strdup(element));
+}
+
 static void
 xb_builder_fixup_finalize(GObject *obj)
 {
@@ -152,6 +356,8 @@ xb_builder_fixup_finalize(GObject *obj)
 
 	if (priv->user_data_free != NULL)
 		priv->user_data_free(priv->user_data);
+	if (priv->elements != NULL)
+		g_ptr_array_unref(priv->elements);
 	g_free(priv->id);
 
 	G_OBJECT_CLASS(xb_builder_fixup_parent_class)->finalize(obj);
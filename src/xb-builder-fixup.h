@@ -40,5 +40,7 @@ gint
 xb_builder_fixup_get_max_depth(XbBuilderFixup *self) G_GNUC_NON_NULL(1);
 void
 xb_builder_fixup_set_max_depth(XbBuilderFixup *self, gint max_depth) G_GNUC_NON_NULL(1);
+void
+xb_builder_fixup_add_element(XbBuilderFixup *self, const gchar *element) G_GNUC_NON_NULL(1, 2);
 
 G_END_DECLS
@@ -19,6 +19,21 @@ typedef struct {
 	guint32 value_idx;
 } XbBuilderNodeAttr;
 
+typedef struct _XbBuilderStringArena XbBuilderStringArena;
+
+/* only set on the node passed to xb_builder_node_add_flag(), not its children */
+#define XB_BUILDER_NODE_FLAG_TOKENIZE_PENDING (1 << 30)
+
+XbBuilderStringArena *
+xb_builder_string_arena_new(void);
+XbBuilderStringArena *
+xb_builder_string_arena_ref(XbBuilderStringArena *arena) G_GNUC_NON_NULL(1);
+void
+xb_builder_string_arena_unref(XbBuilderStringArena *arena) G_GNUC_NON_NULL(1);
+XbBuilderNode *
+xb_builder_node_new_with_arena(XbBuilderStringArena *arena, const gchar *element)
+    G_GNUC_NON_NULL(1);
+
 GPtrArray *
 xb_builder_node_get_attrs(XbBuilderNode *self) G_GNUC_NON_NULL(1);
 guint32
@@ -47,5 +62,12 @@ void
 xb_builder_node_add_token_idx(XbBuilderNode *self, guint32 tail_idx) G_GNUC_NON_NULL(1);
 GArray *
 xb_builder_node_get_token_idxs(XbBuilderNode *self) G_GNUC_NON_NULL(1);
+GBytes *
+xb_builder_node_fragment_save(XbBuilderNode *self) G_GNUC_NON_NULL(1);
+XbBuilderNode *
+xb_builder_node_fragment_load(GBytes *blob, XbBuilderStringArena *arena, GError **error)
+    G_GNUC_NON_NULL(1, 2);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(XbBuilderStringArena, xb_builder_string_arena_unref)
 
 G_END_DECLS
@@ -17,6 +17,14 @@
 #include "xb-silo-private.h"
 #include "xb-string-private.h"
 
+/* strings for every node parsed from one source, freed in one go; the nodes
+ * themselves are still separate objects, and a string replaced by a fixup is
+ * not reclaimed until the last node using the arena is finalized */
+struct _XbBuilderStringArena {
+	gint refcount;
+	GStringChunk *strs;
+};
+
 typedef struct {
 	guint32 offset;
 	gint priority;
@@ -41,6 +49,8 @@ typedef struct {
 	GPtrArray *tokens;  /* (element-type utf8) (nullable) */
 	GArray *token_idxs; /* (element-type guint32) (nullable) */
 
+	/* if set, the element, text, tail and attributes are owned by this */
+	XbBuilderStringArena *arena; /* (nullable) */
 } XbBuilderNodePrivate;
 
 G_DEFINE_TYPE_WITH_PRIVATE(XbBuilderNode, xb_builder_node, G_TYPE_OBJECT)
@@ -48,6 +58,47 @@ G_DEFINE_TYPE_WITH_PRIVATE(XbBuilderNode, xb_builder_node, G_TYPE_OBJECT)
 
 static void
 xb_builder_node_attr_free(XbBuilderNodeAttr *attr);
+static void
+xb_builder_node_attr_free_arena(XbBuilderNodeAttr *attr);
+
+/* element and attribute strings are very repetitive, so share them */
+static gchar *
+xb_builder_node_strdup(XbBuilderNodePrivate *priv, const gchar *str)
+{
+	if (priv->arena == NULL)
+		return g_strdup(str);
+	if (str == NULL)
+		return NULL;
+	return g_string_chunk_insert_const(priv->arena->strs, str);
+}
+
+static gchar *
+xb_builder_node_strndup(XbBuilderNodePrivate *priv, const gchar *str, gsize len)
+{
+	if (priv->arena == NULL)
+		return g_strndup(str, len);
+	return g_string_chunk_insert_len(priv->arena->strs, str, len);
+}
+
+static gchar *
+xb_builder_node_string_free(XbBuilderNodePrivate *priv, GString *str)
+{
+	gchar *tmp;
+	if (priv->arena == NULL)
+		return g_string_free(str, FALSE);
+	tmp = g_string_chunk_insert_len(priv->arena->strs, str->str, str->len);
+	g_string_free(str, TRUE);
+	return tmp;
+}
+
+/* a GStringChunk cannot free a single string, so the old value of anything
+ * set on an arena node is only released with the arena */
+static void
+xb_builder_node_strfree(XbBuilderNodePrivate *priv, gchar *str)
+{
+	if (priv->arena == NULL)
+		g_free(str);
+}
 
 /**
  * xb_builder_node_has_flag:
@@ -77,11 +128,10 @@ xb_builder_node_has_flag(XbBuilderNode *self, XbBuilderNodeFlags flag)
  *
  * Since: 0.1.0
  **/
-void
-xb_builder_node_add_flag(XbBuilderNode *self, XbBuilderNodeFlags flag)
+static void
+xb_builder_node_add_flag_recursive(XbBuilderNode *self, XbBuilderNodeFlags flag)
 {
 	XbBuilderNodePrivate *priv = GET_PRIVATE(self);
-	g_return_if_fail(XB_IS_BUILDER_NODE(self));
 
 	if ((priv->flags & flag) != 0)
 		return;
@@ -93,10 +143,23 @@ xb_builder_node_add_flag(XbBuilderNode *self, XbBuilderNodeFlags flag)
 	priv->flags |= flag;
 	for (guint i = 0; priv->children != NULL && i < priv->children->len; i++) {
 		XbBuilderNode *c = g_ptr_array_index(priv->children, i);
-		xb_builder_node_add_flag(c, flag);
+		xb_builder_node_add_flag_recursive(c, flag);
 	}
 }
 
+void
+xb_builder_node_add_flag(XbBuilderNode *self, XbBuilderNodeFlags flag)
+{
+	XbBuilderNodePrivate *priv = GET_PRIVATE(self);
+	g_return_if_fail(XB_IS_BUILDER_NODE(self));
+
+	/* only this node is tokenized when compiled, as children just inherit
+	 * the flag so that any text set later is tokenized */
+	if ((flag & XB_BUILDER_NODE_FLAG_TOKENIZE_TEXT) > 0 && priv->tokens == NULL)
+		priv->flags |= XB_BUILDER_NODE_FLAG_TOKENIZE_PENDING;
+	xb_builder_node_add_flag_recursive(self, flag);
+}
+
 /**
  * xb_builder_node_get_element:
  * @self: a #XbBuilderNode
@@ -129,8 +192,8 @@ xb_builder_node_set_element(XbBuilderNode *self, const gchar *element)
 {
 	XbBuilderNodePrivate *priv = GET_PRIVATE(self);
 	g_return_if_fail(XB_IS_BUILDER_NODE(self));
-	g_free(priv->element);
-	priv->element = g_strdup(element);
+	xb_builder_node_strfree(priv, priv->element);
+	priv->element = xb_builder_node_strdup(priv, element);
 }
 
 /**
@@ -254,6 +317,7 @@ xb_builder_node_get_attrs(XbBuilderNode *self)
 static gchar *
 xb_builder_node_parse_literal_text(XbBuilderNode *self, const gchar *text, gssize text_len)
 {
+	XbBuilderNodePrivate *priv = GET_PRIVATE(self);
 	GString *tmp;
 	guint newline_count = 0;
 	g_auto(GStrv) split = NULL;
@@ -266,7 +330,7 @@ xb_builder_node_parse_literal_text(XbBuilderNode *self, const gchar *text, gssiz
 	/* we know this has been pre-fixed */
 	text_len_safe = text_len >= 0 ? (gsize)text_len : strlen(text);
 	if (xb_builder_node_has_flag(self, XB_BUILDER_NODE_FLAG_LITERAL_TEXT))
-		return g_strndup(text, text_len_safe);
+		return xb_builder_node_strndup(priv, text, text_len_safe);
 
 	/* all whitespace? */
 	if (xb_string_isspace(text, text_len_safe))
@@ -274,7 +338,7 @@ xb_builder_node_parse_literal_text(XbBuilderNode *self, const gchar *text, gssiz
 
 	/* all on one line, no trailing or leading whitespace */
 	if (g_strstr_len(text, text_len, "\n") == NULL)
-		return g_strndup(text, text_len_safe);
+		return xb_builder_node_strndup(priv, text, text_len_safe);
 
 	/* split the text into lines */
 	tmp = g_string_sized_new((gsize)text_len_safe + 1);
@@ -306,7 +370,7 @@ xb_builder_node_parse_literal_text(XbBuilderNode *self, const gchar *text, gssiz
 	}
 
 	/* success */
-	return g_string_free(tmp, FALSE);
+	return xb_builder_node_string_free(priv, tmp);
 }
 
 /**
@@ -328,6 +392,10 @@ xb_builder_node_parse_literal_text(XbBuilderNode *self, const gchar *text, gssiz
  * The transliteration locale (e.g. `en_GB`) is read from the `xml:lang`
  * node attribute if set.
  *
+ * Fixups can instead add %XB_BUILDER_NODE_FLAG_TOKENIZE_TEXT to the node, and
+ * the text of that node is then tokenized on all cores when the silo is
+ * compiled. The children only inherit the flag for any text set later.
+ *
  * Since: 0.3.1
  **/
 void
@@ -390,7 +458,7 @@ xb_builder_node_set_text(XbBuilderNode *self, const gchar *text, gssize text_len
 	g_return_if_fail(XB_IS_BUILDER_NODE(self));
 
 	/* old data */
-	g_free(priv->text);
+	xb_builder_node_strfree(priv, priv->text);
 	priv->text = xb_builder_node_parse_literal_text(self, text, text_len);
 	priv->flags |= XB_BUILDER_NODE_FLAG_HAS_TEXT;
 
@@ -421,7 +489,7 @@ xb_builder_node_set_tail(XbBuilderNode *self, const gchar *tail, gssize tail_len
 	g_return_if_fail(XB_IS_BUILDER_NODE(self));
 
 	/* old data */
-	g_free(priv->tail);
+	xb_builder_node_strfree(priv, priv->tail);
 	priv->tail = xb_builder_node_parse_literal_text(self, tail, tail_len);
 	priv->flags |= XB_BUILDER_NODE_FLAG_HAS_TAIL;
 }
@@ -445,25 +513,28 @@ xb_builder_node_set_attr(XbBuilderNode *self, const gchar *name, const gchar *va
 	g_return_if_fail(XB_IS_BUILDER_NODE(self));
 	g_return_if_fail(name != NULL);
 
-	if (priv->attrs == NULL)
-		priv->attrs =
-		    g_ptr_array_new_with_free_func((GDestroyNotify)xb_builder_node_attr_free);
+	if (priv->attrs == NULL) {
+		GDestroyNotify free_func = priv->arena != NULL
+					       ? (GDestroyNotify)xb_builder_node_attr_free_arena
+					       : (GDestroyNotify)xb_builder_node_attr_free;
+		priv->attrs = g_ptr_array_new_with_free_func(free_func);
+	}
 
 	/* check for existing name */
 	for (guint i = 0; i < priv->attrs->len; i++) {
 		a = g_ptr_array_index(priv->attrs, i);
 		if (g_strcmp0(a->name, name) == 0) {
-			g_free(a->value);
-			a->value = g_strdup(value);
+			xb_builder_node_strfree(priv, a->value);
+			a->value = xb_builder_node_strdup(priv, value);
 			return;
 		}
 	}
 
 	/* create new */
 	a = g_slice_new0(XbBuilderNodeAttr);
-	a->name = g_strdup(name);
+	a->name = xb_builder_node_strdup(priv, name);
 	a->name_idx = XB_SILO_UNSET;
-	a->value = g_strdup(value);
+	a->value = xb_builder_node_strdup(priv, value);
 	a->value_idx = XB_SILO_UNSET;
 	g_ptr_array_add(priv->attrs, a);
 }
@@ -934,6 +1005,12 @@ xb_builder_node_attr_free(XbBuilderNodeAttr *attr)
 	g_slice_free(XbBuilderNodeAttr, attr);
 }
 
+static void
+xb_builder_node_attr_free_arena(XbBuilderNodeAttr *attr)
+{
+	g_slice_free(XbBuilderNodeAttr, attr);
+}
+
 static void
 xb_builder_node_init(XbBuilderNode *self)
 {
@@ -968,13 +1045,14 @@ xb_builder_node_finalize(GObject *obj)
 {
 	XbBuilderNode *self = XB_BUILDER_NODE(obj);
 	XbBuilderNodePrivate *priv = GET_PRIVATE(self);
-	g_free(priv->element);
-	g_free(priv->text);
-	g_free(priv->tail);
+	xb_builder_node_strfree(priv, priv->element);
+	xb_builder_node_strfree(priv, priv->text);
+	xb_builder_node_strfree(priv, priv->tail);
 	g_clear_pointer(&priv->attrs, g_ptr_array_unref);
 	g_clear_pointer(&priv->children, g_ptr_array_unref);
 	g_clear_pointer(&priv->tokens, g_ptr_array_unref);
 	g_clear_pointer(&priv->token_idxs, g_array_unref);
+	g_clear_pointer(&priv->arena, xb_builder_string_arena_unref);
 	G_OBJECT_CLASS(xb_builder_node_parent_class)->finalize(obj);
 }
 
@@ -1006,6 +1084,47 @@ xb_builder_node_new(const gchar *element)
 	return self;
 }
 
+/* private */
+XbBuilderStringArena *
+xb_builder_string_arena_new(void)
+{
+	XbBuilderStringArena *arena = g_new0(XbBuilderStringArena, 1);
+	arena->refcount = 1;
+	arena->strs = g_string_chunk_new(64 * 1024);
+	return arena;
+}
+
+/* private */
+XbBuilderStringArena *
+xb_builder_string_arena_ref(XbBuilderStringArena *arena)
+{
+	g_atomic_int_inc(&arena->refcount);
+	return arena;
+}
+
+/* private */
+void
+xb_builder_string_arena_unref(XbBuilderStringArena *arena)
+{
+	if (!g_atomic_int_dec_and_test(&arena->refcount))
+		return;
+	g_string_chunk_free(arena->strs);
+	g_free(arena);
+}
+
+/* private: the node keeps the string @arena alive, and any strings set on the
+ * node are stored in it rather than being allocated and freed individually;
+ * only the strings are shared, the node is allocated and refcounted as usual */
+XbBuilderNode *
+xb_builder_node_new_with_arena(XbBuilderStringArena *arena, const gchar *element)
+{
+	XbBuilderNode *self = g_object_new(XB_TYPE_BUILDER_NODE, NULL);
+	XbBuilderNodePrivate *priv = GET_PRIVATE(self);
+	priv->arena = xb_builder_string_arena_ref(arena);
+	priv->element = xb_builder_node_strdup(priv, element);
+	return self;
+}
+
 /**
  * xb_builder_node_insert: (skip)
  * @parent: A XbBuilderNode, or %NULL
@@ -1253,3 +1372,328 @@ xb_builder_node_get_token_idxs(XbBuilderNode *self)
 	g_return_val_if_fail(self != NULL, NULL);
 	return priv->token_idxs;
 }
+
+/* fragments are only read by the same version, so use native byte order */
+#define XB_BUILDER_NODE_FRAGMENT_MAGIC	 0x52464258
+#define XB_BUILDER_NODE_FRAGMENT_VERSION 1
+
+/* the builder stops at 100 */
+#define XB_BUILDER_NODE_FRAGMENT_MAX_DEPTH 1024
+
+typedef struct __attribute__((packed)) {
+	guint32 magic;
+	guint32 version;
+	guint32 strtabsz;
+	guint32 nodetabsz;
+	guint32 child_count; /* of the root */
+	guint64 checksum;    /* of everything after the header */
+} XbBuilderNodeFragmentHeader;
+
+/* followed by the attribute name and value offsets, the token offsets, and then
+ * the children in order */
+typedef struct __attribute__((packed)) {
+	guint32 flags;
+	gint32 priority;
+	guint32 element;
+	guint32 text;
+	guint32 tail;
+	guint32 attr_count;
+	guint32 token_count;
+	guint32 child_count;
+} XbBuilderNodeFragmentRecord;
+
+typedef struct {
+	GByteArray *nodetab;
+	GByteArray *strtab;
+	GHashTable *strtab_hash; /* str : offset */
+} XbBuilderNodeFragmentWriter;
+
+static guint32
+xb_builder_node_fragment_add_str(XbBuilderNodeFragmentWriter *writer, const gchar *str)
+{
+	gpointer idx = NULL;
+	guint32 offset;
+
+	if (str == NULL)
+		return XB_SILO_UNSET;
+	if (g_hash_table_lookup_extended(writer->strtab_hash, str, NULL, &idx))
+		return GPOINTER_TO_UINT(idx);
+	offset = writer->strtab->len;
+	g_byte_array_append(writer->strtab, (const guint8 *)str, strlen(str) + 1);
+	g_hash_table_insert(writer->strtab_hash, (gpointer)str, GUINT_TO_POINTER(offset));
+	return offset;
+}
+
+static void
+xb_builder_node_fragment_write(XbBuilderNodeFragmentWriter *writer, XbBuilderNode *self)
+{
+	XbBuilderNodePrivate *priv = GET_PRIVATE(self);
+	XbBuilderNodeFragmentRecord rec = {
+	    .flags = priv->flags,
+	    .priority = priv->priority,
+	    .element = xb_builder_node_fragment_add_str(writer, priv->element),
+	    .text = xb_builder_node_fragment_add_str(writer, priv->text),
+	    .tail = xb_builder_node_fragment_add_str(writer, priv->tail),
+	    .attr_count = priv->attrs != NULL ? priv->attrs->len : 0,
+	    .token_count = priv->tokens != NULL ? priv->tokens->len : 0,
+	    .child_count = priv->children != NULL ? priv->children->len : 0,
+	};
+
+	g_byte_array_append(writer->nodetab, (const guint8 *)&rec, sizeof(rec));
+	for (guint i = 0; i < rec.attr_count; i++) {
+		XbBuilderNodeAttr *a = g_ptr_array_index(priv->attrs, i);
+		guint32 idxs[2] = {xb_builder_node_fragment_add_str(writer, a->name),
+				   xb_builder_node_fragment_add_str(writer, a->value)};
+		g_byte_array_append(writer->nodetab, (const guint8 *)idxs, sizeof(idxs));
+	}
+	for (guint i = 0; i < rec.token_count; i++) {
+		const gchar *token = g_ptr_array_index(priv->tokens, i);
+		guint32 idx = xb_builder_node_fragment_add_str(writer, token);
+		g_byte_array_append(writer->nodetab, (const guint8 *)&idx, sizeof(idx));
+	}
+	for (guint i = 0; i < rec.child_count; i++)
+		xb_builder_node_fragment_write(writer, g_ptr_array_index(priv->children, i));
+}
+
+/* private: saves everything below the node, including the nodes that are
+ * ignored, so that xb_builder_node_fragment_load() can restore it exactly */
+GBytes *
+xb_builder_node_fragment_save(XbBuilderNode *self)
+{
+	XbBuilderNodePrivate *priv = GET_PRIVATE(self);
+	XbSiloChecksum st;
+	XbBuilderNodeFragmentHeader hdr = {
+	    .magic = XB_BUILDER_NODE_FRAGMENT_MAGIC,
+	    .version = XB_BUILDER_NODE_FRAGMENT_VERSION,
+	};
+	g_autoptr(GByteArray) buf = NULL;
+	g_autoptr(GByteArray) nodetab = g_byte_array_new();
+	g_autoptr(GByteArray) strtab = g_byte_array_new();
+	g_autoptr(GHashTable) strtab_hash = g_hash_table_new(g_str_hash, g_str_equal);
+	XbBuilderNodeFragmentWriter writer = {
+	    .nodetab = nodetab,
+	    .strtab = strtab,
+	    .strtab_hash = strtab_hash,
+	};
+
+	g_return_val_if_fail(XB_IS_BUILDER_NODE(self), NULL);
+
+	for (guint i = 0; priv->children != NULL && i < priv->children->len; i++)
+		xb_builder_node_fragment_write(&writer, g_ptr_array_index(priv->children, i));
+	hdr.child_count = priv->children != NULL ? priv->children->len : 0;
+	hdr.strtabsz = strtab->len;
+	hdr.nodetabsz = nodetab->len;
+	xb_silo_checksum_init_data(&st);
+	if (strtab->len > 0)
+		xb_silo_checksum_update(&st, strtab->data, strtab->len);
+	if (nodetab->len > 0)
+		xb_silo_checksum_update(&st, nodetab->data, nodetab->len);
+	hdr.checksum = xb_silo_checksum_finish(&st);
+
+	buf = g_byte_array_sized_new(sizeof(hdr) + strtab->len + nodetab->len);
+	g_byte_array_append(buf, (const guint8 *)&hdr, sizeof(hdr));
+	g_byte_array_append(buf, strtab->data, strtab->len);
+	g_byte_array_append(buf, nodetab->data, nodetab->len);
+	return g_byte_array_free_to_bytes(g_steal_pointer(&buf));
+}
+
+typedef struct {
+	const guint8 *nodetab;
+	gsize nodetabsz;
+	gsize offset;
+	const gchar *strtab;
+	gsize strtabsz;
+	XbBuilderStringArena *arena;
+} XbBuilderNodeFragmentReader;
+
+static gboolean
+xb_builder_node_fragment_read(XbBuilderNodeFragmentReader *reader,
+			      gpointer data,
+			      gsize datasz,
+			      GError **error)
+{
+	if (datasz > reader->nodetabsz - reader->offset) {
+		g_set_error_literal(error,
+				    G_IO_ERROR,
+				    G_IO_ERROR_INVALID_DATA,
+				    "fragment nodetab is truncated");
+		return FALSE;
+	}
+	memcpy(data, reader->nodetab + reader->offset, datasz);
+	reader->offset += datasz;
+	return TRUE;
+}
+
+static gboolean
+xb_builder_node_fragment_get_str(XbBuilderNodeFragmentReader *reader,
+				 guint32 idx,
+				 gboolean allow_unset,
+				 const gchar **str,
+				 GError **error)
+{
+	if (idx == XB_SILO_UNSET && allow_unset) {
+		*str = NULL;
+		return TRUE;
+	}
+	if (idx >= reader->strtabsz) {
+		g_set_error(error,
+			    G_IO_ERROR,
+			    G_IO_ERROR_INVALID_DATA,
+			    "fragment string 0x%x is out of range",
+			    idx);
+		return FALSE;
+	}
+	*str = reader->strtab + idx;
+	return TRUE;
+}
+
+static gboolean
+xb_builder_node_fragment_read_str(XbBuilderNodeFragmentReader *reader,
+				  gboolean allow_unset,
+				  const gchar **str,
+				  GError **error)
+{
+	guint32 idx;
+	if (!xb_builder_node_fragment_read(reader, &idx, sizeof(idx), error))
+		return FALSE;
+	return xb_builder_node_fragment_get_str(reader, idx, allow_unset, str, error);
+}
+
+static gboolean
+xb_builder_node_fragment_read_children(XbBuilderNodeFragmentReader *reader,
+				       XbBuilderNode *parent,
+				       guint32 child_count,
+				       guint depth,
+				       GError **error)
+{
+	/* much deeper than the builder allows, so this is corrupt */
+	if (child_count > 0 && depth > XB_BUILDER_NODE_FRAGMENT_MAX_DEPTH) {
+		g_set_error_literal(error,
+				    G_IO_ERROR,
+				    G_IO_ERROR_INVALID_DATA,
+				    "fragment is nested too deeply");
+		return FALSE;
+	}
+	for (guint32 i = 0; i < child_count; i++) {
+		XbBuilderNodeFragmentRecord rec;
+		XbBuilderNodePrivate *priv;
+		const gchar *element = NULL;
+		const gchar *text = NULL;
+		const gchar *tail = NULL;
+		g_autoptr(XbBuilderNode) bn = NULL;
+
+		if (!xb_builder_node_fragment_read(reader, &rec, sizeof(rec), error))
+			return FALSE;
+		if (!xb_builder_node_fragment_get_str(reader, rec.element, TRUE, &element, error))
+			return FALSE;
+		if (!xb_builder_node_fragment_get_str(reader, rec.text, TRUE, &text, error))
+			return FALSE;
+		if (!xb_builder_node_fragment_get_str(reader, rec.tail, TRUE, &tail, error))
+			return FALSE;
+
+		/* set directly, as the text has already been processed */
+		bn = xb_builder_node_new_with_arena(reader->arena, element);
+		priv = GET_PRIVATE(bn);
+		priv->flags = rec.flags;
+		priv->priority = rec.priority;
+		/* not shared, as the text can be stripped in-place by a fixup */
+		if (text != NULL)
+			priv->text = xb_builder_node_strndup(priv, text, strlen(text));
+		if (tail != NULL)
+			priv->tail = xb_builder_node_strndup(priv, tail, strlen(tail));
+		for (guint32 j = 0; j < rec.attr_count; j++) {
+			const gchar *name = NULL;
+			const gchar *value = NULL;
+			if (!xb_builder_node_fragment_read_str(reader, FALSE, &name, error))
+				return FALSE;
+			if (!xb_builder_node_fragment_read_str(reader, TRUE, &value, error))
+				return FALSE;
+			xb_builder_node_set_attr(bn, name, value);
+		}
+		for (guint32 j = 0; j < rec.token_count; j++) {
+			const gchar *token = NULL;
+			if (!xb_builder_node_fragment_read_str(reader, FALSE, &token, error))
+				return FALSE;
+			xb_builder_node_add_token(bn, token);
+		}
+		xb_builder_node_add_child(parent, bn);
+		if (!xb_builder_node_fragment_read_children(reader,
+							    bn,
+							    rec.child_count,
+							    depth + 1,
+							    error))
+			return FALSE;
+	}
+	return TRUE;
+}
+
+/* private: returns a new root node, with any children using @arena */
+XbBuilderNode *
+xb_builder_node_fragment_load(GBytes *blob, XbBuilderStringArena *arena, GError **error)
+{
+	XbSiloChecksum st;
+	XbBuilderNodeFragmentHeader hdr;
+	gsize bufsz = 0;
+	const guint8 *buf;
+	g_autoptr(XbBuilderNode) root = NULL;
+	XbBuilderNodeFragmentReader reader = {
+	    .arena = arena,
+	};
+
+	g_return_val_if_fail(blob != NULL, NULL);
+	g_return_val_if_fail(error == NULL || *error == NULL, NULL);
+
+	/* check the header */
+	buf = g_bytes_get_data(blob, &bufsz);
+	if (bufsz < sizeof(hdr)) {
+		g_set_error_literal(error,
+				    G_IO_ERROR,
+				    G_IO_ERROR_INVALID_DATA,
+				    "fragment is too small");
+		return NULL;
+	}
+	memcpy(&hdr, buf, sizeof(hdr));
+	if (hdr.magic != XB_BUILDER_NODE_FRAGMENT_MAGIC ||
+	    hdr.version != XB_BUILDER_NODE_FRAGMENT_VERSION) {
+		g_set_error_literal(error,
+				    G_IO_ERROR,
+				    G_IO_ERROR_INVALID_DATA,
+				    "fragment has the wrong magic or version");
+		return NULL;
+	}
+	if ((guint64)hdr.strtabsz + hdr.nodetabsz != bufsz - sizeof(hdr) ||
+	    (hdr.strtabsz > 0 && buf[sizeof(hdr) + hdr.strtabsz - 1] != '\0')) {
+		g_set_error_literal(error,
+				    G_IO_ERROR,
+				    G_IO_ERROR_INVALID_DATA,
+				    "fragment is truncated");
+		return NULL;
+	}
+	xb_silo_checksum_init_data(&st);
+	if (bufsz > sizeof(hdr))
+		xb_silo_checksum_update(&st, buf + sizeof(hdr), bufsz - sizeof(hdr));
+	if (xb_silo_checksum_finish(&st) != hdr.checksum) {
+		g_set_error_literal(error,
+				    G_IO_ERROR,
+				    G_IO_ERROR_INVALID_DATA,
+				    "fragment checksum is invalid");
+		return NULL;
+	}
+
+	/* add the children to a new root */
+	reader.strtab = (const gchar *)buf + sizeof(hdr);
+	reader.strtabsz = hdr.strtabsz;
+	reader.nodetab = buf + sizeof(hdr) + hdr.strtabsz;
+	reader.nodetabsz = hdr.nodetabsz;
+	root = xb_builder_node_new(NULL);
+	if (!xb_builder_node_fragment_read_children(&reader, root, hdr.child_count, 0, error))
+		return NULL;
+	if (reader.offset != reader.nodetabsz) {
+		g_set_error_literal(error,
+				    G_IO_ERROR,
+				    G_IO_ERROR_INVALID_DATA,
+				    "fragment has trailing data");
+		return NULL;
+	}
+	return g_steal_pointer(&root);
+}
@@ -20,11 +20,19 @@ xb_builder_source_get_prefix(XbBuilderSource *self) G_GNUC_NON_NULL(1);
 GInputStream *
 xb_builder_source_get_istream(XbBuilderSource *self, GCancellable *cancellable, GError **error)
     G_GNUC_NON_NULL(1);
+gboolean
+xb_builder_source_open(XbBuilderSource *self,
+		       GBytes **bytes,
+		       GInputStream **istream,
+		       GCancellable *cancellable,
+		       GError **error) G_GNUC_NON_NULL(1, 2, 3);
 GFile *
 xb_builder_source_get_file(XbBuilderSource *self) G_GNUC_NON_NULL(1);
 gboolean
 xb_builder_source_fixup(XbBuilderSource *self, XbBuilderNode *bn, GError **error)
     G_GNUC_NON_NULL(1, 2);
+gboolean
+xb_builder_source_has_fixups(XbBuilderSource *self) G_GNUC_NON_NULL(1);
 XbBuilderSourceFlags
 xb_builder_source_get_flags(XbBuilderSource *self) G_GNUC_NON_NULL(1);
 
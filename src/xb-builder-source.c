@@ -14,6 +14,7 @@
 #include "xb-builder-fixup-private.h"
 #include "xb-builder-source-ctx-private.h"
 #include "xb-builder-source-private.h"
+#include "xb-silo-private.h"
 #ifdef HAVE_LZMA
 #include "xb-lzma-decompressor.h"
 #endif
@@ -22,6 +23,7 @@
 #endif
 typedef struct {
 	GInputStream *istream;
+	GBytes *bytes;
 	GFile *file;
 	GPtrArray *fixups;   /* of XbBuilderFixup */
 	GPtrArray *adapters; /* of XbBuilderSourceAdapter */
@@ -57,6 +59,32 @@ xb_builder_source_get_adapter_by_mime(XbBuilderSource *self, const gchar *conten
 	return NULL;
 }
 
+/* hashes the raw, possibly compressed, file */
+static gboolean
+xb_builder_source_fingerprint(GFile *file,
+			      guint64 *fingerprint,
+			      GCancellable *cancellable,
+			      GError **error)
+{
+	gsize bufsz = 64 * 1024;
+	gssize len;
+	XbSiloChecksum st;
+	g_autofree guint8 *buf = NULL;
+	g_autoptr(GInputStream) istream = NULL;
+
+	istream = G_INPUT_STREAM(g_file_read(file, cancellable, error));
+	if (istream == NULL)
+		return FALSE;
+	xb_silo_checksum_init_data(&st);
+	buf = g_malloc(bufsz);
+	while ((len = g_input_stream_read(istream, buf, bufsz, cancellable, error)) > 0)
+		xb_silo_checksum_update(&st, buf, len);
+	if (len < 0)
+		return FALSE;
+	*fingerprint = xb_silo_checksum_finish(&st);
+	return TRUE;
+}
+
 /**
  * xb_builder_source_load_file:
  * @self: a #XbBuilderSource
@@ -67,6 +95,12 @@ xb_builder_source_get_adapter_by_mime(XbBuilderSource *self, const gchar *conten
  *
  * Loads an optionally compressed XML file to build a #XbSilo.
  *
+ * A compiled `.xmlb` file can also be used, in which case the nodes are
+ * imported directly rather than being parsed again.
+ *
+ * If @flags includes %XB_BUILDER_SOURCE_FLAG_FINGERPRINT then the file is
+ * hashed every time it is loaded.
+ *
  * Returns: %TRUE for success
  *
  * Since: 0.1.1
@@ -105,12 +139,20 @@ xb_builder_source_load_file(XbBuilderSource *self,
 	/* add data to GUID */
 	fn = g_file_get_path(file);
 	guid = g_string_new(fn);
-	ctime = g_file_info_get_attribute_uint64(fileinfo, G_FILE_ATTRIBUTE_TIME_CHANGED);
-	if (ctime != 0)
-		g_string_append_printf(guid, ":ctime=%" G_GUINT64_FORMAT, ctime);
-	ctime_usec = g_file_info_get_attribute_uint32(fileinfo, G_FILE_ATTRIBUTE_TIME_CHANGED_USEC);
-	if (ctime_usec != 0)
-		g_string_append_printf(guid, ".%" G_GUINT32_FORMAT, ctime_usec);
+	if (flags & XB_BUILDER_SOURCE_FLAG_FINGERPRINT) {
+		guint64 fingerprint = 0;
+		if (!xb_builder_source_fingerprint(file, &fingerprint, cancellable, error))
+			return FALSE;
+		g_string_append_printf(guid, ":xxh64=%016" G_GINT64_MODIFIER "x", fingerprint);
+	} else {
+		ctime = g_file_info_get_attribute_uint64(fileinfo, G_FILE_ATTRIBUTE_TIME_CHANGED);
+		if (ctime != 0)
+			g_string_append_printf(guid, ":ctime=%" G_GUINT64_FORMAT, ctime);
+		ctime_usec =
+		    g_file_info_get_attribute_uint32(fileinfo, G_FILE_ATTRIBUTE_TIME_CHANGED_USEC);
+		if (ctime_usec != 0)
+			g_string_append_printf(guid, ".%" G_GUINT32_FORMAT, ctime_usec);
+	}
 	priv->guid = g_string_free(g_steal_pointer(&guid), FALSE);
 
 	/* check content type of file */
@@ -176,6 +218,8 @@ xb_builder_source_set_prefix(XbBuilderSource *self, const gchar *prefix)
  *
  * Loads XML data and begins to build a #XbSilo.
  *
+ * The data can also be a compiled silo, for instance from xb_silo_get_bytes().
+ *
  * Returns: %TRUE for success
  *
  * Since: 0.1.1
@@ -203,6 +247,7 @@ xb_builder_source_load_xml(XbBuilderSource *self,
 	priv->istream = g_memory_input_stream_new_from_bytes(blob);
 	if (priv->istream == NULL)
 		return FALSE;
+	priv->bytes = g_steal_pointer(&blob);
 
 	/* success */
 	priv->flags = flags;
@@ -218,6 +263,8 @@ xb_builder_source_load_xml(XbBuilderSource *self,
  *
  * Loads XML data and begins to build a #XbSilo.
  *
+ * The data can also be a compiled silo, for instance from xb_silo_get_bytes().
+ *
  * Returns: %TRUE for success
  *
  * Since: 0.1.2
@@ -245,6 +292,7 @@ xb_builder_source_load_bytes(XbBuilderSource *self,
 	priv->istream = g_memory_input_stream_new_from_bytes(bytes);
 	if (priv->istream == NULL)
 		return FALSE;
+	priv->bytes = g_bytes_ref(bytes);
 
 	/* success */
 	priv->flags = flags;
@@ -357,12 +405,15 @@ gboolean
 xb_builder_source_fixup(XbBuilderSource *self, XbBuilderNode *bn, GError **error)
 {
 	XbBuilderSourcePrivate *priv = GET_PRIVATE(self);
-	for (guint i = 0; i < priv->fixups->len; i++) {
-		XbBuilderFixup *fixup = g_ptr_array_index(priv->fixups, i);
-		if (!xb_builder_fixup_node(fixup, bn, error))
-			return FALSE;
-	}
-	return TRUE;
+	return xb_builder_fixup_nodes(priv->fixups, bn, error);
+}
+
+/* private */
+gboolean
+xb_builder_source_has_fixups(XbBuilderSource *self)
+{
+	XbBuilderSourcePrivate *priv = GET_PRIVATE(self);
+	return priv->fixups->len > 0;
 }
 
 static gboolean
@@ -434,8 +485,27 @@ xb_builder_source_remove_last_extension(gchar *basename)
 		*tmp = '\0';
 }
 
-GInputStream *
-xb_builder_source_get_istream(XbBuilderSource *self, GCancellable *cancellable, GError **error)
+/* returns %NULL if the file cannot be mapped, e.g. if it is not local */
+static GBytes *
+xb_builder_source_map_file(GFile *file)
+{
+	g_autofree gchar *fn = g_file_get_path(file);
+	g_autoptr(GMappedFile) mmap = NULL;
+
+	if (fn == NULL)
+		return NULL;
+	mmap = g_mapped_file_new(fn, FALSE, NULL);
+	if (mmap == NULL)
+		return NULL;
+	return g_mapped_file_get_bytes(mmap);
+}
+
+/* if @bytes is set then uncompressed local files are also mapped into it */
+static GInputStream *
+xb_builder_source_get_istream_full(XbBuilderSource *self,
+				   GBytes **bytes,
+				   GCancellable *cancellable,
+				   GError **error)
 {
 	XbBuilderSourcePrivate *priv = GET_PRIVATE(self);
 	g_autofree gchar *basename = NULL;
@@ -469,12 +539,24 @@ xb_builder_source_get_istream(XbBuilderSource *self, GCancellable *cancellable,
 		g_debug("detected content type of %s to be %s", basename, content_type);
 		if (content_type == NULL)
 			return NULL;
-		if (g_content_type_is_a(content_type, "application/xml"))
-			break;
 		/* Also accept the text/xml alias, just in case the user’s content-type database is
 		 * slightly broken (application/xml should normally be what’s used): */
-		if (g_strcmp0(content_type, "text/xml") == 0)
+		if (g_content_type_is_a(content_type, "application/xml") ||
+		    g_strcmp0(content_type, "text/xml") == 0) {
+			if (bytes != NULL && file != NULL)
+				*bytes = xb_builder_source_map_file(file);
 			break;
+		}
+
+		/* compiled silos are imported as nodes, so have to be in memory */
+		if (g_strcmp0(content_type, "application/x-xmlb") == 0) {
+			if (bytes != NULL) {
+				*bytes = xb_builder_source_ctx_get_bytes(ctx, cancellable, error);
+				if (*bytes == NULL)
+					return NULL;
+			}
+			break;
+		}
 
 		/* convert the stream */
 		item = xb_builder_source_get_adapter_by_mime(self, content_type);
@@ -504,6 +586,39 @@ xb_builder_source_get_istream(XbBuilderSource *self, GCancellable *cancellable,
 	return g_steal_pointer(&istream);
 }
 
+GInputStream *
+xb_builder_source_get_istream(XbBuilderSource *self, GCancellable *cancellable, GError **error)
+{
+	return xb_builder_source_get_istream_full(self, NULL, cancellable, error);
+}
+
+/* sets either @bytes when the whole document is already in memory or can be
+ * mapped, or @istream when it has to be read and converted */
+gboolean
+xb_builder_source_open(XbBuilderSource *self,
+		       GBytes **bytes,
+		       GInputStream **istream,
+		       GCancellable *cancellable,
+		       GError **error)
+{
+	XbBuilderSourcePrivate *priv = GET_PRIVATE(self);
+
+	g_return_val_if_fail(XB_IS_BUILDER_SOURCE(self), FALSE);
+	g_return_val_if_fail(bytes != NULL && *bytes == NULL, FALSE);
+	g_return_val_if_fail(istream != NULL && *istream == NULL, FALSE);
+
+	if (priv->bytes != NULL) {
+		*bytes = g_bytes_ref(priv->bytes);
+		return TRUE;
+	}
+	*istream = xb_builder_source_get_istream_full(self, bytes, cancellable, error);
+	if (*istream == NULL)
+		return FALSE;
+	if (*bytes != NULL)
+		g_clear_object(istream);
+	return TRUE;
+}
+
 GFile *
 xb_builder_source_get_file(XbBuilderSource *self)
 {
@@ -577,6 +692,8 @@ xb_builder_source_finalize(GObject *obj)
 
 	if (priv->istream != NULL)
 		g_object_unref(priv->istream);
+	if (priv->bytes != NULL)
+		g_bytes_unref(priv->bytes);
 	if (priv->info != NULL)
 		g_object_unref(priv->info);
 	if (priv->file != NULL)
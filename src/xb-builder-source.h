@@ -37,6 +37,8 @@ struct _XbBuilderSourceClass {
  * @XB_BUILDER_SOURCE_FLAG_WATCH_DIRECTORY:	Watch the directory containing the source file for
  *changes (for example, if watching all the sources in a directory — this allows the file monitors
  *to be shared)
+ * @XB_BUILDER_SOURCE_FLAG_FINGERPRINT:	Identify the file by a hash of the contents rather
+ *than the change time, so that touching or restoring a file does not cause a recompile
  *
  * The flags for converting to XML.
  **/
@@ -45,6 +47,7 @@ typedef enum {
 	XB_BUILDER_SOURCE_FLAG_LITERAL_TEXT = 1 << 0,	 /* Since: 0.1.0 */
 	XB_BUILDER_SOURCE_FLAG_WATCH_FILE = 1 << 1,	 /* Since: 0.1.0 */
 	XB_BUILDER_SOURCE_FLAG_WATCH_DIRECTORY = 1 << 2, /* Since: 0.2.0 */
+	XB_BUILDER_SOURCE_FLAG_FINGERPRINT = 1 << 3,	 /* Since: 0.3.30 */
 	/*< private >*/
 	XB_BUILDER_SOURCE_FLAG_LAST
 } XbBuilderSourceFlags;
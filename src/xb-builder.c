@@ -15,7 +15,10 @@
 #include "xb-builder-node-private.h"
 #include "xb-builder-source-private.h"
 #include "xb-builder.h"
+#include "xb-node-private.h"
+#include "xb-node-silo.h"
 #include "xb-opcode-private.h"
+#include "xb-sax-private.h"
 #include "xb-silo-private.h"
 #include "xb-string-private.h"
 #include "xb-version.h"
@@ -29,6 +32,8 @@ typedef struct {
 	GPtrArray *locales; /* of str */
 	XbSiloProfileFlags profile_flags;
 	GString *guid;
+	guint max_threads;
+	GFile *fragment_cache; /* nullable */
 } XbBuilderPrivate;
 
 G_DEFINE_TYPE_WITH_PRIVATE(XbBuilder, xb_builder, G_TYPE_OBJECT)
@@ -36,8 +41,9 @@ G_DEFINE_TYPE_WITH_PRIVATE(XbBuilder, xb_builder, G_TYPE_OBJECT)
 
 typedef struct {
 	XbSilo *silo;
-	XbBuilderNode *root;	/* transfer full */
-	XbBuilderNode *current; /* transfer none */
+	XbBuilderNode *root;	     /* transfer full */
+	XbBuilderNode *current;	     /* transfer none */
+	XbBuilderStringArena *arena; /* transfer none */
 	XbBuilderCompileFlags compile_flags;
 	XbBuilderSourceFlags source_flags;
 	GHashTable *strtab_hash;
@@ -45,9 +51,24 @@ typedef struct {
 	GPtrArray *locales;
 	gboolean elem_closed;
 	guint depth;
+	gboolean lang_filter; /* SINGLE_LANG with no fixups to see the losers */
+	GPtrArray *lang_best; /* of (nullable) GHashTable by depth, element : prio */
+	guint ignore_depth;
+	GFile *fragment_cache; /* transfer none, nullable */
 	GError *error;
 } XbBuilderCompileHelper;
 
+typedef struct {
+	XbBuilderSource *source;     /* transfer full */
+	XbBuilderNode *root_tmp;     /* transfer full */
+	XbBuilderStringArena *arena; /* transfer full */
+	GCancellable *cancellable;   /* transfer none */
+	GTimer *timer;
+	gchar *fragment_basename; /* nullable */
+	gboolean fragment_loaded;
+	GError *error;
+} XbBuilderCompileJob;
+
 static guint32
 xb_builder_compile_add_to_strtab(XbBuilderCompileHelper *helper, const gchar *str)
 {
@@ -85,38 +106,143 @@ xb_builder_compile_add_to_strtab(XbBuilderCompileHelper *helper, const gchar *st
 	return idx;
 }
 
+/* the parser callbacks below are shared by xb_builder_compile() and
+ * xb_builder_compile_to_file(), which only differ in where the nodes go */
 static gint
-xb_builder_get_locale_priority(XbBuilderCompileHelper *helper, const gchar *locale)
+xb_builder_get_locale_priority(GPtrArray *locales, const gchar *locale)
 {
-	for (guint i = 0; i < helper->locales->len; i++) {
-		const gchar *locale_tmp = g_ptr_array_index(helper->locales, i);
+	for (guint i = 0; i < locales->len; i++) {
+		const gchar *locale_tmp = g_ptr_array_index(locales, i);
 		if (g_strcmp0(locale_tmp, locale) == 0)
-			return helper->locales->len - i;
+			return locales->len - i;
 	}
 	return -1;
 }
 
+static const gchar *
+xb_builder_get_xml_lang(const gchar **attr_names, const gchar **attr_values)
+{
+	for (guint i = 0; attr_names[i] != NULL; i++) {
+		if (g_strcmp0(attr_names[i], "xml:lang") == 0)
+			return attr_values[i];
+	}
+	return NULL;
+}
+
+/* check recursion depth to prevent stack exhaustion */
+static gboolean
+xb_builder_check_depth(guint depth, GError **error)
+{
+	if (depth >= XB_BUILDER_MAX_DEPTH) {
+		g_set_error(error,
+			    G_IO_ERROR,
+			    G_IO_ERROR_INVALID_DATA,
+			    "nesting deeper than %u levels not supported",
+			    (guint)XB_BUILDER_MAX_DEPTH);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/* the text may be split, e.g. by a comment */
+static void
+xb_builder_node_append_text(XbBuilderNode *bn, const gchar *text, gsize text_len)
+{
+	if (xb_builder_node_has_flag(bn, XB_BUILDER_NODE_FLAG_HAS_TEXT)) {
+		g_autoptr(GString) str = g_string_new(xb_builder_node_get_text(bn));
+		g_string_append_len(str, text, text_len);
+		xb_builder_node_set_text(bn, str->str, str->len);
+	} else {
+		xb_builder_node_set_text(bn, text, text_len);
+	}
+}
+
+/* with SINGLE_LANG only the best translation of each element is kept, so
+ * discard the others as soon as a better sibling has been seen rather than
+ * building nodes that xb_builder_xml_lang_prio_cb() would unlink anyway */
+static gboolean
+xb_builder_compile_lang_filter(XbBuilderCompileHelper *helper,
+			       XbBuilderNode *bn,
+			       gboolean has_xml_lang)
+{
+	const gchar *element = xb_builder_node_get_element(bn);
+	gint prio = xb_builder_node_get_priority(bn);
+	gint prio_best = G_MININT;
+	gpointer val = NULL;
+	GPtrArray *children = xb_builder_node_get_children(helper->current);
+	GHashTable *lang_best;
+
+	/* not in the translated set for this element, or the first of them */
+	if (helper->lang_best->len <= helper->depth)
+		g_ptr_array_set_size(helper->lang_best, helper->depth + 1);
+	lang_best = g_ptr_array_index(helper->lang_best, helper->depth);
+	if (lang_best != NULL && g_hash_table_lookup_extended(lang_best, element, NULL, &val)) {
+		prio_best = GPOINTER_TO_INT(val);
+	} else {
+		if (!has_xml_lang)
+			return FALSE;
+		for (guint i = 0; i < children->len; i++) {
+			XbBuilderNode *bc = g_ptr_array_index(children, i);
+			if (g_strcmp0(xb_builder_node_get_element(bc), element) == 0)
+				prio_best = MAX(prio_best, xb_builder_node_get_priority(bc));
+		}
+		if (lang_best == NULL) {
+			lang_best = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+			helper->lang_best->pdata[helper->depth] = lang_best;
+		}
+	}
+
+	/* a better translation has already been seen */
+	if (prio_best != G_MININT && prio < prio_best)
+		return TRUE;
+
+	/* remove the earlier, worse translations */
+	if (prio_best != G_MININT && prio > prio_best) {
+		g_autoptr(GPtrArray) losers = g_ptr_array_new();
+		for (guint i = 0; i < children->len; i++) {
+			XbBuilderNode *bc = g_ptr_array_index(children, i);
+			if (g_strcmp0(xb_builder_node_get_element(bc), element) == 0 &&
+			    xb_builder_node_get_priority(bc) < prio)
+				g_ptr_array_add(losers, bc);
+		}
+		for (guint i = 0; i < losers->len; i++)
+			xb_builder_node_unlink(g_ptr_array_index(losers, i));
+	}
+	g_hash_table_insert(lang_best,
+			    g_strdup(element),
+			    GINT_TO_POINTER(MAX(prio, prio_best)));
+	return FALSE;
+}
+
+static void
+xb_builder_compile_lang_best_free(GHashTable *lang_best)
+{
+	if (lang_best != NULL)
+		g_hash_table_unref(lang_best);
+}
+
 static void
-xb_builder_compile_start_element_cb(GMarkupParseContext *context,
-				    const gchar *element_name,
+xb_builder_compile_start_element_cb(const gchar *element_name,
 				    const gchar **attr_names,
 				    const gchar **attr_values,
 				    gpointer user_data,
 				    GError **error)
 {
 	XbBuilderCompileHelper *helper = (XbBuilderCompileHelper *)user_data;
-	g_autoptr(XbBuilderNode) bn = xb_builder_node_new(element_name);
+	g_autoptr(XbBuilderNode) bn = NULL;
+	const gchar *xml_lang = NULL;
 
-	/* check recursion depth to prevent stack exhaustion */
-	if (helper->depth >= XB_BUILDER_MAX_DEPTH) {
-		g_set_error(error,
-			    G_IO_ERROR,
-			    G_IO_ERROR_INVALID_DATA,
-			    "nesting deeper than %u levels not supported",
-			    (guint)XB_BUILDER_MAX_DEPTH);
+	if (!xb_builder_check_depth(helper->depth, error))
 		return;
-	}
 	helper->depth++;
+	helper->elem_closed = FALSE;
+
+	/* inside a discarded translation */
+	if (helper->ignore_depth > 0) {
+		helper->ignore_depth++;
+		return;
+	}
+	bn = xb_builder_node_new_with_arena(helper->arena, element_name);
 
 	/* parent node is being ignored */
 	if (helper->current != NULL &&
@@ -126,26 +252,38 @@ xb_builder_compile_start_element_cb(GMarkupParseContext *context,
 	/* check if we should ignore the locale */
 	if (!xb_builder_node_has_flag(bn, XB_BUILDER_NODE_FLAG_IGNORE) &&
 	    helper->compile_flags & XB_BUILDER_COMPILE_FLAG_NATIVE_LANGS) {
-		const gchar *xml_lang = NULL;
-		for (guint i = 0; attr_names[i] != NULL; i++) {
-			if (g_strcmp0(attr_names[i], "xml:lang") == 0) {
-				xml_lang = attr_values[i];
-				break;
-			}
-		}
+		xml_lang = xb_builder_get_xml_lang(attr_names, attr_values);
 		if (xml_lang == NULL) {
 			if (helper->current != NULL) {
 				gint prio = xb_builder_node_get_priority(helper->current);
 				xb_builder_node_set_priority(bn, prio);
 			}
 		} else {
-			gint prio = xb_builder_get_locale_priority(helper, xml_lang);
+			gint prio = xb_builder_get_locale_priority(helper->locales, xml_lang);
 			if (prio < 0)
 				xb_builder_node_add_flag(bn, XB_BUILDER_NODE_FLAG_IGNORE);
 			xb_builder_node_set_priority(bn, prio);
 		}
 	}
 
+	/* top-level elements are compared across sources, so leave those */
+	if (helper->lang_filter && helper->depth > 1) {
+		XbBuilderNode *bc = xb_builder_node_get_last_child(helper->current);
+
+		/* the tail of the previous sibling is complete now */
+		if (bc != NULL && xb_builder_node_has_flag(bc, XB_BUILDER_NODE_FLAG_IGNORE))
+			xb_builder_node_unlink(bc);
+
+		/* only add a placeholder to get any tail */
+		if (xb_builder_node_has_flag(bn, XB_BUILDER_NODE_FLAG_IGNORE) ||
+		    xb_builder_compile_lang_filter(helper, bn, xml_lang != NULL)) {
+			xb_builder_node_add_flag(bn, XB_BUILDER_NODE_FLAG_IGNORE);
+			xb_builder_node_add_child(helper->current, bn);
+			helper->ignore_depth = 1;
+			return;
+		}
+	}
+
 	/* add attributes */
 	if (!xb_builder_node_has_flag(bn, XB_BUILDER_NODE_FLAG_IGNORE)) {
 		for (guint i = 0; attr_names[i] != NULL; i++)
@@ -155,18 +293,22 @@ xb_builder_compile_start_element_cb(GMarkupParseContext *context,
 	/* add to tree */
 	xb_builder_node_add_child(helper->current, bn);
 	helper->current = bn;
-
-	helper->elem_closed = FALSE;
 }
 
 static void
-xb_builder_compile_end_element_cb(GMarkupParseContext *context,
-				  const gchar *element_name,
-				  gpointer user_data,
-				  GError **error)
+xb_builder_compile_end_element_cb(const gchar *element_name, gpointer user_data, GError **error)
 {
 	XbBuilderCompileHelper *helper = (XbBuilderCompileHelper *)user_data;
-	g_autoptr(XbBuilderNode) parent = xb_builder_node_get_parent(helper->current);
+	g_autoptr(XbBuilderNode) parent = NULL;
+
+	/* inside a discarded translation */
+	if (helper->ignore_depth > 0) {
+		helper->ignore_depth--;
+		helper->depth--;
+		helper->elem_closed = TRUE;
+		return;
+	}
+	parent = xb_builder_node_get_parent(helper->current);
 	if (parent == NULL) {
 		g_set_error_literal(error,
 				    G_IO_ERROR,
@@ -174,23 +316,23 @@ xb_builder_compile_end_element_cb(GMarkupParseContext *context,
 				    "Mismatched XML; no parent");
 		return;
 	}
+	if (helper->lang_best != NULL && helper->depth + 1 < helper->lang_best->len)
+		g_ptr_array_set_size(helper->lang_best, helper->depth + 1);
 	helper->current = parent;
 	helper->depth--;
 	helper->elem_closed = TRUE;
 }
 
 static void
-xb_builder_compile_text_cb(GMarkupParseContext *context,
-			   const gchar *text,
-			   gsize text_len,
-			   gpointer user_data,
-			   GError **error)
+xb_builder_compile_text_cb(const gchar *text, gsize text_len, gpointer user_data, GError **error)
 {
 	XbBuilderCompileHelper *helper = (XbBuilderCompileHelper *)user_data;
 	XbBuilderNode *bn = helper->current;
 	XbBuilderNode *bc = xb_builder_node_get_last_child(bn);
 
 	/* unimportant */
+	if (helper->ignore_depth > 0)
+		return;
 	if (xb_builder_node_has_flag(bn, XB_BUILDER_NODE_FLAG_IGNORE))
 		return;
 
@@ -200,13 +342,7 @@ xb_builder_compile_text_cb(GMarkupParseContext *context,
 
 	/* text or tail */
 	if (!helper->elem_closed) {
-		if (xb_builder_node_has_flag(bn, XB_BUILDER_NODE_FLAG_HAS_TEXT)) {
-			g_autoptr(GString) str = g_string_new(xb_builder_node_get_text(bn));
-			g_string_append_len(str, text, text_len);
-			xb_builder_node_set_text(bn, str->str, str->len);
-		} else {
-			xb_builder_node_set_text(bn, text, text_len);
-		}
+		xb_builder_node_append_text(bn, text, text_len);
 		return;
 	}
 
@@ -244,51 +380,167 @@ xb_builder_import_source(XbBuilder *self, XbBuilderSource *source)
 	g_ptr_array_add(priv->sources, g_object_ref(source));
 }
 
+/* compiled silos are walked in document order as if they had been parsed */
 static gboolean
-xb_builder_compile_source(XbBuilderCompileHelper *helper,
-			  XbBuilderSource *source,
-			  XbBuilderNode *root,
-			  GCancellable *cancellable,
-			  GError **error)
+xb_builder_parse_silo(GBytes *bytes, const XbSaxParser *parser, gpointer user_data, GError **error)
+{
+	guint32 strtab;
+	g_autoptr(GArray) stack = g_array_new(FALSE, FALSE, sizeof(guint32));
+	g_autoptr(GPtrArray) attr_names = g_ptr_array_new();
+	g_autoptr(GPtrArray) attr_values = g_ptr_array_new();
+	g_autoptr(XbSilo) silo = xb_silo_new();
+
+	if (!xb_silo_load_from_bytes(silo, bytes, XB_SILO_LOAD_FLAG_COMPRESSED, error))
+		return FALSE;
+	strtab = xb_silo_get_strtab(silo);
+	for (guint32 off = sizeof(XbSiloHeader); off < strtab;) {
+		XbSiloNode *sn = xb_silo_get_node(silo, off, error);
+		g_autoptr(GError) error_local = NULL;
+
+		if (sn == NULL)
+			return FALSE;
+		if (xb_silo_node_has_flag(sn, XB_SILO_NODE_FLAG_IS_ELEMENT)) {
+			const gchar *element_name = xb_silo_get_node_element(silo, sn, error);
+
+			if (element_name == NULL)
+				return FALSE;
+			g_ptr_array_set_size(attr_names, 0);
+			g_ptr_array_set_size(attr_values, 0);
+			for (guint8 i = 0; i < sn->attr_count; i++) {
+				XbSiloNodeAttr *a = xb_silo_node_get_attr(sn, i);
+				const gchar *attr_name;
+				const gchar *attr_value = "";
+
+				attr_name = xb_silo_from_strtab(silo, a->attr_name, error);
+				if (attr_name == NULL)
+					return FALSE;
+				if (a->attr_value != XB_SILO_UNSET) {
+					attr_value = xb_silo_from_strtab(silo, a->attr_value, error);
+					if (attr_value == NULL)
+						return FALSE;
+				}
+				g_ptr_array_add(attr_names, (gpointer)attr_name);
+				g_ptr_array_add(attr_values, (gpointer)attr_value);
+			}
+			g_ptr_array_add(attr_names, NULL);
+			g_ptr_array_add(attr_values, NULL);
+			parser->start_element(element_name,
+					      (const gchar **)attr_names->pdata,
+					      (const gchar **)attr_values->pdata,
+					      user_data,
+					      &error_local);
+			if (error_local == NULL && sn->text != XB_SILO_UNSET) {
+				const gchar *text = xb_silo_from_strtab(silo, sn->text, error);
+				if (text == NULL)
+					return FALSE;
+				parser->text(text, strlen(text), user_data, &error_local);
+			}
+			g_array_append_val(stack, off);
+		} else {
+			XbSiloNode *sp;
+			const gchar *element_name;
+
+			/* the sentinel closes the last open element */
+			if (stack->len == 0) {
+				g_set_error_literal(error,
+						    G_IO_ERROR,
+						    G_IO_ERROR_INVALID_DATA,
+						    "Mismatched silo; no parent");
+				return FALSE;
+			}
+			sp = xb_silo_get_node(silo,
+					      g_array_index(stack, guint32, stack->len - 1),
+					      error);
+			if (sp == NULL)
+				return FALSE;
+			g_array_set_size(stack, stack->len - 1);
+			element_name = xb_silo_get_node_element(silo, sp, error);
+			if (element_name == NULL)
+				return FALSE;
+			parser->end_element(element_name, user_data, &error_local);
+			if (error_local == NULL && sp->tail != XB_SILO_UNSET) {
+				const gchar *tail = xb_silo_from_strtab(silo, sp->tail, error);
+				if (tail == NULL)
+					return FALSE;
+				parser->text(tail, strlen(tail), user_data, &error_local);
+			}
+		}
+		if (error_local != NULL) {
+			g_propagate_error(error, g_steal_pointer(&error_local));
+			return FALSE;
+		}
+		off += xb_silo_node_get_size(sn);
+	}
+	return TRUE;
+}
+
+/* mapped and in-memory sources are parsed where they are, otherwise decompress */
+static gboolean
+xb_builder_parse_source(XbBuilderSource *source,
+			const XbSaxParser *parser,
+			gpointer user_data,
+			GCancellable *cancellable,
+			GError **error)
 {
-	GPtrArray *children;
-	XbBuilderNode *info;
 	gsize chunk_size = 32 * 1024;
 	gssize len;
 	g_autofree gchar *data = NULL;
-	g_autofree gchar *guid = xb_builder_source_get_guid(source);
-	g_autoptr(GPtrArray) children_copy = NULL;
+	g_autoptr(GBytes) bytes = NULL;
 	g_autoptr(GInputStream) istream = NULL;
-	g_autoptr(GMarkupParseContext) ctx = NULL;
-	g_autoptr(GTimer) timer = xb_silo_start_profile(helper->silo);
-	g_autoptr(XbBuilderNode) root_tmp = xb_builder_node_new(NULL);
-	const GMarkupParser parser = {xb_builder_compile_start_element_cb,
-				      xb_builder_compile_end_element_cb,
-				      xb_builder_compile_text_cb,
-				      NULL,
-				      NULL};
-
-	/* add the source to a fake root in case it fails during processing */
-	helper->current = root_tmp;
-	helper->source_flags = xb_builder_source_get_flags(source);
+	g_autoptr(XbSaxContext) ctx = NULL;
 
-	/* decompress */
-	istream = xb_builder_source_get_istream(source, cancellable, error);
-	if (istream == NULL)
+	if (!xb_builder_source_open(source, &bytes, &istream, cancellable, error))
 		return FALSE;
-
-	/* parse */
-	ctx = g_markup_parse_context_new(&parser,
-					 G_MARKUP_PREFIX_ERROR_POSITION |
-					     G_MARKUP_TREAT_CDATA_AS_TEXT,
-					 helper,
-					 NULL);
+	if (bytes != NULL) {
+		gsize sz = 0;
+		guint32 magic = 0;
+		const gchar *buf = g_bytes_get_data(bytes, &sz);
+		if (g_cancellable_set_error_if_cancelled(cancellable, error))
+			return FALSE;
+		if (sz >= sizeof(magic))
+			memcpy(&magic, buf, sizeof(magic));
+		if (magic == XB_SILO_MAGIC_BYTES || magic == XB_SILO_BLOCKS_MAGIC)
+			return xb_builder_parse_silo(bytes, parser, user_data, error);
+		ctx = xb_sax_context_new(parser, user_data);
+		return xb_sax_context_parse_borrowed(ctx, buf != NULL ? buf : "", sz, error);
+	}
+	ctx = xb_sax_context_new(parser, user_data);
 	data = g_malloc(chunk_size);
 	while ((len = g_input_stream_read(istream, data, chunk_size, cancellable, error)) > 0) {
-		if (!g_markup_parse_context_parse(ctx, data, len, error))
+		if (!xb_sax_context_parse(ctx, data, len, error))
 			return FALSE;
 	}
-	if (len < 0)
+	return len == 0;
+}
+
+static gboolean
+xb_builder_compile_source(XbBuilderCompileHelper *helper,
+			  XbBuilderSource *source,
+			  XbBuilderNode *root_tmp,
+			  GCancellable *cancellable,
+			  GError **error)
+{
+	g_autoptr(GPtrArray) lang_best = NULL;
+	const XbSaxParser parser = {xb_builder_compile_start_element_cb,
+				    xb_builder_compile_end_element_cb,
+				    xb_builder_compile_text_cb};
+
+	/* add the source to a fake root in case it fails during processing */
+	helper->current = root_tmp;
+	helper->source_flags = xb_builder_source_get_flags(source);
+	helper->ignore_depth = 0;
+
+	/* fixups have to see every translation */
+	if (helper->lang_filter && xb_builder_source_has_fixups(source))
+		helper->lang_filter = FALSE;
+	if (helper->lang_filter) {
+		lang_best = g_ptr_array_new_with_free_func(
+		    (GDestroyNotify)xb_builder_compile_lang_best_free);
+		helper->lang_best = lang_best;
+	}
+
+	/* parse */
+	if (!xb_builder_parse_source(source, &parser, helper, cancellable, error))
 		return FALSE;
 
 	/* more opening than closing */
@@ -310,6 +562,16 @@ xb_builder_compile_source(XbBuilderCompileHelper *helper,
 		return FALSE;
 	}
 
+	/* success */
+	return TRUE;
+}
+
+/* this is checked after a fragment is loaded too, as it is not part of the key */
+static gboolean
+xb_builder_compile_source_check_root(XbBuilderCompileHelper *helper,
+				     XbBuilderNode *root_tmp,
+				     GError **error)
+{
 	/* a single root with no siblings was required */
 	if (helper->compile_flags & XB_BUILDER_COMPILE_FLAG_SINGLE_ROOT) {
 		if (xb_builder_node_get_children(root_tmp)->len > 1) {
@@ -321,20 +583,36 @@ xb_builder_compile_source(XbBuilderCompileHelper *helper,
 		}
 	}
 
-	/* this is something we can query with later */
-	info = xb_builder_source_get_info(source);
-	if (info != NULL) {
-		children = xb_builder_node_get_children(helper->current);
-		for (guint i = 0; i < children->len; i++) {
-			XbBuilderNode *bn = g_ptr_array_index(children, i);
-			if (!xb_builder_node_has_flag(bn, XB_BUILDER_NODE_FLAG_IGNORE))
-				xb_builder_node_add_child(bn, info);
-		}
-	}
+	/* success */
+	return TRUE;
+}
+
+/* this is something we can query with later, and is not part of the fragment
+ * as the same node is shared by every child */
+static void
+xb_builder_compile_source_add_info(XbBuilderSource *source, XbBuilderNode *root_tmp)
+{
+	GPtrArray *children;
+	XbBuilderNode *info = xb_builder_source_get_info(source);
 
-	/* add the children to the main document */
+	if (info == NULL)
+		return;
 	children = xb_builder_node_get_children(root_tmp);
-	children_copy = g_ptr_array_new_with_free_func((GDestroyNotify)g_object_unref);
+	for (guint i = 0; i < children->len; i++) {
+		XbBuilderNode *bn = g_ptr_array_index(children, i);
+		if (!xb_builder_node_has_flag(bn, XB_BUILDER_NODE_FLAG_IGNORE))
+			xb_builder_node_add_child(bn, info);
+	}
+}
+
+/* add the children of the fake root to the main document */
+static void
+xb_builder_compile_source_graft(XbBuilderNode *root_tmp, XbBuilderNode *root)
+{
+	GPtrArray *children = xb_builder_node_get_children(root_tmp);
+	g_autoptr(GPtrArray) children_copy =
+	    g_ptr_array_new_with_free_func((GDestroyNotify)g_object_unref);
+
 	for (guint i = 0; i < children->len; i++) {
 		XbBuilderNode *bn = g_ptr_array_index(children, i);
 		g_ptr_array_add(children_copy, g_object_ref(bn));
@@ -344,17 +622,181 @@ xb_builder_compile_source(XbBuilderCompileHelper *helper,
 		xb_builder_node_unlink(bn);
 		xb_builder_node_add_child(root, bn);
 	}
+}
 
-	/* success */
-	xb_silo_add_profile(helper->silo, timer, "compile %s", guid);
-	return TRUE;
+static void
+xb_builder_compile_job_free(XbBuilderCompileJob *job)
+{
+	g_object_unref(job->source);
+	g_object_unref(job->root_tmp);
+	xb_builder_string_arena_unref(job->arena);
+	if (job->timer != NULL)
+		g_timer_destroy(job->timer);
+	g_free(job->fragment_basename);
+	if (job->error != NULL)
+		g_error_free(job->error);
+	g_free(job);
+}
+
+/* everything that changes the result of compiling a single source; the only
+ * other compile flag used is checked after the source has been compiled */
+static gchar *
+xb_builder_fragment_basename(XbBuilderCompileHelper *helper, XbBuilderSource *source)
+{
+	g_autofree gchar *source_guid = xb_builder_source_get_guid(source);
+	g_autofree gchar *csum = NULL;
+	g_autoptr(GString) str = g_string_new(xb_version_string());
+
+	g_string_append_printf(str,
+			       ":%s:source-flags=%u:compile-flags=%u:lang-filter=%i",
+			       source_guid,
+			       (guint)xb_builder_source_get_flags(source),
+			       (guint)(helper->compile_flags & XB_BUILDER_COMPILE_FLAG_NATIVE_LANGS),
+			       helper->lang_filter);
+	for (guint i = 0; i < helper->locales->len; i++) {
+		const gchar *locale = g_ptr_array_index(helper->locales, i);
+		g_string_append_printf(str, ":%s", locale);
+	}
+	csum = g_compute_checksum_for_string(G_CHECKSUM_SHA1, str->str, str->len);
+	return g_strdup_printf("%s.xbf", csum);
 }
 
+/* a missing or invalid fragment just means the source gets parsed again */
 static gboolean
-xb_builder_strtab_element_names_cb(XbBuilderNode *bn, gpointer user_data)
+xb_builder_fragment_load(XbBuilderCompileHelper *helper, XbBuilderCompileJob *job)
+{
+	g_autoptr(GBytes) blob = NULL;
+	g_autoptr(GError) error_local = NULL;
+	g_autoptr(GFile) file = g_file_get_child(helper->fragment_cache, job->fragment_basename);
+	g_autoptr(XbBuilderNode) root_tmp = NULL;
+
+	blob = g_file_load_bytes(file, job->cancellable, NULL, &error_local);
+	if (blob == NULL) {
+		if (!g_error_matches(error_local, G_IO_ERROR, G_IO_ERROR_NOT_FOUND))
+			g_debug("failed to load fragment: %s", error_local->message);
+		return FALSE;
+	}
+	root_tmp = xb_builder_node_fragment_load(blob, job->arena, &error_local);
+	if (root_tmp == NULL) {
+		g_debug("ignoring fragment %s: %s", job->fragment_basename, error_local->message);
+		return FALSE;
+	}
+	g_set_object(&job->root_tmp, root_tmp);
+	return TRUE;
+}
+
+/* failing to save is not fatal, as the source will just be parsed next time */
+static void
+xb_builder_fragment_save(XbBuilderCompileHelper *helper, XbBuilderCompileJob *job)
+{
+	g_autoptr(GBytes) blob = xb_builder_node_fragment_save(job->root_tmp);
+	g_autoptr(GError) error_local = NULL;
+	g_autoptr(GFile) file = g_file_get_child(helper->fragment_cache, job->fragment_basename);
+
+	if (!g_file_replace_contents(file,
+				     g_bytes_get_data(blob, NULL),
+				     g_bytes_get_size(blob),
+				     NULL,
+				     FALSE,
+				     G_FILE_CREATE_NONE,
+				     NULL,
+				     job->cancellable,
+				     &error_local))
+		g_debug("failed to save fragment: %s", error_local->message);
+}
+
+/* remove the fragments of sources that are no longer imported or have changed */
+static void
+xb_builder_fragment_cache_prune(GFile *fragment_cache,
+				GPtrArray *jobs,
+				GCancellable *cancellable)
+{
+	GFileInfo *info;
+	g_autoptr(GError) error_local = NULL;
+	g_autoptr(GFileEnumerator) enumerator = NULL;
+	g_autoptr(GHashTable) used = g_hash_table_new(g_str_hash, g_str_equal);
+
+	for (guint i = 0; i < jobs->len; i++) {
+		XbBuilderCompileJob *job = g_ptr_array_index(jobs, i);
+		if (job->fragment_basename != NULL)
+			g_hash_table_add(used, job->fragment_basename);
+	}
+	enumerator = g_file_enumerate_children(fragment_cache,
+					       G_FILE_ATTRIBUTE_STANDARD_NAME,
+					       G_FILE_QUERY_INFO_NONE,
+					       cancellable,
+					       &error_local);
+	if (enumerator == NULL) {
+		g_debug("failed to prune fragments: %s", error_local->message);
+		return;
+	}
+	while ((info = g_file_enumerator_next_file(enumerator, cancellable, NULL)) != NULL) {
+		g_autoptr(GFileInfo) info_tmp = info;
+		const gchar *name = g_file_info_get_name(info);
+		g_autoptr(GFile) file = NULL;
+
+		if (!g_str_has_suffix(name, ".xbf") || g_hash_table_contains(used, name))
+			continue;
+		file = g_file_get_child(fragment_cache, name);
+		if (!g_file_delete(file, cancellable, &error_local)) {
+			g_debug("failed to delete %s: %s", name, error_local->message);
+			g_clear_error(&error_local);
+		}
+	}
+}
+
+/* runs in a worker thread when parsing in parallel, so the parser state has
+ * to live on the stack rather than in the shared helper */
+static void
+xb_builder_compile_job_cb(gpointer data, gpointer user_data)
 {
+	XbBuilderCompileJob *job = (XbBuilderCompileJob *)data;
 	XbBuilderCompileHelper *helper = (XbBuilderCompileHelper *)user_data;
-	const gchar *tmp;
+	XbBuilderCompileHelper helper_tmp = {
+	    .silo = helper->silo,
+	    .arena = job->arena,
+	    .compile_flags = helper->compile_flags,
+	    .locales = helper->locales,
+	    .elem_closed = FALSE,
+	    .lang_filter = helper->lang_filter,
+	};
+
+	job->timer = g_timer_new();
+	if (helper->fragment_cache != NULL) {
+		job->fragment_basename = xb_builder_fragment_basename(helper, job->source);
+		job->fragment_loaded = xb_builder_fragment_load(helper, job);
+	}
+	if (!job->fragment_loaded) {
+		if (xb_builder_compile_source(&helper_tmp,
+					      job->source,
+					      job->root_tmp,
+					      job->cancellable,
+					      &job->error) &&
+		    helper->fragment_cache != NULL)
+			xb_builder_fragment_save(helper, job);
+	}
+	if (job->error == NULL)
+		xb_builder_compile_source_check_root(helper, job->root_tmp, &job->error);
+	if (job->error == NULL)
+		xb_builder_compile_source_add_info(job->source, job->root_tmp);
+	g_timer_stop(job->timer);
+}
+
+typedef struct {
+	XbBuilderCompileHelper *helper;
+	guint32 nodetabsz;
+	GPtrArray *attrs;  /* of XbBuilderNodeAttr, transfer none */
+	GPtrArray *texts;  /* of XbBuilderNode, transfer none */
+	GPtrArray *tokens; /* of XbBuilderNode, transfer none */
+} XbBuilderStrtabHelper;
+
+/* element names have to be first in the strtab, so add those now and remember
+ * everything else so it can be added in order without walking the tree again */
+static gboolean
+xb_builder_strtab_cb(XbBuilderNode *bn, gpointer user_data)
+{
+	XbBuilderStrtabHelper *helper = (XbBuilderStrtabHelper *)user_data;
+	GPtrArray *attrs;
 	guint32 strtab_idx;
 
 	/* root node */
@@ -362,109 +804,94 @@ xb_builder_strtab_element_names_cb(XbBuilderNode *bn, gpointer user_data)
 		return FALSE;
 	if (xb_builder_node_has_flag(bn, XB_BUILDER_NODE_FLAG_IGNORE))
 		return FALSE;
-	tmp = xb_builder_node_get_element(bn);
-	strtab_idx = xb_builder_compile_add_to_strtab(helper, tmp);
+
+	/* +1 for the sentinel */
+	helper->nodetabsz += xb_builder_node_size(bn) + 1;
+
+	strtab_idx = xb_builder_compile_add_to_strtab(helper->helper,
+						      xb_builder_node_get_element(bn));
 	if (strtab_idx == XB_SILO_UNSET)
 		return TRUE;
 	xb_builder_node_set_element_idx(bn, strtab_idx);
+
+	attrs = xb_builder_node_get_attrs(bn);
+	for (guint i = 0; attrs != NULL && i < attrs->len; i++)
+		g_ptr_array_add(helper->attrs, g_ptr_array_index(attrs, i));
+	if (xb_builder_node_get_text(bn) != NULL || xb_builder_node_get_tail(bn) != NULL)
+		g_ptr_array_add(helper->texts, bn);
+	if (xb_builder_node_get_tokens(bn) != NULL)
+		g_ptr_array_add(helper->tokens, bn);
 	return FALSE;
 }
 
 static gboolean
-xb_builder_strtab_attr_name_cb(XbBuilderNode *bn, gpointer user_data)
+xb_builder_strtab_add_attr_names(XbBuilderCompileHelper *helper, GPtrArray *attrs)
 {
-	GPtrArray *attrs;
-	XbBuilderCompileHelper *helper = (XbBuilderCompileHelper *)user_data;
-
-	/* root node */
-	if (xb_builder_node_get_element(bn) == NULL)
-		return FALSE;
-	if (xb_builder_node_has_flag(bn, XB_BUILDER_NODE_FLAG_IGNORE))
-		return FALSE;
-	attrs = xb_builder_node_get_attrs(bn);
-	for (guint i = 0; attrs != NULL && i < attrs->len; i++) {
+	for (guint i = 0; i < attrs->len; i++) {
 		XbBuilderNodeAttr *attr = g_ptr_array_index(attrs, i);
 		attr->name_idx = xb_builder_compile_add_to_strtab(helper, attr->name);
 		if (attr->name_idx == XB_SILO_UNSET)
-			return TRUE;
+			return FALSE;
 	}
-	return FALSE;
+	return TRUE;
 }
 
 static gboolean
-xb_builder_strtab_attr_value_cb(XbBuilderNode *bn, gpointer user_data)
+xb_builder_strtab_add_attr_values(XbBuilderCompileHelper *helper, GPtrArray *attrs)
 {
-	GPtrArray *attrs;
-	XbBuilderCompileHelper *helper = (XbBuilderCompileHelper *)user_data;
-
-	/* root node */
-	if (xb_builder_node_get_element(bn) == NULL)
-		return FALSE;
-	if (xb_builder_node_has_flag(bn, XB_BUILDER_NODE_FLAG_IGNORE))
-		return FALSE;
-	attrs = xb_builder_node_get_attrs(bn);
-	for (guint i = 0; attrs != NULL && i < attrs->len; i++) {
+	for (guint i = 0; i < attrs->len; i++) {
 		XbBuilderNodeAttr *attr = g_ptr_array_index(attrs, i);
 		attr->value_idx = xb_builder_compile_add_to_strtab(helper, attr->value);
 		if (attr->value_idx == XB_SILO_UNSET)
-			return TRUE;
+			return FALSE;
 	}
-	return FALSE;
+	return TRUE;
 }
 
 static gboolean
-xb_builder_strtab_text_cb(XbBuilderNode *bn, gpointer user_data)
+xb_builder_strtab_add_texts(XbBuilderCompileHelper *helper, GPtrArray *texts)
 {
-	XbBuilderCompileHelper *helper = (XbBuilderCompileHelper *)user_data;
-	const gchar *tmp;
-	guint32 strtab_idx;
+	for (guint i = 0; i < texts->len; i++) {
+		XbBuilderNode *bn = g_ptr_array_index(texts, i);
+		const gchar *tmp;
+		guint32 strtab_idx;
 
-	/* root node */
-	if (xb_builder_node_get_element(bn) == NULL)
-		return FALSE;
-	if (xb_builder_node_has_flag(bn, XB_BUILDER_NODE_FLAG_IGNORE))
-		return FALSE;
-	if (xb_builder_node_get_text(bn) != NULL) {
 		tmp = xb_builder_node_get_text(bn);
-		strtab_idx = xb_builder_compile_add_to_strtab(helper, tmp);
-		if (strtab_idx == XB_SILO_UNSET)
-			return TRUE;
-		xb_builder_node_set_text_idx(bn, strtab_idx);
-	}
-	if (xb_builder_node_get_tail(bn) != NULL) {
+		if (tmp != NULL) {
+			strtab_idx = xb_builder_compile_add_to_strtab(helper, tmp);
+			if (strtab_idx == XB_SILO_UNSET)
+				return FALSE;
+			xb_builder_node_set_text_idx(bn, strtab_idx);
+		}
 		tmp = xb_builder_node_get_tail(bn);
-		strtab_idx = xb_builder_compile_add_to_strtab(helper, tmp);
-		if (strtab_idx == XB_SILO_UNSET)
-			return TRUE;
-		xb_builder_node_set_tail_idx(bn, strtab_idx);
+		if (tmp != NULL) {
+			strtab_idx = xb_builder_compile_add_to_strtab(helper, tmp);
+			if (strtab_idx == XB_SILO_UNSET)
+				return FALSE;
+			xb_builder_node_set_tail_idx(bn, strtab_idx);
+		}
 	}
-	return FALSE;
+	return TRUE;
 }
 
 static gboolean
-xb_builder_strtab_tokens_cb(XbBuilderNode *bn, gpointer user_data)
+xb_builder_strtab_add_tokens(XbBuilderCompileHelper *helper, GPtrArray *nodes)
 {
-	XbBuilderCompileHelper *helper = (XbBuilderCompileHelper *)user_data;
-	GPtrArray *tokens = xb_builder_node_get_tokens(bn);
-	guint32 strtab_idx;
-
-	/* root node */
-	if (xb_builder_node_get_element(bn) == NULL)
-		return FALSE;
-	if (xb_builder_node_has_flag(bn, XB_BUILDER_NODE_FLAG_IGNORE))
-		return FALSE;
-	if (tokens == NULL)
-		return FALSE;
-	for (guint i = 0; i < MIN(tokens->len, XB_OPCODE_TOKEN_MAX); i++) {
-		const gchar *tmp = g_ptr_array_index(tokens, i);
-		if (tmp == NULL)
-			continue;
-		strtab_idx = xb_builder_compile_add_to_strtab(helper, tmp);
-		if (strtab_idx == XB_SILO_UNSET)
-			return TRUE;
-		xb_builder_node_add_token_idx(bn, strtab_idx);
+	for (guint j = 0; j < nodes->len; j++) {
+		XbBuilderNode *bn = g_ptr_array_index(nodes, j);
+		GPtrArray *tokens = xb_builder_node_get_tokens(bn);
+		for (guint i = 0; i < MIN(tokens->len, XB_OPCODE_TOKEN_MAX); i++) {
+			const gchar *tmp = g_ptr_array_index(tokens, i);
+			guint32 strtab_idx;
+			if (tmp == NULL)
+				continue;
+			strtab_idx = xb_builder_compile_add_to_strtab(helper, tmp);
+			if (strtab_idx == XB_SILO_UNSET)
+				return FALSE;
+			xb_builder_node_add_token_idx(bn, strtab_idx);
+		}
 	}
-	return FALSE;
+	return TRUE;
 }
 
 static gboolean
@@ -517,75 +944,162 @@ xb_builder_xml_lang_prio_cb(XbBuilderNode *bn, gpointer user_data)
 	return FALSE;
 }
 
+/* nodes flagged by a fixup that still need the search tokens */
 static gboolean
-xb_builder_nodetab_size_cb(XbBuilderNode *bn, gpointer user_data)
+xb_builder_tokenize_collect_cb(XbBuilderNode *bn, gpointer user_data)
 {
-	guint32 *sz = (guint32 *)user_data;
-
-	/* root node */
-	if (xb_builder_node_get_element(bn) == NULL)
-		return FALSE;
+	GPtrArray *nodes = (GPtrArray *)user_data;
 	if (xb_builder_node_has_flag(bn, XB_BUILDER_NODE_FLAG_IGNORE))
 		return FALSE;
-	*sz += xb_builder_node_size(bn) + 1; /* +1 for the sentinel */
+	if (!xb_builder_node_has_flag(bn, XB_BUILDER_NODE_FLAG_TOKENIZE_PENDING))
+		return FALSE;
+	if (xb_builder_node_get_text(bn) == NULL || xb_builder_node_get_tokens(bn) != NULL)
+		return FALSE;
+	g_ptr_array_add(nodes, bn);
 	return FALSE;
 }
 
+/* each node only writes to its own token array */
+static void
+xb_builder_tokenize_job_cb(gpointer data, gpointer user_data)
+{
+	xb_builder_node_tokenize_text(XB_BUILDER_NODE(data));
+}
+
+static gboolean
+xb_builder_tokenize(XbBuilderNode *root, guint max_threads, guint *nodes_len, GError **error)
+{
+	GThreadPool *pool;
+	g_autoptr(GPtrArray) nodes = g_ptr_array_new();
+
+	xb_builder_node_traverse(root,
+				 G_PRE_ORDER,
+				 G_TRAVERSE_ALL,
+				 -1,
+				 xb_builder_tokenize_collect_cb,
+				 nodes);
+	*nodes_len = nodes->len;
+	if (max_threads <= 1 || nodes->len <= 1) {
+		for (guint i = 0; i < nodes->len; i++)
+			xb_builder_tokenize_job_cb(g_ptr_array_index(nodes, i), NULL);
+		return TRUE;
+	}
+	pool = g_thread_pool_new(xb_builder_tokenize_job_cb,
+				 NULL,
+				 MIN(max_threads, nodes->len),
+				 FALSE,
+				 error);
+	if (pool == NULL)
+		return FALSE;
+	for (guint i = 0; i < nodes->len; i++) {
+		if (!g_thread_pool_push(pool, g_ptr_array_index(nodes, i), error)) {
+			g_thread_pool_free(pool, FALSE, TRUE);
+			return FALSE;
+		}
+	}
+	g_thread_pool_free(pool, FALSE, TRUE);
+	return TRUE;
+}
+
 typedef struct {
 	GByteArray *buf;
 } XbBuilderNodetabHelper;
 
+/* the sentinel, node and whitespace helpers are also used by the streaming
+ * compile so both produce the same nodetab */
 static void
-xb_builder_nodetab_write_sentinel(XbBuilderNodetabHelper *helper)
+xb_builder_nodetab_write_sentinel(GByteArray *buf)
 {
 	XbSiloNode sn = {
 	    .flags = XB_SILO_NODE_FLAG_NONE,
 	    .attr_count = 0,
 	};
-	//	g_debug ("SENT @%u", (guint) helper->buf->len);
-	g_byte_array_append(helper->buf, (const guint8 *)&sn, xb_silo_node_get_size(&sn));
+	//	g_debug ("SENT @%u", (guint) buf->len);
+	g_byte_array_append(buf, (const guint8 *)&sn, xb_silo_node_get_size(&sn));
 }
 
 #define XB_BUILDER_ATTR_MAX ((1 << 6) - 1)
 
 static gboolean
-xb_builder_nodetab_write_node(XbBuilderNodetabHelper *helper, XbBuilderNode *bn, GError **error)
+xb_builder_nodetab_check_attrs(GPtrArray *attrs, GError **error)
+{
+	if (attrs != NULL && attrs->len > XB_BUILDER_ATTR_MAX) {
+		g_set_error(error,
+			    G_IO_ERROR,
+			    G_IO_ERROR_NOT_SUPPORTED,
+			    "too many attributes: %u",
+			    attrs->len);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/* if the node had no children and the text is just whitespace then remove it
+ * even in literal mode */
+static gboolean
+xb_builder_nodetab_is_literal_space(XbBuilderNode *bn, const gchar *str)
+{
+	return xb_builder_node_has_flag(bn, XB_BUILDER_NODE_FLAG_LITERAL_TEXT) &&
+	       xb_string_isspace(str, -1);
+}
+
+static void
+xb_builder_nodetab_append_node(GByteArray *buf,
+			       XbSiloNode *sn,
+			       const XbSiloNodeAttr *attrs,
+			       guint attr_count,
+			       GArray *token_idxs)
+{
+	sn->attr_count = attr_count;
+
+	/* there is no point adding more tokens than we can match */
+	if (token_idxs != NULL) {
+		sn->flags |= XB_SILO_NODE_FLAG_IS_TOKENIZED;
+		sn->token_count = MIN(token_idxs->len, XB_OPCODE_TOKEN_MAX);
+	}
+
+	/* add to the buf */
+	g_byte_array_append(buf, (const guint8 *)sn, sizeof(*sn));
+	g_byte_array_append(buf, (const guint8 *)attrs, attr_count * sizeof(XbSiloNodeAttr));
+	if (token_idxs != NULL) {
+		g_byte_array_append(buf,
+				    (const guint8 *)token_idxs->data,
+				    sn->token_count * sizeof(guint32));
+	}
+}
+
+static gboolean
+xb_builder_nodetab_write_node(XbBuilderNodetabHelper *helper,
+			      XbBuilderNode *bn,
+			      guint depth,
+			      GError **error)
 {
 	GPtrArray *attrs = xb_builder_node_get_attrs(bn);
-	GArray *token_idxs = xb_builder_node_get_token_idxs(bn);
+	XbSiloNodeAttr attrs_silo[XB_BUILDER_ATTR_MAX];
 	XbSiloNode sn = {
 	    .flags = XB_SILO_NODE_FLAG_IS_ELEMENT,
-	    .attr_count = (attrs != NULL) ? attrs->len : 0,
 	    .element_name = xb_builder_node_get_element_idx(bn),
 	    .next = 0x0,
 	    .parent = 0x0,
 	    .text = xb_builder_node_get_text_idx(bn),
 	    .tail = xb_builder_node_get_tail_idx(bn),
+	    .end = 0x0,
+	    .depth = MIN(depth, G_MAXUINT16),
 	    .token_count = 0,
 	};
 
 	/* sanity check */
-	if (attrs != NULL && attrs->len > XB_BUILDER_ATTR_MAX) {
-		g_set_error(error,
-			    G_IO_ERROR,
-			    G_IO_ERROR_NOT_SUPPORTED,
-			    "too many attributes: %u",
-			    attrs->len);
+	if (!xb_builder_nodetab_check_attrs(attrs, error))
 		return FALSE;
+	for (guint i = 0; attrs != NULL && i < attrs->len; i++) {
+		XbBuilderNodeAttr *ba = g_ptr_array_index(attrs, i);
+		attrs_silo[i].attr_name = ba->name_idx;
+		attrs_silo[i].attr_value = ba->value_idx;
 	}
-
-	/* add tokens */
-	if (token_idxs != NULL)
-		sn.flags |= XB_SILO_NODE_FLAG_IS_TOKENIZED;
-
-	/* if the node had no children and the text is just whitespace then
-	 * remove it even in literal mode */
-	if (xb_builder_node_has_flag(bn, XB_BUILDER_NODE_FLAG_LITERAL_TEXT)) {
-		if (xb_string_isspace(xb_builder_node_get_text(bn), -1))
-			sn.text = XB_SILO_UNSET;
-		if (xb_string_isspace(xb_builder_node_get_tail(bn), -1))
-			sn.tail = XB_SILO_UNSET;
-	}
+	if (xb_builder_nodetab_is_literal_space(bn, xb_builder_node_get_text(bn)))
+		sn.text = XB_SILO_UNSET;
+	if (xb_builder_nodetab_is_literal_space(bn, xb_builder_node_get_tail(bn)))
+		sn.tail = XB_SILO_UNSET;
 
 	/* save this so we can set up the ->next pointers correctly */
 	xb_builder_node_set_offset(bn, helper->buf->len);
@@ -593,37 +1107,30 @@ xb_builder_nodetab_write_node(XbBuilderNodetabHelper *helper, XbBuilderNode *bn,
 	//	g_debug ("NODE @%u (%s)", (guint) helper->buf->len, xb_builder_node_get_element
 	//(bn));
 
-	/* there is no point adding more tokens than we can match */
-	if (token_idxs != NULL)
-		sn.token_count = MIN(token_idxs->len, XB_OPCODE_TOKEN_MAX);
-
-	/* add to the buf */
-	g_byte_array_append(helper->buf, (const guint8 *)&sn, sizeof(sn));
-
-	/* add to the buf */
-	for (guint i = 0; attrs != NULL && i < attrs->len; i++) {
-		XbBuilderNodeAttr *ba = g_ptr_array_index(attrs, i);
-		XbSiloNodeAttr attr = {
-		    .attr_name = ba->name_idx,
-		    .attr_value = ba->value_idx,
-		};
-		g_byte_array_append(helper->buf, (const guint8 *)&attr, sizeof(attr));
-	}
-
-	/* add tokens */
-	for (guint i = 0; i < sn.token_count; i++) {
-		guint32 idx = g_array_index(token_idxs, guint32, i);
-		g_byte_array_append(helper->buf, (const guint8 *)&idx, sizeof(idx));
-	}
+	xb_builder_nodetab_append_node(helper->buf,
+				       &sn,
+				       attrs_silo,
+				       attrs != NULL ? attrs->len : 0,
+				       xb_builder_node_get_token_idxs(bn));
 
 	/* success */
 	return TRUE;
 }
 
+static XbSiloNode *
+xb_builder_get_node(GByteArray *str, guint32 off)
+{
+	return (XbSiloNode *)(str->data + off);
+}
+
 static gboolean
-xb_builder_nodetab_write(XbBuilderNodetabHelper *helper, XbBuilderNode *bn, GError **error)
+xb_builder_nodetab_write(XbBuilderNodetabHelper *helper,
+			 XbBuilderNode *bn,
+			 guint depth,
+			 GError **error)
 {
 	GPtrArray *children;
+	guint32 prev_offset = 0;
 
 	/* ignore this */
 	if (xb_builder_node_has_flag(bn, XB_BUILDER_NODE_FLAG_IGNORE))
@@ -631,73 +1138,520 @@ xb_builder_nodetab_write(XbBuilderNodetabHelper *helper, XbBuilderNode *bn, GErr
 
 	/* element */
 	if (xb_builder_node_get_element(bn) != NULL) {
-		if (!xb_builder_nodetab_write_node(helper, bn, error))
+		if (!xb_builder_nodetab_write_node(helper, bn, depth, error))
 			return FALSE;
 	}
 
-	/* children */
+	/* children, setting ->parent and ->next as we go */
 	children = xb_builder_node_get_children(bn);
 	for (guint i = 0; i < children->len; i++) {
 		XbBuilderNode *bc = g_ptr_array_index(children, i);
-		if (!xb_builder_nodetab_write(helper, bc, error))
+		guint depth_child = xb_builder_node_get_element(bn) != NULL ? depth + 1 : depth;
+		XbSiloNode *sn;
+		if (!xb_builder_nodetab_write(helper, bc, depth_child, error))
 			return FALSE;
+		if (xb_builder_node_has_flag(bc, XB_BUILDER_NODE_FLAG_IGNORE))
+			continue;
+		if (xb_builder_node_get_element(bc) == NULL) {
+			prev_offset = 0;
+			continue;
+		}
+		sn = xb_builder_get_node(helper->buf, xb_builder_node_get_offset(bc));
+		if (xb_builder_node_get_element(bn) != NULL)
+			sn->parent = xb_builder_node_get_offset(bn);
+		if (prev_offset != 0) {
+			sn = xb_builder_get_node(helper->buf, prev_offset);
+			sn->next = xb_builder_node_get_offset(bc);
+		}
+		prev_offset = xb_builder_node_get_offset(bc);
 	}
 
-	/* sentinel */
-	if (xb_builder_node_get_element(bn) != NULL)
-		xb_builder_nodetab_write_sentinel(helper);
+	/* sentinel, and then record where the subtree ends */
+	if (xb_builder_node_get_element(bn) != NULL) {
+		XbSiloNode *sn;
+		xb_builder_nodetab_write_sentinel(helper->buf);
+		sn = xb_builder_get_node(helper->buf, xb_builder_node_get_offset(bn));
+		sn->end = helper->buf->len;
+	}
 
 	/* success */
 	return TRUE;
 }
 
-static XbSiloNode *
-xb_builder_get_node(GByteArray *str, guint32 off)
+typedef struct {
+	guint32 element_name;
+	guint32 parent;
+	guint32 offset;
+} XbBuilderPosting;
+
+static gint
+xb_builder_posting_sort_cb(gconstpointer a, gconstpointer b)
 {
-	return (XbSiloNode *)(str->data + off);
+	const XbBuilderPosting *p1 = (const XbBuilderPosting *)a;
+	const XbBuilderPosting *p2 = (const XbBuilderPosting *)b;
+	if (p1->element_name != p2->element_name)
+		return p1->element_name < p2->element_name ? -1 : 1;
+	if (p1->parent != p2->parent)
+		return p1->parent < p2->parent ? -1 : 1;
+	if (p1->offset != p2->offset)
+		return p1->offset < p2->offset ? -1 : 1;
+	return 0;
 }
 
-static gboolean
-xb_builder_nodetab_fix_cb(XbBuilderNode *bn, gpointer user_data)
+/* group every element offset by name, and then by parent, returning the
+ * offset of the section or 0 if there are no elements */
+static guint32
+xb_builder_postings_write(GByteArray *buf, guint32 nodetabsz)
 {
-	GPtrArray *siblings;
-	XbBuilderNodetabHelper *helper = (XbBuilderNodetabHelper *)user_data;
-	XbSiloNode *sn;
-	gboolean found = FALSE;
-	g_autoptr(XbBuilderNode) parent = xb_builder_node_get_parent(bn);
+	guint32 postings_off = buf->len;
+	XbSiloPostingsHeader phdr = {0x0};
+	g_autoptr(GArray) postings = g_array_new(FALSE, FALSE, sizeof(XbBuilderPosting));
+	g_autoptr(GByteArray) groups = g_byte_array_new();
+
+	/* nodes are in document order, so each group is already sorted */
+	for (guint32 off = sizeof(XbSiloHeader); off < nodetabsz;) {
+		XbSiloNode *sn = xb_builder_get_node(buf, off);
+		if (xb_silo_node_has_flag(sn, XB_SILO_NODE_FLAG_IS_ELEMENT)) {
+			XbBuilderPosting posting = {
+			    .element_name = sn->element_name,
+			    .parent = sn->parent,
+			    .offset = off,
+			};
+			g_array_append_val(postings, posting);
+		}
+		off += xb_silo_node_get_size(sn);
+	}
+	if (postings->len == 0)
+		return 0;
+	g_array_sort(postings, xb_builder_posting_sort_cb);
+
+	/* header is fixed up when the counts are known */
+	g_byte_array_append(buf, (const guint8 *)&phdr, sizeof(phdr));
+
+	/* one entry per element name, one group per parent */
+	for (guint i = 0; i < postings->len; i++) {
+		XbBuilderPosting *posting = &g_array_index(postings, XbBuilderPosting, i);
+		XbBuilderPosting *posting_prev =
+		    i > 0 ? &g_array_index(postings, XbBuilderPosting, i - 1) : NULL;
+		XbSiloPostingGroup group = {
+		    .parent = posting->parent,
+		    .node_idx = i,
+		};
+		if (posting_prev == NULL || posting_prev->element_name != posting->element_name) {
+			XbSiloPostingEntry entry = {
+			    .element_name = posting->element_name,
+			    .group_idx = phdr.n_groups,
+			};
+			g_byte_array_append(buf, (const guint8 *)&entry, sizeof(entry));
+			phdr.n_entries++;
+		} else if (posting_prev->parent == posting->parent) {
+			continue;
+		}
+		g_byte_array_append(groups, (const guint8 *)&group, sizeof(group));
+		phdr.n_groups++;
+	}
+	g_byte_array_append(buf, groups->data, groups->len);
 
-	/* root node */
-	if (xb_builder_node_get_element(bn) == NULL)
-		return FALSE;
-	if (xb_builder_node_has_flag(bn, XB_BUILDER_NODE_FLAG_IGNORE))
-		return FALSE;
+	/* node offsets */
+	for (guint i = 0; i < postings->len; i++) {
+		XbBuilderPosting *posting = &g_array_index(postings, XbBuilderPosting, i);
+		g_byte_array_append(buf, (const guint8 *)&posting->offset, sizeof(guint32));
+	}
+	phdr.n_nodes = postings->len;
+	memcpy(buf->data + postings_off, &phdr, sizeof(phdr));
+	return postings_off;
+}
 
-	/* get the position in the buffer */
-	sn = xb_builder_get_node(helper->buf, xb_builder_node_get_offset(bn));
-	if (sn == NULL)
-		return FALSE;
+/* a read-only open-addressing hash table of every string, returning the
+ * offset of the section or 0 if there are no strings */
+static guint32
+xb_builder_strindex_write(GByteArray *buf, GHashTable *strtab_hash)
+{
+	guint32 strindex_off = buf->len;
+	guint32 mask;
+	GHashTableIter iter;
+	gpointer key;
+	gpointer value;
+	g_autofree guint32 *buckets = NULL;
+	XbSiloStrindexHeader ihdr = {
+	    .n_buckets = 1,
+	};
+
+	/* keep the load factor under 0.5 */
+	if (g_hash_table_size(strtab_hash) == 0)
+		return 0;
+	while (ihdr.n_buckets < g_hash_table_size(strtab_hash) * 2)
+		ihdr.n_buckets <<= 1;
+	mask = ihdr.n_buckets - 1;
+	buckets = g_new(guint32, ihdr.n_buckets);
+	memset(buckets, 0xff, ihdr.n_buckets * sizeof(guint32));
+
+	/* linear probing */
+	g_hash_table_iter_init(&iter, strtab_hash);
+	while (g_hash_table_iter_next(&iter, &key, &value)) {
+		guint32 idx = xb_silo_strtab_hash((const gchar *)key, 0) & mask;
+		while (buckets[idx] != XB_SILO_UNSET)
+			idx = (idx + 1) & mask;
+		buckets[idx] = GPOINTER_TO_UINT(value);
+	}
+	g_byte_array_append(buf, (const guint8 *)&ihdr, sizeof(ihdr));
+	g_byte_array_append(buf, (const guint8 *)buckets, ihdr.n_buckets * sizeof(guint32));
+	return strindex_off;
+}
 
-	/* set the parent if the node has one */
-	if (xb_builder_node_get_element(parent) != NULL)
-		sn->parent = xb_builder_node_get_offset(parent);
+#define XB_BUILDER_TAGTAB_SEED_MAX (1 << 20)
 
-	/* set ->next if the node has one */
-	siblings = xb_builder_node_get_children(parent);
-	for (guint i = 0; i < siblings->len; i++) {
-		XbBuilderNode *bn2 = g_ptr_array_index(siblings, i);
-		if (bn2 == bn) {
-			found = TRUE;
-			continue;
+static gint
+xb_builder_tagtab_bucket_sort_cb(gconstpointer a, gconstpointer b)
+{
+	GPtrArray *bucket1 = *((GPtrArray **)a);
+	GPtrArray *bucket2 = *((GPtrArray **)b);
+	if (bucket1->len != bucket2->len)
+		return bucket1->len > bucket2->len ? -1 : 1;
+	return 0;
+}
+
+/* a minimal perfect hash of the element names using hash-and-displace,
+ * returning the offset of the section or 0 if one could not be found */
+static guint32
+xb_builder_tagtab_write(GByteArray *buf, GByteArray *strtab, guint16 ntags)
+{
+	guint32 tagtab_off = buf->len;
+	guint32 off = 0;
+	g_autofree gint32 *displacements = NULL;
+	g_autofree guint32 *offsets = NULL;
+	g_autofree gboolean *used = NULL;
+	g_autofree guint32 *slots = NULL;
+	g_autoptr(GPtrArray) buckets = NULL;
+	g_autoptr(GPtrArray) buckets_sorted = NULL;
+	XbSiloTagtabHeader thdr = {
+	    .n_tags = ntags,
+	};
+
+	if (ntags == 0)
+		return 0;
+	displacements = g_new0(gint32, ntags);
+	offsets = g_new0(guint32, ntags);
+	used = g_new0(gboolean, ntags);
+	slots = g_new0(guint32, ntags);
+
+	/* element names are always at the start of the strtab */
+	buckets = g_ptr_array_new_with_free_func((GDestroyNotify)g_ptr_array_unref);
+	for (guint i = 0; i < ntags; i++)
+		g_ptr_array_add(buckets, g_ptr_array_new());
+	buckets_sorted = g_ptr_array_new();
+	for (guint i = 0; i < ntags; i++) {
+		const gchar *tmp = (const gchar *)strtab->data + off;
+		GPtrArray *bucket = g_ptr_array_index(buckets, xb_silo_strtab_hash(tmp, 0) % ntags);
+		g_ptr_array_add(bucket, GUINT_TO_POINTER(off));
+		off += strlen(tmp) + 1;
+	}
+	for (guint i = 0; i < ntags; i++)
+		g_ptr_array_add(buckets_sorted, g_ptr_array_index(buckets, i));
+	g_ptr_array_sort(buckets_sorted, xb_builder_tagtab_bucket_sort_cb);
+
+	/* find a seed for each bucket with collisions, largest first */
+	for (guint i = 0; i < ntags; i++) {
+		GPtrArray *bucket = g_ptr_array_index(buckets_sorted, i);
+		const gchar *tmp;
+		guint bucket_idx;
+		guint32 seed;
+
+		if (bucket->len <= 1)
+			break;
+		tmp = (const gchar *)strtab->data + GPOINTER_TO_UINT(g_ptr_array_index(bucket, 0));
+		bucket_idx = xb_silo_strtab_hash(tmp, 0) % ntags;
+		for (seed = 1; seed < XB_BUILDER_TAGTAB_SEED_MAX; seed++) {
+			guint j;
+			for (j = 0; j < bucket->len; j++) {
+				guint32 str_off = GPOINTER_TO_UINT(g_ptr_array_index(bucket, j));
+				guint32 slot =
+				    xb_silo_strtab_hash((const gchar *)strtab->data + str_off, seed) %
+				    ntags;
+				if (used[slot])
+					break;
+				used[slot] = TRUE;
+				slots[j] = slot;
+			}
+			if (j == bucket->len)
+				break;
+
+			/* undo */
+			for (guint k = 0; k < j; k++)
+				used[slots[k]] = FALSE;
 		}
-		if (!found)
+		if (seed == XB_BUILDER_TAGTAB_SEED_MAX)
+			return 0;
+		displacements[bucket_idx] = (gint32)seed;
+		for (guint j = 0; j < bucket->len; j++)
+			offsets[slots[j]] = GPOINTER_TO_UINT(g_ptr_array_index(bucket, j));
+	}
+
+	/* the single entries go directly into the free slots */
+	for (guint i = 0, slot = 0; i < ntags; i++) {
+		GPtrArray *bucket = g_ptr_array_index(buckets_sorted, i);
+		guint32 str_off;
+		const gchar *tmp;
+		if (bucket->len != 1)
 			continue;
-		if (!xb_builder_node_has_flag(bn2, XB_BUILDER_NODE_FLAG_IGNORE)) {
-			sn->next = xb_builder_node_get_offset(bn2);
-			break;
+		while (used[slot])
+			slot++;
+		str_off = GPOINTER_TO_UINT(g_ptr_array_index(bucket, 0));
+		tmp = (const gchar *)strtab->data + str_off;
+		displacements[xb_silo_strtab_hash(tmp, 0) % ntags] = -((gint32)slot + 1);
+		offsets[slot] = str_off;
+		used[slot] = TRUE;
+	}
+
+	g_byte_array_append(buf, (const guint8 *)&thdr, sizeof(thdr));
+	g_byte_array_append(buf, (const guint8 *)displacements, ntags * sizeof(gint32));
+	g_byte_array_append(buf, (const guint8 *)offsets, ntags * sizeof(guint32));
+	return tagtab_off;
+}
+
+/* dense columns of the element-name ordinal and depth of every element in
+ * document order, returning the offset of the section or 0 if there are none */
+static guint32
+xb_builder_columns_write(GByteArray *buf, GByteArray *strtab, guint16 ntags, guint32 nodetabsz)
+{
+	guint32 columns_off = buf->len;
+	guint32 off = 0;
+	guint32 data_off;
+	g_autofree guint32 *tags = NULL;
+	g_autoptr(GArray) ids = g_array_new(FALSE, FALSE, sizeof(guint16));
+	g_autoptr(GArray) depths = g_array_new(FALSE, FALSE, sizeof(guint16));
+	g_autoptr(GArray) offsets = g_array_new(FALSE, FALSE, sizeof(guint32));
+	XbSiloColumnsHeader chdr = {0x0};
+	const guint16 pad16 = G_MAXUINT16;
+	const guint32 pad32 = 0;
+
+	/* element names are always at the start of the strtab, and so sorted */
+	if (ntags == 0)
+		return 0;
+	tags = g_new0(guint32, ntags);
+	for (guint i = 0; i < ntags; i++) {
+		tags[i] = off;
+		off += strlen((const gchar *)strtab->data + off) + 1;
+	}
+
+	/* nodes are in document order */
+	for (guint32 noff = sizeof(XbSiloHeader); noff < nodetabsz;) {
+		XbSiloNode *sn = xb_builder_get_node(buf, noff);
+		if (xb_silo_node_has_flag(sn, XB_SILO_NODE_FLAG_IS_ELEMENT)) {
+			guint16 depth = sn->depth;
+			guint16 lo = 0;
+			guint16 hi = ntags;
+			while (lo < hi) {
+				guint16 mid = lo + (hi - lo) / 2;
+				if (tags[mid] < sn->element_name)
+					lo = mid + 1;
+				else
+					hi = mid;
+			}
+			g_array_append_val(ids, lo);
+			g_array_append_val(depths, depth);
+			g_array_append_val(offsets, noff);
 		}
+		noff += xb_silo_node_get_size(sn);
+	}
+	if (ids->len == 0)
+		return 0;
+
+	/* pad so the SIMD loads never run off the end */
+	chdr.n_nodes = ids->len;
+	chdr.n_padded = ((chdr.n_nodes + XB_SILO_COLUMN_PAD - 1) / XB_SILO_COLUMN_PAD) *
+			    XB_SILO_COLUMN_PAD +
+			XB_SILO_COLUMN_PAD;
+	for (guint i = chdr.n_nodes; i < chdr.n_padded; i++) {
+		g_array_append_val(ids, pad16);
+		g_array_append_val(depths, pad16);
+		g_array_append_val(offsets, pad32);
 	}
 
-	return FALSE;
+	/* align the columns in the file */
+	data_off = columns_off + sizeof(XbSiloColumnsHeader);
+	data_off = (data_off + XB_SILO_COLUMN_PAD - 1) & ~((guint32)XB_SILO_COLUMN_PAD - 1);
+	chdr.data = data_off - columns_off;
+	g_byte_array_append(buf, (const guint8 *)&chdr, sizeof(chdr));
+	for (guint32 i = buf->len; i < data_off; i++)
+		g_byte_array_append(buf, (const guint8 *)"", 1);
+	g_byte_array_append(buf, (const guint8 *)ids->data, ids->len * sizeof(guint16));
+	g_byte_array_append(buf, (const guint8 *)depths->data, depths->len * sizeof(guint16));
+	g_byte_array_append(buf, (const guint8 *)offsets->data, offsets->len * sizeof(guint32));
+	g_byte_array_append(buf, (const guint8 *)tags, ntags * sizeof(guint32));
+	return columns_off;
+}
+
+static void
+xb_builder_varint_append(GByteArray *buf, guint32 value)
+{
+	guint8 tmp[XB_SILO_VARINT_MAX];
+	guint sz = 0;
+	do {
+		tmp[sz] = value & 0x7f;
+		value >>= 7;
+		if (value != 0)
+			tmp[sz] |= 0x80;
+		sz++;
+	} while (value != 0);
+	g_byte_array_append(buf, tmp, sz);
+}
+
+static gint
+xb_builder_strtab_sort_cb(gconstpointer a, gconstpointer b, gpointer user_data)
+{
+	const gchar *strtab = (const gchar *)user_data;
+	return strcmp(strtab + *((const guint32 *)a), strtab + *((const guint32 *)b));
+}
+
+static guint32
+xb_builder_strtab_remap(GHashTable *remap, guint32 idx)
+{
+	gpointer value = NULL;
+	if (idx == XB_SILO_UNSET)
+		return idx;
+	if (!g_hash_table_lookup_extended(remap, GUINT_TO_POINTER(idx), NULL, &value))
+		return idx;
+	return GPOINTER_TO_UINT(value);
+}
+
+/* sorts every string after the element names so that shared prefixes are
+ * adjacent, and then fixes up the offsets used in the nodetab */
+static void
+xb_builder_strtab_sort(XbBuilderCompileHelper *helper,
+		       GByteArray *buf,
+		       guint16 ntags,
+		       guint32 nodetabsz)
+{
+	guint32 tagsz = 0;
+	GByteArray *strtab = g_byte_array_sized_new(helper->strtab->len);
+	GHashTableIter iter;
+	gpointer value;
+	g_autoptr(GArray) offsets = g_array_new(FALSE, FALSE, sizeof(guint32));
+	g_autoptr(GHashTable) remap = g_hash_table_new(g_direct_hash, g_direct_equal);
+
+	/* element names are always first, and stay where they are */
+	for (guint i = 0; i < ntags; i++)
+		tagsz += strlen((const gchar *)helper->strtab->data + tagsz) + 1;
+	for (guint32 off = tagsz; off < helper->strtab->len;) {
+		g_array_append_val(offsets, off);
+		off += strlen((const gchar *)helper->strtab->data + off) + 1;
+	}
+	g_array_sort_with_data(offsets, xb_builder_strtab_sort_cb, helper->strtab->data);
+	g_byte_array_append(strtab, helper->strtab->data, tagsz);
+	for (guint i = 0; i < offsets->len; i++) {
+		guint32 off = g_array_index(offsets, guint32, i);
+		const gchar *tmp = (const gchar *)helper->strtab->data + off;
+		g_hash_table_insert(remap, GUINT_TO_POINTER(off), GUINT_TO_POINTER(strtab->len));
+		g_byte_array_append(strtab, (const guint8 *)tmp, strlen(tmp) + 1);
+	}
+	g_byte_array_unref(helper->strtab);
+	helper->strtab = strtab;
+
+	/* fix up everything that refers to the strtab */
+	g_hash_table_iter_init(&iter, helper->strtab_hash);
+	while (g_hash_table_iter_next(&iter, NULL, &value)) {
+		guint32 idx = xb_builder_strtab_remap(remap, GPOINTER_TO_UINT(value));
+		g_hash_table_iter_replace(&iter, GUINT_TO_POINTER(idx));
+	}
+	for (guint32 off = sizeof(XbSiloHeader); off < nodetabsz;) {
+		XbSiloNode *sn = xb_builder_get_node(buf, off);
+		guint32 nodesz = xb_silo_node_get_size(sn);
+		if (xb_silo_node_has_flag(sn, XB_SILO_NODE_FLAG_IS_ELEMENT)) {
+			sn->text = xb_builder_strtab_remap(remap, sn->text);
+			sn->tail = xb_builder_strtab_remap(remap, sn->tail);
+
+			/* attrs and tokens */
+			for (guint32 i = sizeof(XbSiloNode); i < nodesz; i += sizeof(guint32)) {
+				guint32 tmp;
+				memcpy(&tmp, buf->data + off + i, sizeof(tmp));
+				tmp = xb_builder_strtab_remap(remap, tmp);
+				memcpy(buf->data + off + i, &tmp, sizeof(tmp));
+			}
+		}
+		off += nodesz;
+	}
+}
+
+/* appends the strtab with each string sharing a prefix with the previous */
+static void
+xb_builder_strtab_fc_write(GByteArray *buf, GByteArray *strtab)
+{
+	const gchar *prev = NULL;
+	guint32 n_strings = 0;
+	g_autoptr(GArray) restarts = g_array_new(FALSE, FALSE, sizeof(XbSiloStrtabFcRestart));
+	g_autoptr(GByteArray) data = g_byte_array_new();
+	XbSiloStrtabFcHeader fchdr = {
+	    .size = strtab->len,
+	};
+
+	for (guint32 off = 0; off < strtab->len; n_strings++) {
+		const gchar *tmp = (const gchar *)strtab->data + off;
+		guint32 len = strlen(tmp);
+		guint32 shared = 0;
+		if (n_strings % XB_SILO_STRTAB_FC_INTERVAL == 0) {
+			XbSiloStrtabFcRestart restart = {
+			    .offset = off,
+			    .data = data->len,
+			};
+			g_array_append_val(restarts, restart);
+		} else {
+			while (prev[shared] != '\0' && prev[shared] == tmp[shared])
+				shared++;
+		}
+		xb_builder_varint_append(data, shared);
+		xb_builder_varint_append(data, len - shared);
+		g_byte_array_append(data, (const guint8 *)tmp + shared, len - shared);
+		prev = tmp;
+		off += len + 1;
+	}
+	fchdr.n_strings = n_strings;
+	fchdr.n_restarts = restarts->len;
+	g_byte_array_append(buf, (const guint8 *)&fchdr, sizeof(fchdr));
+	g_byte_array_append(buf,
+			    (const guint8 *)restarts->data,
+			    restarts->len * sizeof(XbSiloStrtabFcRestart));
+	g_byte_array_append(buf, data->data, data->len);
+}
+
+/* re-encodes the fixed-size nodes using varints, leaving every other offset
+ * as it was so that the reader can expand the nodetab in place */
+static GByteArray *
+xb_builder_nodetab_compact(GByteArray *buf, guint32 nodetabsz)
+{
+	GByteArray *compact = g_byte_array_sized_new(buf->len);
+	XbSiloHeader *hdrptr;
+
+	g_byte_array_append(compact, buf->data, sizeof(XbSiloHeader));
+	for (guint32 off = sizeof(XbSiloHeader); off < nodetabsz;) {
+		XbSiloNode *sn = xb_builder_get_node(buf, off);
+		guint32 nodesz = xb_silo_node_get_size(sn);
+
+		/* flags and attr_count */
+		g_byte_array_append(compact, buf->data + off, sizeof(guint8));
+		if (xb_silo_node_has_flag(sn, XB_SILO_NODE_FLAG_IS_ELEMENT)) {
+			g_byte_array_append(compact, &sn->token_count, sizeof(guint8));
+			xb_builder_varint_append(compact, sn->element_name + 1);
+			xb_builder_varint_append(compact, sn->parent != 0 ? off - sn->parent : 0);
+			xb_builder_varint_append(compact, sn->next != 0 ? sn->next - off : 0);
+			xb_builder_varint_append(compact, sn->text + 1);
+			xb_builder_varint_append(compact, sn->tail + 1);
+			xb_builder_varint_append(compact, sn->end - off);
+			xb_builder_varint_append(compact, sn->depth);
+			for (guint32 i = sizeof(XbSiloNode); i < nodesz; i += sizeof(guint32)) {
+				guint32 tmp;
+				memcpy(&tmp, buf->data + off + i, sizeof(tmp));
+				xb_builder_varint_append(compact, tmp + 1);
+			}
+		}
+		off += nodesz;
+	}
+	g_byte_array_append(compact, buf->data + nodetabsz, buf->len - nodetabsz);
+
+	hdrptr = (XbSiloHeader *)compact->data;
+	hdrptr->flags |= XB_SILO_HEADER_FLAG_COMPACT_NODETAB;
+	hdrptr->filesz = compact->len;
+	return compact;
 }
 
 static void
@@ -707,7 +1661,7 @@ xb_builder_compile_helper_free(XbBuilderCompileHelper *helper)
 	g_byte_array_unref(helper->strtab);
 	g_clear_error(&helper->error);
 	g_clear_object(&helper->silo);
-	g_object_unref(helper->root);
+	g_clear_object(&helper->root);
 	g_free(helper);
 }
 
@@ -724,6 +1678,16 @@ xb_builder_generate_guid(XbBuilder *self)
 	return xb_guid_to_string(&guid);
 }
 
+static void
+xb_builder_header_set_guid(XbSiloHeader *hdr, GString *guid)
+{
+	if (guid->len > 0) {
+		XbGuid guid_tmp;
+		xb_guid_compute_for_data(&guid_tmp, (const guint8 *)guid->str, guid->len);
+		memcpy(&hdr->guid, &guid_tmp, sizeof(guid_tmp));
+	}
+}
+
 /**
  * xb_builder_import_node:
  * @self: a #XbSilo
@@ -783,6 +1747,18 @@ xb_builder_add_locale(XbBuilder *self, const gchar *locale)
 	xb_builder_append_guid(self, locale);
 }
 
+/* the builder needs to know the locales */
+static void
+xb_builder_ensure_locales(XbBuilder *self, XbBuilderCompileFlags flags)
+{
+	XbBuilderPrivate *priv = GET_PRIVATE(self);
+	if (priv->locales->len == 0 && (flags & XB_BUILDER_COMPILE_FLAG_NATIVE_LANGS)) {
+		const gchar *const *locales = g_get_language_names();
+		for (guint i = 0; locales[i] != NULL; i++)
+			xb_builder_add_locale(self, locales[i]);
+	}
+}
+
 static gboolean
 xb_builder_watch_source(XbBuilder *self,
 			XbBuilderSource *source,
@@ -818,6 +1794,88 @@ xb_builder_watch_sources(XbBuilder *self, XbSilo *silo, GCancellable *cancellabl
 	return TRUE;
 }
 
+/* appends the strtab and the lookup tables to the nodetab, and then loads the
+ * result into the silo of @helper */
+static gboolean
+xb_builder_compile_finish(XbBuilderCompileHelper *helper,
+			  GByteArray *nodetab,
+			  guint16 strtab_ntags,
+			  GTimer *timer,
+			  GError **error)
+{
+	g_autoptr(GByteArray) buf = nodetab;
+	g_autoptr(GBytes) blob = NULL;
+	guint32 nodetabsz = ((XbSiloHeader *)nodetab->data)->strtab;
+	guint32 postings = 0;
+	guint32 strindex = 0;
+	guint32 tagtab;
+	guint32 columns = 0;
+	XbSiloHeader *hdrptr;
+
+	/* append the string table */
+	if (helper->compile_flags & XB_BUILDER_COMPILE_FLAG_FRONT_CODED_STRTAB) {
+		xb_builder_strtab_sort(helper, buf, strtab_ntags, nodetabsz);
+		xb_silo_add_profile(helper->silo, timer, "sorting strtab");
+		xb_builder_strtab_fc_write(buf, helper->strtab);
+		((XbSiloHeader *)buf->data)->flags |= XB_SILO_HEADER_FLAG_FRONT_CODED_STRTAB;
+	} else {
+		g_byte_array_append(buf,
+				    (const guint8 *)helper->strtab->data,
+				    helper->strtab->len);
+	}
+	xb_silo_add_profile(helper->silo, timer, "appending strtab");
+
+	/* append the element posting lists */
+	if (helper->compile_flags & XB_BUILDER_COMPILE_FLAG_POSTINGS) {
+		postings = xb_builder_postings_write(buf, nodetabsz);
+		xb_silo_add_profile(helper->silo, timer, "appending postings");
+	}
+
+	/* append the string index */
+	if (helper->compile_flags & XB_BUILDER_COMPILE_FLAG_STRTAB_INDEX) {
+		strindex = xb_builder_strindex_write(buf, helper->strtab_hash);
+		xb_silo_add_profile(helper->silo, timer, "appending strindex");
+	}
+
+	/* append the element name perfect hash */
+	tagtab = xb_builder_tagtab_write(buf, helper->strtab, strtab_ntags);
+	xb_silo_add_profile(helper->silo, timer, "appending tagtab");
+
+	/* append the element columns */
+	if (helper->compile_flags & XB_BUILDER_COMPILE_FLAG_ELEMENT_COLUMNS) {
+		columns =
+		    xb_builder_columns_write(buf, helper->strtab, strtab_ntags, nodetabsz);
+		xb_silo_add_profile(helper->silo, timer, "appending columns");
+	}
+
+	/* update the file size */
+	hdrptr = (XbSiloHeader *)buf->data;
+	hdrptr->postings = postings;
+	hdrptr->strindex = strindex;
+	hdrptr->tagtab = tagtab;
+	hdrptr->columns = columns;
+	hdrptr->filesz = buf->len;
+
+	/* re-encode the nodetab */
+	if (helper->compile_flags & XB_BUILDER_COMPILE_FLAG_COMPACT_NODETAB) {
+		g_autoptr(GByteArray) buf_fixed = g_steal_pointer(&buf);
+		buf = xb_builder_nodetab_compact(buf_fixed, nodetabsz);
+		xb_silo_add_profile(helper->silo, timer, "compacting nodetab");
+	}
+
+	/* this has to be last */
+	hdrptr = (XbSiloHeader *)buf->data;
+	hdrptr->checksum = xb_silo_compute_checksum(buf->data, buf->len);
+	xb_silo_add_profile(helper->silo, timer, "computing checksum");
+
+	/* create data */
+	blob = g_byte_array_free_to_bytes(g_steal_pointer(&buf));
+	if (!xb_silo_load_from_bytes(helper->silo, blob, XB_SILO_LOAD_FLAG_NONE, error))
+		return FALSE;
+
+	return TRUE;
+}
+
 /**
  * xb_builder_compile:
  * @self: a #XbSilo
@@ -840,237 +1898,1553 @@ xb_builder_compile(XbBuilder *self,
 	XbBuilderPrivate *priv = GET_PRIVATE(self);
 	guint32 nodetabsz = sizeof(XbSiloHeader);
 	g_autoptr(GByteArray) buf = NULL;
-	g_autoptr(GBytes) blob = NULL;
-	XbSiloHeader *hdrptr;
 	XbSiloHeader hdr = {
 	    .magic = XB_SILO_MAGIC_BYTES,
 	    .version = XB_SILO_VERSION,
 	    .strtab = 0,
 	    .strtab_ntags = 0,
-	    .padding = {0x0},
+	    .flags = XB_SILO_HEADER_FLAG_NONE,
 	    .guid = {0x0},
 	    .filesz = 0x0,
+	    .postings = 0x0,
+	    .strindex = 0x0,
+	    .tagtab = 0x0,
+	    .columns = 0x0,
+	    .checksum = 0x0,
 	};
 	XbBuilderNodetabHelper nodetab_helper = {
 	    .buf = NULL,
 	};
+	g_autoptr(GPtrArray) strtab_attrs = g_ptr_array_new();
+	g_autoptr(GPtrArray) strtab_texts = g_ptr_array_new();
+	g_autoptr(GPtrArray) strtab_tokens = g_ptr_array_new();
+	XbBuilderStrtabHelper strtab_helper = {
+	    .nodetabsz = sizeof(XbSiloHeader),
+	    .attrs = strtab_attrs,
+	    .texts = strtab_texts,
+	    .tokens = strtab_tokens,
+	};
 	g_autoptr(GPtrArray) nodes_to_destroy =
 	    g_ptr_array_new_with_free_func((GDestroyNotify)g_object_unref);
 	g_autoptr(GTimer) timer = NULL;
+	g_autoptr(GPtrArray) jobs = NULL;
 	g_autoptr(XbBuilderCompileHelper) helper = NULL;
+	guint max_threads = priv->max_threads;
+	guint tokenize_len = 0;
 
 	g_return_val_if_fail(XB_IS_BUILDER(self), NULL);
 	g_return_val_if_fail(cancellable == NULL || G_IS_CANCELLABLE(cancellable), NULL);
 	g_return_val_if_fail(error == NULL || *error == NULL, NULL);
 
+	/* use all the cores */
+	if (max_threads == 0)
+		max_threads = g_get_num_processors();
+
 	/* this is inferred */
 	if (flags & XB_BUILDER_COMPILE_FLAG_SINGLE_LANG)
 		flags |= XB_BUILDER_COMPILE_FLAG_NATIVE_LANGS;
 
-	/* the builder needs to know the locales */
-	if (priv->locales->len == 0 && (flags & XB_BUILDER_COMPILE_FLAG_NATIVE_LANGS)) {
-		const gchar *const *locales = g_get_language_names();
-		for (guint i = 0; locales[i] != NULL; i++)
-			xb_builder_add_locale(self, locales[i]);
+	xb_builder_ensure_locales(self, flags);
+
+	/* create helper used for compiling */
+	helper = g_new0(XbBuilderCompileHelper, 1);
+	helper->compile_flags = flags;
+	helper->root = xb_builder_node_new(NULL);
+	helper->silo = xb_silo_new();
+	helper->locales = priv->locales;
+	helper->strtab = g_byte_array_new();
+	helper->strtab_hash = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+	helper->elem_closed = FALSE;
+	helper->lang_filter =
+	    (flags & XB_BUILDER_COMPILE_FLAG_SINGLE_LANG) > 0 && priv->fixups->len == 0;
+
+	/* reuse the sources that have already been parsed */
+	if (priv->fragment_cache != NULL) {
+		g_autoptr(GError) error_local = NULL;
+		if (g_file_make_directory_with_parents(priv->fragment_cache,
+						       cancellable,
+						       &error_local) ||
+		    g_error_matches(error_local, G_IO_ERROR, G_IO_ERROR_EXISTS)) {
+			helper->fragment_cache = priv->fragment_cache;
+		} else {
+			g_debug("not using fragment cache: %s", error_local->message);
+		}
+	}
+
+	/* for profiling */
+	xb_silo_set_profile_flags(helper->silo, priv->profile_flags);
+	timer = xb_silo_start_profile(helper->silo);
+
+	/* parse each source into its own fake root */
+	jobs = g_ptr_array_new_with_free_func((GDestroyNotify)xb_builder_compile_job_free);
+	for (guint i = 0; i < priv->sources->len; i++) {
+		XbBuilderSource *source = g_ptr_array_index(priv->sources, i);
+		XbBuilderCompileJob *job = g_new0(XbBuilderCompileJob, 1);
+		job->source = g_object_ref(source);
+		job->root_tmp = xb_builder_node_new(NULL);
+		job->arena = xb_builder_string_arena_new();
+		job->cancellable = cancellable;
+		g_ptr_array_add(jobs, job);
+	}
+	if (max_threads > 1 && jobs->len > 1) {
+		GThreadPool *pool;
+		pool = g_thread_pool_new(xb_builder_compile_job_cb,
+					 helper,
+					 MIN(max_threads, jobs->len),
+					 FALSE,
+					 error);
+		if (pool == NULL)
+			return NULL;
+		for (guint i = 0; i < jobs->len; i++) {
+			XbBuilderCompileJob *job = g_ptr_array_index(jobs, i);
+			if (!g_thread_pool_push(pool, job, error)) {
+				g_thread_pool_free(pool, FALSE, TRUE);
+				return NULL;
+			}
+		}
+		g_thread_pool_free(pool, FALSE, TRUE);
+		xb_silo_add_profile(helper->silo, timer, "parse %u sources", jobs->len);
+	}
+
+	/* build node tree, always in source order */
+	for (guint i = 0; i < jobs->len; i++) {
+		XbBuilderCompileJob *job = g_ptr_array_index(jobs, i);
+		XbBuilderSource *source = job->source;
+		const gchar *prefix = xb_builder_source_get_prefix(source);
+		g_autofree gchar *source_guid = xb_builder_source_get_guid(source);
+		g_autoptr(XbBuilderNode) root = NULL;
+
+		/* find, or create the prefix */
+		if (prefix != NULL) {
+			root = xb_builder_node_get_child(helper->root, prefix, NULL);
+			if (root == NULL)
+				root = xb_builder_node_insert(helper->root, prefix, NULL);
+		} else {
+			/* don't allow damaged XML files to ruin all the next ones */
+			root = g_object_ref(helper->root);
+		}
+
+		/* watch the source */
+		if (!xb_builder_watch_source(self, source, helper->silo, cancellable, error))
+			return NULL;
+
+		/* not already done by the thread pool */
+		if (job->timer == NULL) {
+			if (priv->profile_flags & XB_SILO_PROFILE_FLAG_DEBUG)
+				g_debug("compiling %s…", source_guid);
+			xb_builder_compile_job_cb(job, helper);
+		}
+		if (job->error != NULL) {
+			if (flags & XB_BUILDER_COMPILE_FLAG_IGNORE_INVALID) {
+				g_debug("ignoring invalid file %s: %s",
+					source_guid,
+					job->error->message);
+				continue;
+			}
+			g_propagate_prefixed_error(error,
+						   g_steal_pointer(&job->error),
+						   "failed to compile %s: ",
+						   source_guid);
+			return NULL;
+		}
+		xb_builder_compile_source_graft(job->root_tmp, root);
+		xb_silo_add_profile(helper->silo,
+				    job->timer,
+				    job->fragment_loaded ? "load fragment %s" : "compile %s",
+				    source_guid);
+	}
+	if (helper->fragment_cache != NULL)
+		xb_builder_fragment_cache_prune(helper->fragment_cache, jobs, cancellable);
+
+	/* run any node functions */
+	if (!xb_builder_fixup_nodes(priv->fixups, helper->root, error))
+		return NULL;
+
+	/* only include the highest priority translation */
+	if (flags & XB_BUILDER_COMPILE_FLAG_SINGLE_LANG) {
+		xb_builder_node_traverse(helper->root,
+					 G_PRE_ORDER,
+					 G_TRAVERSE_ALL,
+					 -1,
+					 xb_builder_xml_lang_prio_cb,
+					 nodes_to_destroy);
+		for (guint i = 0; i < nodes_to_destroy->len; i++) {
+			XbBuilderNode *bn = g_ptr_array_index(nodes_to_destroy, i);
+			xb_builder_node_unlink(bn);
+		}
+		xb_silo_add_profile(helper->silo, timer, "filter single-lang");
+	}
+
+	/* add any manually build nodes */
+	for (guint i = 0; i < priv->nodes->len; i++) {
+		XbBuilderNode *bn = g_ptr_array_index(priv->nodes, i);
+		xb_builder_node_add_child(helper->root, bn);
+	}
+
+	/* tokens are added to the strtab in tree order, so this is deterministic */
+	if (!xb_builder_tokenize(helper->root, max_threads, &tokenize_len, error))
+		return NULL;
+	if (tokenize_len > 0)
+		xb_silo_add_profile(helper->silo, timer, "tokenize %u nodes", tokenize_len);
+
+	/* get the size of the nodetab and add everything to the strtab */
+	strtab_helper.helper = helper;
+	xb_builder_node_traverse(helper->root,
+				 G_PRE_ORDER,
+				 G_TRAVERSE_ALL,
+				 -1,
+				 xb_builder_strtab_cb,
+				 &strtab_helper);
+	if (helper->error != NULL) {
+		g_propagate_error(error, g_steal_pointer(&helper->error));
+		return NULL;
+	}
+	if (g_hash_table_size(helper->strtab_hash) > G_MAXUINT16) {
+		g_set_error_literal(error,
+				    G_IO_ERROR,
+				    G_IO_ERROR_INVALID_DATA,
+				    "too many unique element names for strtab");
+		return NULL;
+	}
+	nodetabsz = strtab_helper.nodetabsz;
+	buf = g_byte_array_sized_new(nodetabsz);
+	hdr.strtab_ntags = (guint16)g_hash_table_size(helper->strtab_hash);
+	xb_silo_add_profile(helper->silo, timer, "get size nodetab, adding strtab element");
+	if (!xb_builder_strtab_add_attr_names(helper, strtab_helper.attrs)) {
+		g_propagate_error(error, g_steal_pointer(&helper->error));
+		return NULL;
+	}
+	xb_silo_add_profile(helper->silo, timer, "adding strtab attr name");
+	if (!xb_builder_strtab_add_attr_values(helper, strtab_helper.attrs)) {
+		g_propagate_error(error, g_steal_pointer(&helper->error));
+		return NULL;
+	}
+	xb_silo_add_profile(helper->silo, timer, "adding strtab attr value");
+	if (!xb_builder_strtab_add_texts(helper, strtab_helper.texts)) {
+		g_propagate_error(error, g_steal_pointer(&helper->error));
+		return NULL;
+	}
+	xb_silo_add_profile(helper->silo, timer, "adding strtab text");
+	if (!xb_builder_strtab_add_tokens(helper, strtab_helper.tokens)) {
+		g_propagate_error(error, g_steal_pointer(&helper->error));
+		return NULL;
+	}
+	xb_silo_add_profile(helper->silo, timer, "adding strtab tokens");
+
+	/* add the initial header */
+	hdr.strtab = nodetabsz;
+	xb_builder_header_set_guid(&hdr, priv->guid);
+	g_byte_array_append(buf, (const guint8 *)&hdr, sizeof(hdr));
+
+	/* write nodes to the nodetab */
+	nodetab_helper.buf = buf;
+	if (!xb_builder_nodetab_write(&nodetab_helper, helper->root, 0, error))
+		return NULL;
+	xb_silo_add_profile(helper->silo, timer, "writing nodetab");
+
+	/* add the lookup tables */
+	if (!xb_builder_compile_finish(helper,
+				       g_steal_pointer(&buf),
+				       hdr.strtab_ntags,
+				       timer,
+				       error))
+		return NULL;
+
+	/* success */
+	return g_steal_pointer(&helper->silo);
+}
+
+/* replaces an offset in the strtab of @silo with one in the merged strtab */
+static gboolean
+xb_builder_merge_str(XbBuilderCompileHelper *helper, XbSilo *silo, guint32 *idx, GError **error)
+{
+	const gchar *str;
+
+	if (*idx == XB_SILO_UNSET)
+		return TRUE;
+	str = xb_silo_from_strtab(silo, *idx, error);
+	if (str == NULL)
+		return FALSE;
+	*idx = xb_builder_compile_add_to_strtab(helper, str);
+	if (*idx == XB_SILO_UNSET) {
+		g_propagate_error(error, g_steal_pointer(&helper->error));
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/* copies one node from @silo, moving it by @delta and up by @depth levels,
+ * and remapping the strings */
+static gboolean
+xb_builder_merge_node(XbBuilderCompileHelper *helper,
+		      GByteArray *buf,
+		      XbSilo *silo,
+		      XbSiloNode *sn,
+		      guint32 delta,
+		      guint16 depth,
+		      GError **error)
+{
+	guint32 off = buf->len;
+	guint32 nodesz = xb_silo_node_get_size(sn);
+	guint32 element_name = sn->element_name;
+	guint32 text = sn->text;
+	guint32 tail = sn->tail;
+	XbSiloNode *dn;
+
+	g_byte_array_append(buf, (const guint8 *)sn, nodesz);
+	if (!xb_silo_node_has_flag(sn, XB_SILO_NODE_FLAG_IS_ELEMENT))
+		return TRUE;
+	if (!xb_builder_merge_str(helper, silo, &element_name, error))
+		return FALSE;
+	if (!xb_builder_merge_str(helper, silo, &text, error))
+		return FALSE;
+	if (!xb_builder_merge_str(helper, silo, &tail, error))
+		return FALSE;
+	dn = xb_builder_get_node(buf, off);
+	dn->element_name = element_name;
+	dn->text = text;
+	dn->tail = tail;
+	if (dn->parent != 0)
+		dn->parent += delta;
+	if (dn->next != 0)
+		dn->next += delta;
+	dn->end += delta;
+	if (dn->depth != G_MAXUINT16)
+		dn->depth -= depth;
+
+	/* attrs and tokens */
+	for (guint32 i = sizeof(XbSiloNode); i < nodesz; i += sizeof(guint32)) {
+		guint32 tmp;
+		memcpy(&tmp, buf->data + off + i, sizeof(tmp));
+		if (!xb_builder_merge_str(helper, silo, &tmp, error))
+			return FALSE;
+		memcpy(buf->data + off + i, &tmp, sizeof(tmp));
+	}
+	return TRUE;
+}
+
+typedef struct {
+	XbSilo *silo;	/* no ref */
+	guint32 start;	/* offset of the first node */
+	guint32 end;	/* offset after the last node */
+} XbBuilderMergeRange;
+
+/* copies each range of nodes into a new silo, where the nodes at the top of
+ * each range become the root nodes */
+static XbSilo *
+xb_builder_merge_ranges(XbBuilder *self,
+			GArray *ranges,
+			XbBuilderCompileFlags flags,
+			GCancellable *cancellable,
+			GError **error)
+{
+	XbBuilderPrivate *priv = GET_PRIVATE(self);
+	guint32 prev_root = 0;
+	XbSiloHeader hdr = {
+	    .magic = XB_SILO_MAGIC_BYTES,
+	    .version = XB_SILO_VERSION,
+	    .flags = XB_SILO_HEADER_FLAG_NONE,
+	};
+	g_autoptr(GByteArray) buf = g_byte_array_new();
+	g_autoptr(GString) guid = g_string_new(NULL);
+	g_autoptr(GTimer) timer = NULL;
+	g_autoptr(XbBuilderCompileHelper) helper = NULL;
+
+	helper = g_new0(XbBuilderCompileHelper, 1);
+	helper->compile_flags = flags;
+	helper->silo = xb_silo_new();
+	helper->strtab = g_byte_array_new();
+	helper->strtab_hash = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+	xb_silo_set_profile_flags(helper->silo, priv->profile_flags);
+	timer = xb_silo_start_profile(helper->silo);
+
+	/* element names have to be first in the strtab */
+	for (guint i = 0; i < ranges->len; i++) {
+		XbBuilderMergeRange *range = &g_array_index(ranges, XbBuilderMergeRange, i);
+		for (guint32 off = range->start; off < range->end;) {
+			XbSiloNode *sn = xb_silo_get_node(range->silo, off, error);
+			if (sn == NULL)
+				return NULL;
+			if (xb_silo_node_has_flag(sn, XB_SILO_NODE_FLAG_IS_ELEMENT)) {
+				guint32 element_name = sn->element_name;
+				if (!xb_builder_merge_str(helper,
+							  range->silo,
+							  &element_name,
+							  error))
+					return NULL;
+			}
+			off += xb_silo_node_get_size(sn);
+		}
+		g_string_append_printf(guid,
+				       "%s@%u:",
+				       xb_silo_get_guid(range->silo),
+				       (guint)range->start);
+	}
+	if (g_hash_table_size(helper->strtab_hash) > G_MAXUINT16) {
+		g_set_error_literal(error,
+				    G_IO_ERROR,
+				    G_IO_ERROR_INVALID_DATA,
+				    "too many unique element names for strtab");
+		return NULL;
+	}
+	hdr.strtab_ntags = (guint16)g_hash_table_size(helper->strtab_hash);
+	xb_silo_add_profile(helper->silo, timer, "adding strtab element");
+
+	/* copy the nodes, chaining the roots of each range onto the last */
+	g_byte_array_append(buf, (const guint8 *)&hdr, sizeof(hdr));
+	for (guint i = 0; i < ranges->len; i++) {
+		XbBuilderMergeRange *range = &g_array_index(ranges, XbBuilderMergeRange, i);
+		guint32 delta = buf->len - range->start;
+		guint16 depth = 0;
+
+		if (g_cancellable_set_error_if_cancelled(cancellable, error))
+			return NULL;
+		for (guint32 off = range->start; off < range->end;) {
+			XbSiloNode *sn = xb_silo_get_node(range->silo, off, error);
+			gboolean is_root;
+			if (sn == NULL)
+				return NULL;
+			is_root = xb_silo_node_has_flag(sn, XB_SILO_NODE_FLAG_IS_ELEMENT) &&
+				  sn->parent < range->start;
+			if (is_root) {
+				XbSiloNode *prev = NULL;
+				if (off == range->start)
+					depth = sn->depth;
+				if (prev_root != 0)
+					prev = xb_builder_get_node(buf, prev_root);
+				if (prev != NULL && prev->next == 0)
+					prev->next = buf->len;
+				prev_root = buf->len;
+			}
+			if (!xb_builder_merge_node(helper,
+						   buf,
+						   range->silo,
+						   sn,
+						   delta,
+						   depth,
+						   error))
+				return NULL;
+			if (is_root) {
+				XbSiloNode *dn = xb_builder_get_node(buf, prev_root);
+				dn->parent = 0;
+				if (sn->next < range->start || sn->next >= range->end)
+					dn->next = 0;
+			}
+			off += xb_silo_node_get_size(sn);
+		}
+	}
+	xb_silo_add_profile(helper->silo, timer, "copying %u nodetab ranges", ranges->len);
+
+	/* update the header */
+	hdr.strtab = buf->len;
+	xb_builder_header_set_guid(&hdr, guid);
+	memcpy(buf->data, &hdr, sizeof(hdr));
+
+	/* add the lookup tables */
+	if (!xb_builder_compile_finish(helper,
+				       g_steal_pointer(&buf),
+				       hdr.strtab_ntags,
+				       timer,
+				       error))
+		return NULL;
+
+	/* success */
+	return g_steal_pointer(&helper->silo);
+}
+
+/**
+ * xb_builder_merge:
+ * @self: a #XbBuilder
+ * @silos: (element-type XbSilo): the silos to merge
+ * @flags: some #XbBuilderCompileFlags, e.g. %XB_BUILDER_COMPILE_FLAG_NONE
+ * @cancellable: a #GCancellable, or %NULL
+ * @error: the #GError, or %NULL
+ *
+ * Merges already compiled silos without exporting them as XML. The root
+ * nodes of each silo are added in order, and strings used by more than one
+ * silo are only stored once.
+ *
+ * Only the flags that change the silo format are used, e.g.
+ * %XB_BUILDER_COMPILE_FLAG_COMPACT_NODETAB. The sources, nodes and fixups
+ * added to @self are not used.
+ *
+ * Returns: (transfer full): a #XbSilo, or %NULL for error
+ *
+ * Since: 0.3.30
+ **/
+XbSilo *
+xb_builder_merge(XbBuilder *self,
+		 GPtrArray *silos,
+		 XbBuilderCompileFlags flags,
+		 GCancellable *cancellable,
+		 GError **error)
+{
+	g_autoptr(GArray) ranges = g_array_new(FALSE, FALSE, sizeof(XbBuilderMergeRange));
+
+	g_return_val_if_fail(XB_IS_BUILDER(self), NULL);
+	g_return_val_if_fail(silos != NULL, NULL);
+	g_return_val_if_fail(cancellable == NULL || G_IS_CANCELLABLE(cancellable), NULL);
+	g_return_val_if_fail(error == NULL || *error == NULL, NULL);
+
+	for (guint i = 0; i < silos->len; i++) {
+		XbSilo *silo = g_ptr_array_index(silos, i);
+		XbBuilderMergeRange range = {
+		    .silo = silo,
+		    .start = sizeof(XbSiloHeader),
+		    .end = xb_silo_get_strtab(silo),
+		};
+		g_return_val_if_fail(XB_IS_SILO(silo), NULL);
+		g_array_append_val(ranges, range);
+	}
+	return xb_builder_merge_ranges(self, ranges, flags, cancellable, error);
+}
+
+/**
+ * xb_builder_extract:
+ * @self: a #XbBuilder
+ * @nodes: (element-type XbNode): the nodes to copy, e.g. from xb_silo_query()
+ * @flags: some #XbBuilderCompileFlags, e.g. %XB_BUILDER_COMPILE_FLAG_NONE
+ * @cancellable: a #GCancellable, or %NULL
+ * @error: the #GError, or %NULL
+ *
+ * Creates a silo from the subtrees of existing nodes without exporting them
+ * as XML. Each node becomes a root node in the new silo, in order, and only
+ * the strings used by the copied subtrees are included.
+ *
+ * The nodes can come from different silos, but a node should not be a
+ * descendant of another node in @nodes as it would be copied twice.
+ *
+ * Only the flags that change the silo format are used, e.g.
+ * %XB_BUILDER_COMPILE_FLAG_COMPACT_NODETAB. The sources, nodes and fixups
+ * added to @self are not used.
+ *
+ * Returns: (transfer full): a #XbSilo, or %NULL for error
+ *
+ * Since: 0.3.30
+ **/
+XbSilo *
+xb_builder_extract(XbBuilder *self,
+		   GPtrArray *nodes,
+		   XbBuilderCompileFlags flags,
+		   GCancellable *cancellable,
+		   GError **error)
+{
+	g_autoptr(GArray) ranges = g_array_new(FALSE, FALSE, sizeof(XbBuilderMergeRange));
+
+	g_return_val_if_fail(XB_IS_BUILDER(self), NULL);
+	g_return_val_if_fail(nodes != NULL, NULL);
+	g_return_val_if_fail(cancellable == NULL || G_IS_CANCELLABLE(cancellable), NULL);
+	g_return_val_if_fail(error == NULL || *error == NULL, NULL);
+
+	for (guint i = 0; i < nodes->len; i++) {
+		XbNode *n = g_ptr_array_index(nodes, i);
+		XbSiloNode *sn;
+		XbBuilderMergeRange range = {0};
+
+		g_return_val_if_fail(XB_IS_NODE(n), NULL);
+		sn = xb_node_get_sn(n);
+		range.silo = xb_node_get_silo(n);
+		range.start = xb_silo_get_offset_for_node(range.silo, sn);
+		range.end = sn->end;
+		g_array_append_val(ranges, range);
+	}
+	return xb_builder_merge_ranges(self, ranges, flags, cancellable, error);
+}
+
+/* nodes are written as soon as they are parsed, so only the open elements and
+ * the last part of the nodetab are kept in memory */
+#define XB_BUILDER_STREAM_BUFSZ (1024 * 1024)
+
+typedef struct {
+	XbBuilderNode *bn;	   /* transfer full */
+	guint32 offset;		   /* 0 if not written */
+	gboolean text_done;	   /* ->text has been written */
+	XbBuilderNode *last_child; /* transfer full, gets any tail */
+	guint32 last_child_offset; /* 0 if not written */
+	guint32 prev_offset;	   /* last written child, for ->next */
+} XbBuilderStreamLevel;
+
+typedef struct {
+	GIOStream *iostream;	   /* transfer none */
+	GCancellable *cancellable; /* transfer none */
+	GByteArray *buf;	   /* everything after @buf_offset */
+	guint32 buf_offset;
+	gboolean truncate;
+	GByteArray *tags;      /* element names, always first in the strtab */
+	GHashTable *tags_hash; /* str : offset in tags */
+	GHashTable *strs_hash; /* str : offset after tags */
+	GPtrArray *strs;       /* of str, in strtab order */
+	guint32 strs_len;
+	GPtrArray *stack;      /* of XbBuilderStreamLevel */
+	GHashTable *root_elements;
+	XbBuilderCompileFlags compile_flags;
+	XbBuilderSourceFlags source_flags;
+	GPtrArray *locales;
+	XbBuilderNode *info; /* transfer none */
+	guint container;     /* level that sources are added to */
+	guint ignore_depth;
+	guint root_cnt;
+	gboolean elem_closed;
+} XbBuilderStreamHelper;
+
+static void
+xb_builder_stream_level_free(XbBuilderStreamLevel *level)
+{
+	if (level->bn != NULL)
+		g_object_unref(level->bn);
+	if (level->last_child != NULL)
+		g_object_unref(level->last_child);
+	g_free(level);
+}
+
+static void
+xb_builder_stream_helper_free(XbBuilderStreamHelper *helper)
+{
+	g_byte_array_unref(helper->buf);
+	g_byte_array_unref(helper->tags);
+	g_hash_table_unref(helper->tags_hash);
+	g_hash_table_unref(helper->strs_hash);
+	g_ptr_array_unref(helper->strs);
+	g_ptr_array_unref(helper->stack);
+	g_hash_table_unref(helper->root_elements);
+	g_free(helper);
+}
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(XbBuilderStreamHelper, xb_builder_stream_helper_free)
+
+static XbBuilderStreamLevel *
+xb_builder_stream_get_level(XbBuilderStreamHelper *helper)
+{
+	return g_ptr_array_index(helper->stack, helper->stack->len - 1);
+}
+
+static guint32
+xb_builder_stream_get_offset(XbBuilderStreamHelper *helper)
+{
+	return helper->buf_offset + helper->buf->len;
+}
+
+static gboolean
+xb_builder_stream_flush(XbBuilderStreamHelper *helper, GError **error)
+{
+	GOutputStream *ostream = g_io_stream_get_output_stream(helper->iostream);
+	if (!g_output_stream_write_all(ostream,
+				       helper->buf->data,
+				       helper->buf->len,
+				       NULL,
+				       helper->cancellable,
+				       error))
+		return FALSE;
+	helper->buf_offset += helper->buf->len;
+	g_byte_array_set_size(helper->buf, 0);
+	return TRUE;
+}
+
+/* nodes are never split by a flush, so a field is either in memory or on disk */
+static gboolean
+xb_builder_stream_patch(XbBuilderStreamHelper *helper,
+			guint32 offset,
+			guint32 value,
+			GError **error)
+{
+	GOutputStream *ostream = g_io_stream_get_output_stream(helper->iostream);
+
+	if (offset >= helper->buf_offset) {
+		memcpy(helper->buf->data + offset - helper->buf_offset, &value, sizeof(value));
+		return TRUE;
+	}
+	if (!g_seekable_seek(G_SEEKABLE(helper->iostream),
+			     offset,
+			     G_SEEK_SET,
+			     helper->cancellable,
+			     error))
+		return FALSE;
+	if (!g_output_stream_write_all(ostream,
+				       &value,
+				       sizeof(value),
+				       NULL,
+				       helper->cancellable,
+				       error))
+		return FALSE;
+	return g_seekable_seek(G_SEEKABLE(helper->iostream),
+			       helper->buf_offset,
+			       G_SEEK_SET,
+			       helper->cancellable,
+			       error);
+}
+
+static guint32
+xb_builder_stream_add_tag(XbBuilderStreamHelper *helper, const gchar *str)
+{
+	gpointer val;
+	guint32 idx;
+	if (g_hash_table_lookup_extended(helper->tags_hash, str, NULL, &val))
+		return GPOINTER_TO_UINT(val);
+	idx = helper->tags->len;
+	g_byte_array_append(helper->tags, (const guint8 *)str, strlen(str) + 1);
+	g_hash_table_insert(helper->tags_hash, g_strdup(str), GUINT_TO_POINTER(idx));
+	return idx;
+}
+
+/* the offset is relative to the end of the element names until the nodetab is
+ * rebased, as the number of element names is not known until the end */
+static guint32
+xb_builder_stream_add_str(XbBuilderStreamHelper *helper, const gchar *str, GError **error)
+{
+	gpointer val;
+	gchar *key;
+	guint32 idx;
+
+	if (str == NULL)
+		return XB_SILO_UNSET;
+	if (g_hash_table_lookup_extended(helper->strs_hash, str, NULL, &val))
+		return GPOINTER_TO_UINT(val);
+	if (helper->strs_len > G_MAXINT32) {
+		g_set_error_literal(error,
+				    G_IO_ERROR,
+				    G_IO_ERROR_INVALID_DATA,
+				    "string table too large");
+		return XB_SILO_UNSET;
+	}
+	idx = helper->strs_len;
+	key = g_strdup(str);
+	helper->strs_len += strlen(str) + 1;
+	g_hash_table_insert(helper->strs_hash, key, GUINT_TO_POINTER(idx));
+	g_ptr_array_add(helper->strs, key);
+	return idx;
+}
+
+static gboolean
+xb_builder_stream_patch_str(XbBuilderStreamHelper *helper,
+			    XbBuilderNode *bn,
+			    guint32 offset,
+			    const gchar *str,
+			    GError **error)
+{
+	guint32 idx;
+
+	if (str == NULL || xb_builder_nodetab_is_literal_space(bn, str))
+		return TRUE;
+	idx = xb_builder_stream_add_str(helper, str, error);
+	if (idx == XB_SILO_UNSET)
+		return FALSE;
+	return xb_builder_stream_patch(helper, offset, idx, error);
+}
+
+/* the text is complete when the first child starts or the element ends */
+static gboolean
+xb_builder_stream_level_text(XbBuilderStreamHelper *helper,
+			     XbBuilderStreamLevel *level,
+			     GError **error)
+{
+	if (level->text_done)
+		return TRUE;
+	level->text_done = TRUE;
+	if (level->offset == 0)
+		return TRUE;
+	return xb_builder_stream_patch_str(helper,
+					   level->bn,
+					   level->offset + G_STRUCT_OFFSET(XbSiloNode, text),
+					   xb_builder_node_get_text(level->bn),
+					   error);
+}
+
+/* the tail is complete when the next sibling starts or the parent ends */
+static gboolean
+xb_builder_stream_level_tail(XbBuilderStreamHelper *helper,
+			     XbBuilderStreamLevel *level,
+			     GError **error)
+{
+	g_autoptr(XbBuilderNode) bc = g_steal_pointer(&level->last_child);
+	guint32 offset = level->last_child_offset;
+
+	level->last_child_offset = 0;
+	if (bc == NULL || offset == 0)
+		return TRUE;
+	return xb_builder_stream_patch_str(helper,
+					   bc,
+					   offset + G_STRUCT_OFFSET(XbSiloNode, tail),
+					   xb_builder_node_get_tail(bc),
+					   error);
+}
+
+/* finishes the previous sibling, and the parent text */
+static gboolean
+xb_builder_stream_node_sibling(XbBuilderStreamHelper *helper,
+			       XbBuilderNode *bn,
+			       guint32 offset,
+			       GError **error)
+{
+	XbBuilderStreamLevel *level = xb_builder_stream_get_level(helper);
+	if (!xb_builder_stream_level_text(helper, level, error))
+		return FALSE;
+	if (!xb_builder_stream_level_tail(helper, level, error))
+		return FALSE;
+	level->last_child = g_object_ref(bn);
+	level->last_child_offset = offset;
+	return TRUE;
+}
+
+static gboolean
+xb_builder_stream_node_begin(XbBuilderStreamHelper *helper, XbBuilderNode *bn, GError **error)
+{
+	XbBuilderStreamLevel *parent = xb_builder_stream_get_level(helper);
+	XbBuilderStreamLevel *level;
+	GPtrArray *attrs = xb_builder_node_get_attrs(bn);
+	GPtrArray *tokens = xb_builder_node_get_tokens(bn);
+	g_autoptr(GArray) token_idxs = g_array_new(FALSE, FALSE, sizeof(guint32));
+	XbSiloNodeAttr attrs_silo[XB_BUILDER_ATTR_MAX];
+	guint32 offset;
+	XbSiloNode sn = {
+	    .flags = XB_SILO_NODE_FLAG_IS_ELEMENT,
+	    .element_name = xb_builder_stream_add_tag(helper, xb_builder_node_get_element(bn)),
+	    .next = 0x0,
+	    .parent = parent->offset,
+	    .text = XB_SILO_UNSET,
+	    .tail = XB_SILO_UNSET,
+	    .end = 0x0,
+	    .depth = MIN(helper->stack->len - 1, G_MAXUINT16),
+	    .token_count = 0,
+	};
+
+	/* sanity check */
+	if (!xb_builder_nodetab_check_attrs(attrs, error))
+		return FALSE;
+	if (helper->stack->len == 1)
+		g_hash_table_add(helper->root_elements, g_strdup(xb_builder_node_get_element(bn)));
+
+	/* a whole node is always in the buffer */
+	if (helper->buf->len > XB_BUILDER_STREAM_BUFSZ) {
+		if (!xb_builder_stream_flush(helper, error))
+			return FALSE;
+	}
+	offset = xb_builder_stream_get_offset(helper);
+	if (!xb_builder_stream_node_sibling(helper, bn, offset, error))
+		return FALSE;
+	if (parent->prev_offset != 0) {
+		if (!xb_builder_stream_patch(helper,
+					     parent->prev_offset +
+						 G_STRUCT_OFFSET(XbSiloNode, next),
+					     offset,
+					     error))
+			return FALSE;
+	}
+	parent->prev_offset = offset;
+
+	/* there is no point adding more tokens than we can match */
+	for (guint i = 0; tokens != NULL && i < MIN(tokens->len, XB_OPCODE_TOKEN_MAX); i++) {
+		const gchar *tmp = g_ptr_array_index(tokens, i);
+		guint32 idx;
+		if (tmp == NULL)
+			continue;
+		idx = xb_builder_stream_add_str(helper, tmp, error);
+		if (idx == XB_SILO_UNSET)
+			return FALSE;
+		g_array_append_val(token_idxs, idx);
+	}
+	for (guint i = 0; attrs != NULL && i < attrs->len; i++) {
+		XbBuilderNodeAttr *ba = g_ptr_array_index(attrs, i);
+		attrs_silo[i].attr_name = xb_builder_stream_add_str(helper, ba->name, error);
+		if (attrs_silo[i].attr_name == XB_SILO_UNSET)
+			return FALSE;
+		attrs_silo[i].attr_value = xb_builder_stream_add_str(helper, ba->value, error);
+		if (attrs_silo[i].attr_value == XB_SILO_UNSET && ba->value != NULL)
+			return FALSE;
+	}
+	xb_builder_nodetab_append_node(helper->buf,
+				       &sn,
+				       attrs_silo,
+				       attrs != NULL ? attrs->len : 0,
+				       token_idxs->len > 0 ? token_idxs : NULL);
+
+	/* add to the stack */
+	level = g_new0(XbBuilderStreamLevel, 1);
+	level->bn = g_object_ref(bn);
+	level->offset = offset;
+	g_ptr_array_add(helper->stack, level);
+	return TRUE;
+}
+
+static gboolean
+xb_builder_stream_write_node(XbBuilderStreamHelper *helper, XbBuilderNode *bn, GError **error);
+
+static gboolean
+xb_builder_stream_node_end(XbBuilderStreamHelper *helper, GError **error)
+{
+	XbBuilderStreamLevel *level = xb_builder_stream_get_level(helper);
+	XbBuilderStreamLevel *parent;
+	guint32 offset = level->offset;
+	g_autoptr(XbBuilderNode) bn = g_object_ref(level->bn);
+
+	/* this is something we can query with later */
+	if (helper->info != NULL && helper->stack->len - 2 == helper->container) {
+		if (!xb_builder_stream_write_node(helper, helper->info, error))
+			return FALSE;
+	}
+
+	/* finish, and then record where the subtree ends */
+	if (!xb_builder_stream_level_text(helper, level, error))
+		return FALSE;
+	if (!xb_builder_stream_level_tail(helper, level, error))
+		return FALSE;
+	xb_builder_nodetab_write_sentinel(helper->buf);
+	if (!xb_builder_stream_patch(helper,
+				     offset + G_STRUCT_OFFSET(XbSiloNode, end),
+				     xb_builder_stream_get_offset(helper),
+				     error))
+		return FALSE;
+
+	/* the parent gets the tail */
+	g_ptr_array_set_size(helper->stack, helper->stack->len - 1);
+	parent = xb_builder_stream_get_level(helper);
+	parent->last_child = g_steal_pointer(&bn);
+	parent->last_child_offset = offset;
+	return TRUE;
+}
+
+/* for nodes that already exist, e.g. from xb_builder_import_node() */
+static gboolean
+xb_builder_stream_write_node(XbBuilderStreamHelper *helper, XbBuilderNode *bn, GError **error)
+{
+	XbBuilderStreamLevel *level = xb_builder_stream_get_level(helper);
+	GPtrArray *children = xb_builder_node_get_children(bn);
+
+	if (xb_builder_node_has_flag(bn, XB_BUILDER_NODE_FLAG_IGNORE))
+		return xb_builder_stream_node_sibling(helper, bn, 0, error);
+	if (xb_builder_node_has_flag(bn, XB_BUILDER_NODE_FLAG_TOKENIZE_PENDING) &&
+	    xb_builder_node_get_tokens(bn) == NULL)
+		xb_builder_node_tokenize_text(bn);
+
+	/* just a container */
+	if (xb_builder_node_get_element(bn) == NULL) {
+		level->prev_offset = 0;
+		for (guint i = 0; i < children->len; i++) {
+			XbBuilderNode *bc = g_ptr_array_index(children, i);
+			if (!xb_builder_stream_write_node(helper, bc, error))
+				return FALSE;
+		}
+		level->prev_offset = 0;
+		return TRUE;
+	}
+
+	if (!xb_builder_stream_node_begin(helper, bn, error))
+		return FALSE;
+	for (guint i = 0; i < children->len; i++) {
+		XbBuilderNode *bc = g_ptr_array_index(children, i);
+		if (!xb_builder_stream_write_node(helper, bc, error))
+			return FALSE;
+	}
+	return xb_builder_stream_node_end(helper, error);
+}
+
+static void
+xb_builder_stream_start_element_cb(const gchar *element_name,
+				   const gchar **attr_names,
+				   const gchar **attr_values,
+				   gpointer user_data,
+				   GError **error)
+{
+	XbBuilderStreamHelper *helper = (XbBuilderStreamHelper *)user_data;
+	g_autoptr(XbBuilderNode) bn = NULL;
+	const gchar *xml_lang = NULL;
+	guint depth = helper->stack->len - 1 - helper->container + helper->ignore_depth;
+
+	if (!xb_builder_check_depth(depth, error))
+		return;
+	helper->elem_closed = FALSE;
+
+	/* parent node is being ignored */
+	if (helper->ignore_depth > 0) {
+		helper->ignore_depth++;
+		return;
+	}
+
+	/* a single root with no siblings was required */
+	if (helper->stack->len - 1 == helper->container) {
+		if (helper->compile_flags & XB_BUILDER_COMPILE_FLAG_SINGLE_ROOT &&
+		    helper->root_cnt > 0) {
+			g_set_error_literal(error,
+					    G_IO_ERROR,
+					    G_IO_ERROR_INVALID_DATA,
+					    "A root node without siblings was required");
+			return;
+		}
+		helper->root_cnt++;
+	}
+
+	/* check if we should ignore the locale */
+	bn = xb_builder_node_new(element_name);
+	if (helper->compile_flags & XB_BUILDER_COMPILE_FLAG_NATIVE_LANGS)
+		xml_lang = xb_builder_get_xml_lang(attr_names, attr_values);
+	if (xml_lang != NULL && xb_builder_get_locale_priority(helper->locales, xml_lang) < 0) {
+		xb_builder_node_add_flag(bn, XB_BUILDER_NODE_FLAG_IGNORE);
+		helper->ignore_depth = 1;
+		xb_builder_stream_node_sibling(helper, bn, 0, error);
+		return;
+	}
+	for (guint i = 0; attr_names[i] != NULL; i++)
+		xb_builder_node_set_attr(bn, attr_names[i], attr_values[i]);
+	xb_builder_stream_node_begin(helper, bn, error);
+}
+
+static void
+xb_builder_stream_end_element_cb(const gchar *element_name, gpointer user_data, GError **error)
+{
+	XbBuilderStreamHelper *helper = (XbBuilderStreamHelper *)user_data;
+	helper->elem_closed = TRUE;
+	if (helper->ignore_depth > 0) {
+		helper->ignore_depth--;
+		return;
+	}
+	if (helper->stack->len - 1 == helper->container) {
+		g_set_error_literal(error,
+				    G_IO_ERROR,
+				    G_IO_ERROR_INVALID_DATA,
+				    "Mismatched XML; no parent");
+		return;
+	}
+	xb_builder_stream_node_end(helper, error);
+}
+
+static void
+xb_builder_stream_text_cb(const gchar *text, gsize text_len, gpointer user_data, GError **error)
+{
+	XbBuilderStreamHelper *helper = (XbBuilderStreamHelper *)user_data;
+	XbBuilderStreamLevel *level = xb_builder_stream_get_level(helper);
+	XbBuilderNode *bn = level->bn;
+
+	/* unimportant */
+	if (helper->ignore_depth > 0)
+		return;
+
+	/* repair text unless we know it's valid */
+	if (helper->source_flags & XB_BUILDER_SOURCE_FLAG_LITERAL_TEXT)
+		xb_builder_node_add_flag(bn, XB_BUILDER_NODE_FLAG_LITERAL_TEXT);
+
+	/* text or tail */
+	if (!helper->elem_closed) {
+		if (helper->stack->len - 1 == helper->container)
+			return;
+		xb_builder_node_append_text(bn, text, text_len);
+		return;
+	}
+	if (level->last_child != NULL)
+		xb_builder_node_set_tail(level->last_child, text, text_len);
+}
+
+static gboolean
+xb_builder_stream_source(XbBuilderStreamHelper *helper,
+			 XbBuilderSource *source,
+			 GCancellable *cancellable,
+			 GError **error)
+{
+	const XbSaxParser parser = {xb_builder_stream_start_element_cb,
+				    xb_builder_stream_end_element_cb,
+				    xb_builder_stream_text_cb};
+
+	helper->source_flags = xb_builder_source_get_flags(source);
+	helper->info = xb_builder_source_get_info(source);
+	helper->elem_closed = FALSE;
+	helper->ignore_depth = 0;
+	helper->root_cnt = 0;
+
+	/* parse */
+	if (!xb_builder_parse_source(source, &parser, helper, cancellable, error))
+		return FALSE;
+
+	/* more opening than closing */
+	if (helper->stack->len - 1 != helper->container || helper->ignore_depth > 0) {
+		g_set_error_literal(error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA, "Mismatched XML");
+		return FALSE;
+	}
+
+	/* a later source cannot add a tail to this */
+	return xb_builder_stream_level_tail(helper, xb_builder_stream_get_level(helper), error);
+}
+
+static gboolean
+xb_builder_stream_tag_rollback_cb(gpointer key, gpointer value, gpointer user_data)
+{
+	return GPOINTER_TO_UINT(value) >= GPOINTER_TO_UINT(user_data);
+}
+
+/* throw away everything written since @offset, and any strings only used by it */
+static gboolean
+xb_builder_stream_rollback(XbBuilderStreamHelper *helper,
+			   guint32 offset,
+			   guint32 prev_offset,
+			   guint strs_cnt,
+			   guint32 tags_len,
+			   GError **error)
+{
+	XbBuilderStreamLevel *level;
+
+	for (guint i = strs_cnt; i < helper->strs->len; i++) {
+		const gchar *tmp = g_ptr_array_index(helper->strs, i);
+		helper->strs_len -= strlen(tmp) + 1;
+		g_hash_table_remove(helper->strs_hash, tmp);
+	}
+	g_ptr_array_set_size(helper->strs, strs_cnt);
+	g_hash_table_foreach_remove(helper->tags_hash,
+				    xb_builder_stream_tag_rollback_cb,
+				    GUINT_TO_POINTER(tags_len));
+	g_byte_array_set_size(helper->tags, tags_len);
+
+	g_ptr_array_set_size(helper->stack, helper->container + 1);
+	level = xb_builder_stream_get_level(helper);
+	g_clear_object(&level->last_child);
+	level->last_child_offset = 0;
+	level->prev_offset = prev_offset;
+	if (offset >= helper->buf_offset) {
+		g_byte_array_set_size(helper->buf, offset - helper->buf_offset);
+	} else {
+		g_byte_array_set_size(helper->buf, 0);
+		helper->buf_offset = offset;
+		helper->truncate = TRUE;
+		if (!g_seekable_seek(G_SEEKABLE(helper->iostream),
+				     offset,
+				     G_SEEK_SET,
+				     helper->cancellable,
+				     error))
+			return FALSE;
+	}
+	if (prev_offset == 0)
+		return TRUE;
+	return xb_builder_stream_patch(helper,
+				       prev_offset + G_STRUCT_OFFSET(XbSiloNode, next),
+				       0,
+				       error);
+}
+
+/* the prefix is shared by adjacent sources */
+static gboolean
+xb_builder_stream_prefix(XbBuilderStreamHelper *helper, const gchar *prefix, GError **error)
+{
+	g_autoptr(XbBuilderNode) bn = NULL;
+
+	/* the info was only for the previous source */
+	helper->info = NULL;
+	if (helper->container > 0) {
+		XbBuilderStreamLevel *level = xb_builder_stream_get_level(helper);
+		if (g_strcmp0(xb_builder_node_get_element(level->bn), prefix) == 0)
+			return TRUE;
+		helper->container = 0;
+		if (!xb_builder_stream_node_end(helper, error))
+			return FALSE;
+	}
+	if (prefix == NULL)
+		return TRUE;
+	if (g_hash_table_contains(helper->root_elements, prefix)) {
+		g_set_error(error,
+			    G_IO_ERROR,
+			    G_IO_ERROR_NOT_SUPPORTED,
+			    "sources with the prefix %s have to be imported together",
+			    prefix);
+		return FALSE;
+	}
+	bn = xb_builder_node_new(prefix);
+	if (!xb_builder_stream_node_begin(helper, bn, error))
+		return FALSE;
+	helper->container = 1;
+	return TRUE;
+}
+
+/* the other strings go after the element names, so fix up the nodetab */
+static gboolean
+xb_builder_stream_rebase(XbBuilderStreamHelper *helper,
+			 guint32 nodetabsz,
+			 XbSiloChecksum *checksum,
+			 GError **error)
+{
+	GInputStream *istream = g_io_stream_get_input_stream(helper->iostream);
+	GOutputStream *ostream = g_io_stream_get_output_stream(helper->iostream);
+	guint32 tagsz = helper->tags->len;
+	guint32 pos = sizeof(XbSiloHeader);
+	g_autoptr(GByteArray) buf = g_byte_array_new();
+
+	g_byte_array_set_size(buf, 64 * 1024);
+	while (pos < nodetabsz) {
+		gsize bufsz = 0;
+		guint32 off = 0;
+
+		if (!g_seekable_seek(G_SEEKABLE(helper->iostream),
+				     pos,
+				     G_SEEK_SET,
+				     helper->cancellable,
+				     error))
+			return FALSE;
+		if (!g_input_stream_read_all(istream,
+					     buf->data,
+					     MIN(buf->len, nodetabsz - pos),
+					     &bufsz,
+					     helper->cancellable,
+					     error))
+			return FALSE;
+
+		/* only whole nodes */
+		while (off < bufsz) {
+			XbSiloNode *sn = (XbSiloNode *)(buf->data + off);
+			guint32 nodesz;
+			if (xb_silo_node_has_flag(sn, XB_SILO_NODE_FLAG_IS_ELEMENT) &&
+			    bufsz - off < sizeof(XbSiloNode))
+				break;
+			nodesz = xb_silo_node_get_size(sn);
+			if (bufsz - off < nodesz)
+				break;
+			if (xb_silo_node_has_flag(sn, XB_SILO_NODE_FLAG_IS_ELEMENT)) {
+				if (sn->text != XB_SILO_UNSET)
+					sn->text += tagsz;
+				if (sn->tail != XB_SILO_UNSET)
+					sn->tail += tagsz;
+				for (guint32 i = sizeof(XbSiloNode); i < nodesz;
+				     i += sizeof(guint32)) {
+					guint32 tmp;
+					memcpy(&tmp, buf->data + off + i, sizeof(tmp));
+					if (tmp != XB_SILO_UNSET)
+						tmp += tagsz;
+					memcpy(buf->data + off + i, &tmp, sizeof(tmp));
+				}
+			}
+			off += nodesz;
+		}
+		if (off == 0) {
+			g_set_error_literal(error,
+					    G_IO_ERROR,
+					    G_IO_ERROR_INVALID_DATA,
+					    "nodetab invalid");
+			return FALSE;
+		}
+		if (!g_seekable_seek(G_SEEKABLE(helper->iostream),
+				     pos,
+				     G_SEEK_SET,
+				     helper->cancellable,
+				     error))
+			return FALSE;
+		if (!g_output_stream_write_all(ostream,
+					       buf->data,
+					       off,
+					       NULL,
+					       helper->cancellable,
+					       error))
+			return FALSE;
+		xb_silo_checksum_update(checksum, buf->data, off);
+		pos += off;
 	}
+	return TRUE;
+}
 
-	/* create helper used for compiling */
-	helper = g_new0(XbBuilderCompileHelper, 1);
-	helper->compile_flags = flags;
-	helper->root = xb_builder_node_new(NULL);
-	helper->silo = xb_silo_new();
-	helper->locales = priv->locales;
-	helper->strtab = g_byte_array_new();
-	helper->strtab_hash = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
-	helper->elem_closed = FALSE;
+static gboolean
+xb_builder_stream_write_strtab(XbBuilderStreamHelper *helper,
+			       XbSiloChecksum *checksum,
+			       GError **error)
+{
+	GOutputStream *ostream = g_io_stream_get_output_stream(helper->iostream);
+	g_autoptr(GByteArray) buf = g_byte_array_new();
+
+	if (!g_output_stream_write_all(ostream,
+				       helper->tags->data,
+				       helper->tags->len,
+				       NULL,
+				       helper->cancellable,
+				       error))
+		return FALSE;
+	xb_silo_checksum_update(checksum, helper->tags->data, helper->tags->len);
+	for (guint i = 0; i <= helper->strs->len; i++) {
+		if (i < helper->strs->len) {
+			const gchar *tmp = g_ptr_array_index(helper->strs, i);
+			g_byte_array_append(buf, (const guint8 *)tmp, strlen(tmp) + 1);
+			if (buf->len < 64 * 1024)
+				continue;
+		}
+		if (!g_output_stream_write_all(ostream,
+					       buf->data,
+					       buf->len,
+					       NULL,
+					       helper->cancellable,
+					       error))
+			return FALSE;
+		xb_silo_checksum_update(checksum, buf->data, buf->len);
+		g_byte_array_set_size(buf, 0);
+	}
+	return TRUE;
+}
 
-	/* for profiling */
-	xb_silo_set_profile_flags(helper->silo, priv->profile_flags);
-	timer = xb_silo_start_profile(helper->silo);
+static gboolean
+xb_builder_stream_write(XbBuilder *self,
+			XbBuilderStreamHelper *helper,
+			XbSilo *silo,
+			GTimer *timer,
+			GError **error)
+{
+	XbBuilderPrivate *priv = GET_PRIVATE(self);
+	XbSiloChecksum checksum;
+	guint32 nodetabsz;
+	XbSiloHeader hdr = {
+	    .magic = XB_SILO_MAGIC_BYTES,
+	    .version = XB_SILO_VERSION,
+	    .strtab = 0,
+	    .strtab_ntags = 0,
+	    .flags = XB_SILO_HEADER_FLAG_NONE,
+	    .guid = {0x0},
+	    .filesz = 0x0,
+	    .postings = 0x0,
+	    .strindex = 0x0,
+	    .tagtab = 0x0,
+	    .columns = 0x0,
+	    .checksum = 0x0,
+	};
 
-	/* build node tree */
+	/* space for the header */
+	g_byte_array_append(helper->buf, (const guint8 *)&hdr, sizeof(hdr));
+
+	/* write each source as it is parsed */
 	for (guint i = 0; i < priv->sources->len; i++) {
 		XbBuilderSource *source = g_ptr_array_index(priv->sources, i);
-		const gchar *prefix = xb_builder_source_get_prefix(source);
+		XbBuilderStreamLevel *level;
 		g_autofree gchar *source_guid = xb_builder_source_get_guid(source);
-		g_autoptr(XbBuilderNode) root = NULL;
 		g_autoptr(GError) error_local = NULL;
+		guint32 offset;
+		guint32 prev_offset;
+		guint strs_cnt;
+		guint32 tags_len;
 
-		/* find, or create the prefix */
-		if (prefix != NULL) {
-			root = xb_builder_node_get_child(helper->root, prefix, NULL);
-			if (root == NULL)
-				root = xb_builder_node_insert(helper->root, prefix, NULL);
-		} else {
-			/* don't allow damaged XML files to ruin all the next ones */
-			root = g_object_ref(helper->root);
-		}
-
-		/* watch the source */
-		if (!xb_builder_watch_source(self, source, helper->silo, cancellable, error))
-			return NULL;
-
-		if (priv->profile_flags & XB_SILO_PROFILE_FLAG_DEBUG)
-			g_debug("compiling %s…", source_guid);
-		if (!xb_builder_compile_source(helper, source, root, cancellable, &error_local)) {
-			if (flags & XB_BUILDER_COMPILE_FLAG_IGNORE_INVALID) {
+		if (!xb_builder_stream_prefix(helper, xb_builder_source_get_prefix(source), error))
+			return FALSE;
+		level = xb_builder_stream_get_level(helper);
+		offset = xb_builder_stream_get_offset(helper);
+		prev_offset = level->prev_offset;
+		strs_cnt = helper->strs->len;
+		tags_len = helper->tags->len;
+		if (!xb_builder_stream_source(helper, source, helper->cancellable, &error_local)) {
+			if (helper->compile_flags & XB_BUILDER_COMPILE_FLAG_IGNORE_INVALID) {
 				g_debug("ignoring invalid file %s: %s",
 					source_guid,
 					error_local->message);
+				if (!xb_builder_stream_rollback(helper,
+								offset,
+								prev_offset,
+								strs_cnt,
+								tags_len,
+								error))
+					return FALSE;
 				continue;
 			}
 			g_propagate_prefixed_error(error,
 						   g_steal_pointer(&error_local),
 						   "failed to compile %s: ",
 						   source_guid);
-			return NULL;
-		}
-	}
-
-	/* run any node functions */
-	for (guint i = 0; i < priv->fixups->len; i++) {
-		XbBuilderFixup *fixup = g_ptr_array_index(priv->fixups, i);
-		if (!xb_builder_fixup_node(fixup, helper->root, error))
-			return NULL;
-	}
-
-	/* only include the highest priority translation */
-	if (flags & XB_BUILDER_COMPILE_FLAG_SINGLE_LANG) {
-		xb_builder_node_traverse(helper->root,
-					 G_PRE_ORDER,
-					 G_TRAVERSE_ALL,
-					 -1,
-					 xb_builder_xml_lang_prio_cb,
-					 nodes_to_destroy);
-		for (guint i = 0; i < nodes_to_destroy->len; i++) {
-			XbBuilderNode *bn = g_ptr_array_index(nodes_to_destroy, i);
-			xb_builder_node_unlink(bn);
+			return FALSE;
 		}
-		xb_silo_add_profile(helper->silo, timer, "filter single-lang");
+		xb_silo_add_profile(silo, timer, "compile %s", source_guid);
 	}
+	if (!xb_builder_stream_prefix(helper, NULL, error))
+		return FALSE;
 
 	/* add any manually build nodes */
+	helper->info = NULL;
 	for (guint i = 0; i < priv->nodes->len; i++) {
 		XbBuilderNode *bn = g_ptr_array_index(priv->nodes, i);
-		xb_builder_node_add_child(helper->root, bn);
+		if (!xb_builder_stream_write_node(helper, bn, error))
+			return FALSE;
 	}
+	if (!xb_builder_stream_level_tail(helper, xb_builder_stream_get_level(helper), error))
+		return FALSE;
+	if (!xb_builder_stream_flush(helper, error))
+		return FALSE;
+	nodetabsz = helper->buf_offset;
+	xb_silo_add_profile(silo, timer, "writing nodetab");
 
-	/* get the size of the nodetab */
-	xb_builder_node_traverse(helper->root,
-				 G_PRE_ORDER,
-				 G_TRAVERSE_ALL,
-				 -1,
-				 xb_builder_nodetab_size_cb,
-				 &nodetabsz);
-	buf = g_byte_array_sized_new(nodetabsz);
-	xb_silo_add_profile(helper->silo, timer, "get size nodetab");
-
-	/* add everything to the strtab */
-	xb_builder_node_traverse(helper->root,
-				 G_PRE_ORDER,
-				 G_TRAVERSE_ALL,
-				 -1,
-				 xb_builder_strtab_element_names_cb,
-				 helper);
-	if (helper->error != NULL) {
-		g_propagate_error(error, g_steal_pointer(&helper->error));
-		return NULL;
-	}
-	if (g_hash_table_size(helper->strtab_hash) > G_MAXUINT16) {
+	/* now the size of everything is known */
+	if (g_hash_table_size(helper->tags_hash) > G_MAXUINT16) {
 		g_set_error_literal(error,
 				    G_IO_ERROR,
 				    G_IO_ERROR_INVALID_DATA,
 				    "too many unique element names for strtab");
-		return NULL;
+		return FALSE;
 	}
-	hdr.strtab_ntags = (guint16)g_hash_table_size(helper->strtab_hash);
-	xb_silo_add_profile(helper->silo, timer, "adding strtab element");
-	xb_builder_node_traverse(helper->root,
-				 G_PRE_ORDER,
-				 G_TRAVERSE_ALL,
-				 -1,
-				 xb_builder_strtab_attr_name_cb,
-				 helper);
-	if (helper->error != NULL) {
-		g_propagate_error(error, g_steal_pointer(&helper->error));
-		return NULL;
+	if ((guint64)nodetabsz + helper->tags->len + helper->strs_len > G_MAXUINT32) {
+		g_set_error_literal(error,
+				    G_IO_ERROR,
+				    G_IO_ERROR_INVALID_DATA,
+				    "silo too large");
+		return FALSE;
 	}
-	xb_silo_add_profile(helper->silo, timer, "adding strtab attr name");
-	xb_builder_node_traverse(helper->root,
-				 G_PRE_ORDER,
-				 G_TRAVERSE_ALL,
-				 -1,
-				 xb_builder_strtab_attr_value_cb,
-				 helper);
-	if (helper->error != NULL) {
-		g_propagate_error(error, g_steal_pointer(&helper->error));
-		return NULL;
+	hdr.strtab = nodetabsz;
+	hdr.strtab_ntags = (guint16)g_hash_table_size(helper->tags_hash);
+	hdr.filesz = (guint64)nodetabsz + helper->tags->len + helper->strs_len;
+	xb_builder_header_set_guid(&hdr, priv->guid);
+	xb_silo_checksum_init(&checksum, &hdr);
+
+	/* fix up the nodetab and append the strtab */
+	if (!xb_builder_stream_rebase(helper, nodetabsz, &checksum, error))
+		return FALSE;
+	xb_silo_add_profile(silo, timer, "fixing strtab offsets");
+	if (!xb_builder_stream_write_strtab(helper, &checksum, error))
+		return FALSE;
+	xb_silo_add_profile(silo, timer, "appending strtab");
+	if (helper->truncate) {
+		if (!g_seekable_truncate(G_SEEKABLE(helper->iostream),
+					 hdr.filesz,
+					 helper->cancellable,
+					 error))
+			return FALSE;
 	}
-	xb_silo_add_profile(helper->silo, timer, "adding strtab attr value");
-	xb_builder_node_traverse(helper->root,
-				 G_PRE_ORDER,
-				 G_TRAVERSE_ALL,
-				 -1,
-				 xb_builder_strtab_text_cb,
-				 helper);
-	if (helper->error != NULL) {
-		g_propagate_error(error, g_steal_pointer(&helper->error));
+
+	/* this has to be last */
+	hdr.checksum = xb_silo_checksum_finish(&checksum);
+	if (!g_seekable_seek(G_SEEKABLE(helper->iostream),
+			     0,
+			     G_SEEK_SET,
+			     helper->cancellable,
+			     error))
+		return FALSE;
+	return g_output_stream_write_all(g_io_stream_get_output_stream(helper->iostream),
+					 &hdr,
+					 sizeof(hdr),
+					 NULL,
+					 helper->cancellable,
+					 error);
+}
+
+/**
+ * xb_builder_compile_to_file:
+ * @self: a #XbSilo
+ * @file: a #GFile
+ * @flags: some #XbBuilderCompileFlags, e.g. %XB_BUILDER_COMPILE_FLAG_IGNORE_INVALID
+ * @cancellable: a #GCancellable, or %NULL
+ * @error: the #GError, or %NULL
+ *
+ * Compiles the sources straight into @file without building the node tree in
+ * memory, so very large sources can be compiled with memory use that depends
+ * on the nesting depth and the number of unique strings rather than the
+ * number of nodes.
+ *
+ * The memory use is not bounded, as every unique string is kept until the
+ * string table is written after the last node.
+ *
+ * This cannot be used with fixups, imported sources sharing a prefix that are
+ * not adjacent, or with %XB_BUILDER_COMPILE_FLAG_SINGLE_LANG,
+ * %XB_BUILDER_COMPILE_FLAG_STRTAB_INDEX, %XB_BUILDER_COMPILE_FLAG_ELEMENT_COLUMNS,
+ * %XB_BUILDER_COMPILE_FLAG_COMPACT_NODETAB, %XB_BUILDER_COMPILE_FLAG_FRONT_CODED_STRTAB
+ * or %XB_BUILDER_COMPILE_FLAG_POSTINGS. The silo also has no element name hash,
+ * and so queries may be slower.
+ *
+ * Returns: (transfer full): a #XbSilo, or %NULL for error
+ *
+ * Since: 0.3.30
+ **/
+XbSilo *
+xb_builder_compile_to_file(XbBuilder *self,
+			   GFile *file,
+			   XbBuilderCompileFlags flags,
+			   GCancellable *cancellable,
+			   GError **error)
+{
+	XbBuilderPrivate *priv = GET_PRIVATE(self);
+	XbBuilderCompileFlags flags_unsupported =
+	    XB_BUILDER_COMPILE_FLAG_SINGLE_LANG | XB_BUILDER_COMPILE_FLAG_STRTAB_INDEX |
+	    XB_BUILDER_COMPILE_FLAG_ELEMENT_COLUMNS | XB_BUILDER_COMPILE_FLAG_COMPACT_NODETAB |
+	    XB_BUILDER_COMPILE_FLAG_FRONT_CODED_STRTAB | XB_BUILDER_COMPILE_FLAG_POSTINGS;
+	XbSiloLoadFlags load_flags = XB_SILO_LOAD_FLAG_NONE;
+	g_autoptr(GFile) file_parent = NULL;
+	g_autoptr(GFileIOStream) iostream = NULL;
+	g_autoptr(GTimer) timer = NULL;
+	g_autoptr(XbSilo) silo = xb_silo_new();
+	g_autoptr(XbBuilderStreamHelper) helper = NULL;
+
+	g_return_val_if_fail(XB_IS_BUILDER(self), NULL);
+	g_return_val_if_fail(G_IS_FILE(file), NULL);
+	g_return_val_if_fail(cancellable == NULL || G_IS_CANCELLABLE(cancellable), NULL);
+	g_return_val_if_fail(error == NULL || *error == NULL, NULL);
+
+	/* these all need the whole tree */
+	if (flags & flags_unsupported) {
+		g_set_error_literal(error,
+				    G_IO_ERROR,
+				    G_IO_ERROR_NOT_SUPPORTED,
+				    "compile flags not supported when streaming");
 		return NULL;
 	}
-	xb_silo_add_profile(helper->silo, timer, "adding strtab text");
-	xb_builder_node_traverse(helper->root,
-				 G_PRE_ORDER,
-				 G_TRAVERSE_ALL,
-				 -1,
-				 xb_builder_strtab_tokens_cb,
-				 helper);
-	if (helper->error != NULL) {
-		g_propagate_error(error, g_steal_pointer(&helper->error));
+	if (priv->fixups->len > 0) {
+		g_set_error_literal(error,
+				    G_IO_ERROR,
+				    G_IO_ERROR_NOT_SUPPORTED,
+				    "fixups not supported when streaming");
 		return NULL;
 	}
-	xb_silo_add_profile(helper->silo, timer, "adding strtab tokens");
-
-	/* add the initial header */
-	hdr.strtab = nodetabsz;
-	if (priv->guid->len > 0) {
-		XbGuid guid_tmp;
-		xb_guid_compute_for_data(&guid_tmp,
-					 (const guint8 *)priv->guid->str,
-					 priv->guid->len);
-		memcpy(&hdr.guid, &guid_tmp, sizeof(guid_tmp));
+	for (guint i = 0; i < priv->sources->len; i++) {
+		XbBuilderSource *source = g_ptr_array_index(priv->sources, i);
+		if (xb_builder_source_has_fixups(source)) {
+			g_set_error_literal(error,
+					    G_IO_ERROR,
+					    G_IO_ERROR_NOT_SUPPORTED,
+					    "source fixups not supported when streaming");
+			return NULL;
+		}
 	}
-	g_byte_array_append(buf, (const guint8 *)&hdr, sizeof(hdr));
 
-	/* write nodes to the nodetab */
-	nodetab_helper.buf = buf;
-	if (!xb_builder_nodetab_write(&nodetab_helper, helper->root, error))
-		return NULL;
-	xb_silo_add_profile(helper->silo, timer, "writing nodetab");
+	xb_builder_ensure_locales(self, flags);
+
+	/* create helper used for streaming */
+	helper = g_new0(XbBuilderStreamHelper, 1);
+	helper->cancellable = cancellable;
+	helper->buf = g_byte_array_new();
+	helper->tags = g_byte_array_new();
+	helper->tags_hash = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+	helper->strs_hash = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+	helper->strs = g_ptr_array_new();
+	helper->stack = g_ptr_array_new_with_free_func((GDestroyNotify)xb_builder_stream_level_free);
+	helper->root_elements = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+	helper->compile_flags = flags;
+	helper->locales = priv->locales;
 
-	/* set all the ->next and ->parent offsets */
-	xb_builder_node_traverse(helper->root,
-				 G_PRE_ORDER,
-				 G_TRAVERSE_ALL,
-				 -1,
-				 xb_builder_nodetab_fix_cb,
-				 &nodetab_helper);
-	xb_silo_add_profile(helper->silo, timer, "fixing ->parent and ->next");
+	/* the document root */
+	g_ptr_array_add(helper->stack, g_new0(XbBuilderStreamLevel, 1));
+	xb_builder_stream_get_level(helper)->bn = xb_builder_node_new(NULL);
 
-	/* append the string table */
-	g_byte_array_append(buf, (const guint8 *)helper->strtab->data, helper->strtab->len);
-	xb_silo_add_profile(helper->silo, timer, "appending strtab");
+	/* for profiling */
+	xb_silo_set_profile_flags(silo, priv->profile_flags);
+	timer = xb_silo_start_profile(silo);
 
-	/* update the file size */
-	hdrptr = (XbSiloHeader *)buf->data;
-	hdrptr->filesz = buf->len;
+	/* ensure parent directories exist */
+	file_parent = g_file_get_parent(file);
+	if (file_parent != NULL && !g_file_query_exists(file_parent, cancellable)) {
+		if (!g_file_make_directory_with_parents(file_parent, cancellable, error))
+			return NULL;
+	}
+	iostream =
+	    g_file_replace_readwrite(file, NULL, FALSE, G_FILE_CREATE_NONE, cancellable, error);
+	if (iostream == NULL)
+		return NULL;
+	if (!g_seekable_can_seek(G_SEEKABLE(iostream))) {
+		g_set_error_literal(error,
+				    G_IO_ERROR,
+				    G_IO_ERROR_NOT_SUPPORTED,
+				    "file is not seekable");
+		return NULL;
+	}
+	helper->iostream = G_IO_STREAM(iostream);
 
-	/* create data */
-	blob = g_byte_array_free_to_bytes(g_steal_pointer(&buf));
-	if (!xb_silo_load_from_bytes(helper->silo, blob, XB_SILO_LOAD_FLAG_NONE, error))
+	/* write everything, and only replace @file if that worked */
+	if (!xb_builder_stream_write(self, helper, silo, timer, error)) {
+		g_autoptr(GCancellable) cancellable_tmp = g_cancellable_new();
+		g_cancellable_cancel(cancellable_tmp);
+		g_io_stream_close(G_IO_STREAM(iostream), cancellable_tmp, NULL);
+		return NULL;
+	}
+	if (!g_io_stream_close(G_IO_STREAM(iostream), cancellable, error))
+		return NULL;
+
+	/* watch the blob, so propagate flags */
+	if (flags & XB_BUILDER_COMPILE_FLAG_WATCH_BLOB)
+		load_flags |= XB_SILO_LOAD_FLAG_WATCH_BLOB;
+	if (!xb_silo_load_from_file(silo, file, load_flags, cancellable, error))
+		return NULL;
+	if (!xb_builder_watch_sources(self, silo, cancellable, error))
 		return NULL;
 
 	/* success */
-	return g_steal_pointer(&helper->silo);
+	return g_steal_pointer(&silo);
 }
 
 /**
@@ -1208,6 +3582,54 @@ xb_builder_set_profile_flags(XbBuilder *self, XbSiloProfileFlags profile_flags)
 	priv->profile_flags = profile_flags;
 }
 
+/**
+ * xb_builder_set_max_threads:
+ * @self: a #XbBuilder
+ * @max_threads: number of threads, or 0 for one per CPU
+ *
+ * Sets the number of threads used to parse the imported sources when
+ * compiling. Sources are always merged in the order they were imported, and
+ * so the compiled silo is identical regardless of the value used.
+ *
+ * When using more than one thread any adapters and fixups added to the
+ * #XbBuilderSource objects may be called from a worker thread and must be
+ * thread-safe. The default is 1.
+ *
+ * Since: 0.3.30
+ **/
+void
+xb_builder_set_max_threads(XbBuilder *self, guint max_threads)
+{
+	XbBuilderPrivate *priv = GET_PRIVATE(self);
+	g_return_if_fail(XB_IS_BUILDER(self));
+	priv->max_threads = max_threads;
+}
+
+/**
+ * xb_builder_set_fragment_cache:
+ * @self: a #XbBuilder
+ * @directory: (nullable): a #GFile, or %NULL to disable
+ *
+ * Sets a directory used to cache each source once it has been parsed and
+ * fixed up. When compiling, only the sources that have changed since the last
+ * compile are parsed again, and the silo is identical to one compiled without
+ * the cache. The fixups added to each #XbBuilderSource must only depend on
+ * the source itself, as they are not run for cached sources.
+ *
+ * Fragments that are not used by a compile are deleted, so the directory
+ * should not be shared with another #XbBuilder.
+ *
+ * Since: 0.3.30
+ **/
+void
+xb_builder_set_fragment_cache(XbBuilder *self, GFile *directory)
+{
+	XbBuilderPrivate *priv = GET_PRIVATE(self);
+	g_return_if_fail(XB_IS_BUILDER(self));
+	g_return_if_fail(directory == NULL || G_IS_FILE(directory));
+	g_set_object(&priv->fragment_cache, directory);
+}
+
 /**
  * xb_builder_add_fixup:
  * @self: a #XbBuilder
@@ -1245,6 +3667,8 @@ xb_builder_finalize(GObject *obj)
 	g_ptr_array_unref(priv->locales);
 	g_ptr_array_unref(priv->fixups);
 	g_string_free(priv->guid, TRUE);
+	if (priv->fragment_cache != NULL)
+		g_object_unref(priv->fragment_cache);
 
 	G_OBJECT_CLASS(xb_builder_parent_class)->finalize(obj);
 }
@@ -1265,6 +3689,7 @@ xb_builder_init(XbBuilder *self)
 	priv->fixups = g_ptr_array_new_with_free_func((GDestroyNotify)g_object_unref);
 	priv->locales = g_ptr_array_new_with_free_func(g_free);
 	priv->guid = g_string_new(xb_version_string());
+	priv->max_threads = 1;
 }
 
 /**
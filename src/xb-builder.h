@@ -39,17 +39,27 @@ struct _XbBuilderClass {
  * @XB_BUILDER_COMPILE_FLAG_WATCH_BLOB:		Watch the XMLB file for changes
  * @XB_BUILDER_COMPILE_FLAG_IGNORE_GUID:	Ignore the cache GUID value
  * @XB_BUILDER_COMPILE_FLAG_SINGLE_ROOT:	Require at most one root node
+ * @XB_BUILDER_COMPILE_FLAG_STRTAB_INDEX:	Store an index of every string in the silo
+ * @XB_BUILDER_COMPILE_FLAG_ELEMENT_COLUMNS:	Store element columns to search wide sibling lists
+ * @XB_BUILDER_COMPILE_FLAG_COMPACT_NODETAB:	Store variable-length nodes, only saving disk space
+ * @XB_BUILDER_COMPILE_FLAG_FRONT_CODED_STRTAB:	Store strings without the prefix shared with the last
+ * @XB_BUILDER_COMPILE_FLAG_POSTINGS:		Store the children of each element by name
  *
  * The flags for converting to XML.
  **/
 typedef enum {
-	XB_BUILDER_COMPILE_FLAG_NONE = 0,		 /* Since: 0.1.0 */
-	XB_BUILDER_COMPILE_FLAG_NATIVE_LANGS = 1 << 1,	 /* Since: 0.1.0 */
-	XB_BUILDER_COMPILE_FLAG_IGNORE_INVALID = 1 << 2, /* Since: 0.1.0 */
-	XB_BUILDER_COMPILE_FLAG_SINGLE_LANG = 1 << 3,	 /* Since: 0.1.0 */
-	XB_BUILDER_COMPILE_FLAG_WATCH_BLOB = 1 << 4,	 /* Since: 0.1.0 */
-	XB_BUILDER_COMPILE_FLAG_IGNORE_GUID = 1 << 5,	 /* Since: 0.1.7 */
-	XB_BUILDER_COMPILE_FLAG_SINGLE_ROOT = 1 << 6,	 /* Since: 0.3.4 */
+	XB_BUILDER_COMPILE_FLAG_NONE = 0,		      /* Since: 0.1.0 */
+	XB_BUILDER_COMPILE_FLAG_NATIVE_LANGS = 1 << 1,	      /* Since: 0.1.0 */
+	XB_BUILDER_COMPILE_FLAG_IGNORE_INVALID = 1 << 2,      /* Since: 0.1.0 */
+	XB_BUILDER_COMPILE_FLAG_SINGLE_LANG = 1 << 3,	      /* Since: 0.1.0 */
+	XB_BUILDER_COMPILE_FLAG_WATCH_BLOB = 1 << 4,	      /* Since: 0.1.0 */
+	XB_BUILDER_COMPILE_FLAG_IGNORE_GUID = 1 << 5,	      /* Since: 0.1.7 */
+	XB_BUILDER_COMPILE_FLAG_SINGLE_ROOT = 1 << 6,	      /* Since: 0.3.4 */
+	XB_BUILDER_COMPILE_FLAG_STRTAB_INDEX = 1 << 7,	      /* Since: 0.3.30 */
+	XB_BUILDER_COMPILE_FLAG_ELEMENT_COLUMNS = 1 << 8,     /* Since: 0.3.30 */
+	XB_BUILDER_COMPILE_FLAG_COMPACT_NODETAB = 1 << 9,     /* Since: 0.3.30 */
+	XB_BUILDER_COMPILE_FLAG_FRONT_CODED_STRTAB = 1 << 10, /* Since: 0.3.30 */
+	XB_BUILDER_COMPILE_FLAG_POSTINGS = 1 << 11,	      /* Since: 0.3.30 */
 	/*< private >*/
 	XB_BUILDER_COMPILE_FLAG_LAST
 } XbBuilderCompileFlags;
@@ -68,6 +78,24 @@ xb_builder_compile(XbBuilder *self,
 		   GCancellable *cancellable,
 		   GError **error) G_GNUC_NON_NULL(1);
 XbSilo *
+xb_builder_compile_to_file(XbBuilder *self,
+			   GFile *file,
+			   XbBuilderCompileFlags flags,
+			   GCancellable *cancellable,
+			   GError **error) G_GNUC_NON_NULL(1, 2);
+XbSilo *
+xb_builder_merge(XbBuilder *self,
+		 GPtrArray *silos,
+		 XbBuilderCompileFlags flags,
+		 GCancellable *cancellable,
+		 GError **error) G_GNUC_NON_NULL(1, 2);
+XbSilo *
+xb_builder_extract(XbBuilder *self,
+		   GPtrArray *nodes,
+		   XbBuilderCompileFlags flags,
+		   GCancellable *cancellable,
+		   GError **error) G_GNUC_NON_NULL(1, 2);
+XbSilo *
 xb_builder_ensure(XbBuilder *self,
 		  GFile *file,
 		  XbBuilderCompileFlags flags,
@@ -79,5 +107,9 @@ void
 xb_builder_add_fixup(XbBuilder *self, XbBuilderFixup *fixup) G_GNUC_NON_NULL(1, 2);
 void
 xb_builder_set_profile_flags(XbBuilder *self, XbSiloProfileFlags profile_flags) G_GNUC_NON_NULL(1);
+void
+xb_builder_set_max_threads(XbBuilder *self, guint max_threads) G_GNUC_NON_NULL(1);
+void
+xb_builder_set_fragment_cache(XbBuilder *self, GFile *directory) G_GNUC_NON_NULL(1);
 
 G_END_DECLS
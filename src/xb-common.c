@@ -33,6 +33,8 @@ xb_content_type_guess_from_fn(const gchar *filename)
 		return "application/zstd";
 	if (g_strcmp0(ext, ".xml") == 0)
 		return "application/xml";
+	if (g_strcmp0(ext, ".xmlb") == 0)
+		return "application/x-xmlb";
 	if (g_strcmp0(ext, ".desktop") == 0)
 		return "application/x-desktop";
 	if (g_strcmp0(ext, ".quirk") == 0)
@@ -86,6 +88,9 @@ xb_content_type_guess(const gchar *filename, const guchar *buf, gsize bufsz)
 				return g_strdup("application/xml");
 			if (xb_content_type_match(buf, bufsz, 0x0, "[Desktop Entry]", 15))
 				return g_strdup("application/x-desktop");
+			if (xb_content_type_match(buf, bufsz, 0x0, "XMLb", 4) ||
+			    xb_content_type_match(buf, bufsz, 0x0, "XMBZ", 4))
+				return g_strdup("application/x-xmlb");
 		}
 
 		/* file extensions */
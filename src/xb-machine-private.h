@@ -18,5 +18,8 @@ xb_machine_stack_pop_two(XbMachine *self,
 			 GError **error) G_GNUC_NON_NULL(1, 2, 3, 4);
 void
 xb_machine_opcode_tokenize(XbMachine *self, XbOpcode *op) G_GNUC_NON_NULL(1, 2);
+void
+xb_machine_copy(XbMachine *self, XbMachine *donor, gpointer donor_data, gpointer user_data)
+    G_GNUC_NON_NULL(1, 2);
 
 G_END_DECLS
@@ -25,6 +25,7 @@ typedef struct {
 	GHashTable *opcode_fixup;  /* of str[XbMachineOpcodeFixupItem] */
 	GHashTable *opcode_tokens; /* of utf8 */
 	guint stack_size;
+	XbMachine *donor; /* (owned) (nullable): owns the user_data of copied items */
 } XbMachinePrivate;
 
 G_DEFINE_TYPE_WITH_PRIVATE(XbMachine, xb_machine, G_TYPE_OBJECT)
@@ -223,6 +224,62 @@ xb_machine_add_text_handler(XbMachine *self,
 	g_ptr_array_add(priv->text_handlers, item);
 }
 
+/* private: replaces everything registered on @self with the methods, operators,
+ * text handlers and fixups of @donor, passing @user_data instead of @donor_data */
+void
+xb_machine_copy(XbMachine *self, XbMachine *donor, gpointer donor_data, gpointer user_data)
+{
+	GHashTableIter iter;
+	gpointer key = NULL;
+	gpointer value = NULL;
+	XbMachinePrivate *priv = GET_PRIVATE(self);
+	XbMachinePrivate *priv_donor = GET_PRIVATE(donor);
+
+	g_return_if_fail(XB_IS_MACHINE(self));
+	g_return_if_fail(XB_IS_MACHINE(donor));
+
+	g_set_object(&priv->donor, donor);
+	g_ptr_array_set_size(priv->methods, 0);
+	g_ptr_array_set_size(priv->operators, 0);
+	g_ptr_array_set_size(priv->text_handlers, 0);
+	g_hash_table_remove_all(priv->opcode_fixup);
+	priv->debug_flags = priv_donor->debug_flags;
+	priv->stack_size = priv_donor->stack_size;
+
+	/* in the same order so that each method keeps the same index */
+	for (guint i = 0; i < priv_donor->methods->len; i++) {
+		XbMachineMethodItem *item = g_ptr_array_index(priv_donor->methods, i);
+		xb_machine_add_method(self,
+				      item->name,
+				      item->n_opcodes,
+				      item->method_cb,
+				      item->user_data == donor_data ? user_data : item->user_data,
+				      NULL);
+	}
+	for (guint i = 0; i < priv_donor->operators->len; i++) {
+		XbMachineOperator *op = g_ptr_array_index(priv_donor->operators, i);
+		xb_machine_add_operator(self, op->str, op->name);
+	}
+	for (guint i = 0; i < priv_donor->text_handlers->len; i++) {
+		XbMachineTextHandlerItem *item = g_ptr_array_index(priv_donor->text_handlers, i);
+		xb_machine_add_text_handler(
+		    self,
+		    item->handler_cb,
+		    item->user_data == donor_data ? user_data : item->user_data,
+		    NULL);
+	}
+	g_hash_table_iter_init(&iter, priv_donor->opcode_fixup);
+	while (g_hash_table_iter_next(&iter, &key, &value)) {
+		XbMachineOpcodeFixupItem *item = value;
+		xb_machine_add_opcode_fixup(
+		    self,
+		    key,
+		    item->fixup_cb,
+		    item->user_data == donor_data ? user_data : item->user_data,
+		    NULL);
+	}
+}
+
 static XbMachineMethodItem *
 xb_machine_find_func(XbMachine *self, const gchar *func_name)
 {
@@ -2418,6 +2475,7 @@ xb_machine_finalize(GObject *obj)
 	g_ptr_array_unref(priv->text_handlers);
 	g_hash_table_unref(priv->opcode_fixup);
 	g_hash_table_unref(priv->opcode_tokens);
+	g_clear_object(&priv->donor);
 	G_OBJECT_CLASS(xb_machine_parent_class)->finalize(obj);
 }
 
@@ -0,0 +1,41 @@
+/*
+ * Copyright 2026 Richard Hughes <richard@hughsie.com>
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ */
+
+#pragma once
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct _XbSaxContext XbSaxContext;
+
+/* all strings point into the parse buffer and are only valid during the callback */
+typedef struct {
+	void (*start_element)(const gchar *element_name,
+			      const gchar **attr_names,
+			      const gchar **attr_values,
+			      gpointer user_data,
+			      GError **error);
+	void (*end_element)(const gchar *element_name, gpointer user_data, GError **error);
+	void (*text)(const gchar *text, gsize text_len, gpointer user_data, GError **error);
+} XbSaxParser;
+
+XbSaxContext *
+xb_sax_context_new(const XbSaxParser *parser, gpointer user_data) G_GNUC_NON_NULL(1);
+void
+xb_sax_context_free(XbSaxContext *ctx);
+gboolean
+xb_sax_context_parse(XbSaxContext *ctx, const gchar *data, gsize data_len, GError **error)
+    G_GNUC_NON_NULL(1, 2);
+gboolean
+xb_sax_context_parse_borrowed(XbSaxContext *ctx,
+			      const gchar *data,
+			      gsize data_len,
+			      GError **error) G_GNUC_NON_NULL(1, 2);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(XbSaxContext, xb_sax_context_free)
+
+G_END_DECLS
@@ -0,0 +1,971 @@
+/*
+ * Copyright 2026 Richard Hughes <richard@hughsie.com>
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later
+ */
+
+#define G_LOG_DOMAIN "XbSilo"
+
+#include "config.h"
+
+#include <errno.h>
+#include <gio/gio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "xb-sax-private.h"
+
+/* offsets relative to the start of the tag */
+typedef struct {
+	guint32 name;
+	guint32 name_end;
+	guint32 value;
+	guint32 value_end;
+} XbSaxAttr;
+
+struct _XbSaxContext {
+	const XbSaxParser *parser;
+	gpointer user_data;
+	GByteArray *buf;	/* unconsumed input */
+	gsize scanned;		/* bytes of @buf already searched for the end of the token */
+	gboolean borrowed;	/* the input is read-only, so decode in @scratch */
+	GByteArray *scratch;	/* the current tag or text, when @borrowed */
+	GByteArray *stack;	/* open element names, NUL separated */
+	GArray *stack_idx;	/* of guint32 offsets into @stack */
+	GArray *attrs;		/* of XbSaxAttr */
+	GPtrArray *attr_names;	/* of utf-8, borrowed from @buf */
+	GPtrArray *attr_values; /* of utf-8, borrowed from @buf */
+	guint lines; /* newlines in all the data so far */
+	gsize col;   /* bytes after the last newline before @buf */
+	gboolean text_done; /* text before the next tag has been reported */
+	gboolean failed;
+};
+
+#define XB_SAX_CLASS_SPACE    (1u << 0)
+#define XB_SAX_CLASS_NAME_END (1u << 1)
+
+static const guint8 xb_sax_class[256] = {
+    ['\t'] = XB_SAX_CLASS_SPACE | XB_SAX_CLASS_NAME_END,
+    ['\n'] = XB_SAX_CLASS_SPACE | XB_SAX_CLASS_NAME_END,
+    ['\r'] = XB_SAX_CLASS_SPACE | XB_SAX_CLASS_NAME_END,
+    [' '] = XB_SAX_CLASS_SPACE | XB_SAX_CLASS_NAME_END,
+    ['='] = XB_SAX_CLASS_NAME_END,
+    ['/'] = XB_SAX_CLASS_NAME_END,
+    ['>'] = XB_SAX_CLASS_NAME_END,
+};
+
+static inline gboolean
+xb_sax_is_space(guint8 c)
+{
+	return (xb_sax_class[c] & XB_SAX_CLASS_SPACE) > 0;
+}
+
+static inline gboolean
+xb_sax_is_name_end(guint8 c)
+{
+	return (xb_sax_class[c] & XB_SAX_CLASS_NAME_END) > 0;
+}
+
+/* ASCII without any NUL bytes needs no further UTF-8 checks */
+static gboolean
+xb_sax_is_plain(const guint8 *p, gsize len)
+{
+	const guint8 *end = p + len;
+#ifdef __SSE2__
+	const __m128i zero = _mm_setzero_si128();
+	while (end - p >= 16) {
+		__m128i v = _mm_loadu_si128((const __m128i *)p);
+		if (_mm_movemask_epi8(_mm_or_si128(v, _mm_cmpeq_epi8(v, zero))) != 0)
+			return FALSE;
+		p += 16;
+	}
+#endif
+	for (; p < end; p++) {
+		if (*p == 0x0 || *p >= 0x80)
+			return FALSE;
+	}
+	return TRUE;
+}
+
+/* returns the first byte equal to any of @a, @b, @c or @d, or @end */
+static const guint8 *
+xb_sax_scan(const guint8 *p, const guint8 *end, guint8 a, guint8 b, guint8 c, guint8 d)
+{
+#ifdef __SSE2__
+	const __m128i va = _mm_set1_epi8((gchar)a);
+	const __m128i vb = _mm_set1_epi8((gchar)b);
+	const __m128i vc = _mm_set1_epi8((gchar)c);
+	const __m128i vd = _mm_set1_epi8((gchar)d);
+	while (end - p >= 16) {
+		__m128i v = _mm_loadu_si128((const __m128i *)p);
+		__m128i m = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, va), _mm_cmpeq_epi8(v, vb)),
+					 _mm_or_si128(_mm_cmpeq_epi8(v, vc), _mm_cmpeq_epi8(v, vd)));
+		gint mask = _mm_movemask_epi8(m);
+		if (mask != 0)
+			return p + __builtin_ctz(mask);
+		p += 16;
+	}
+#endif
+	for (; p < end; p++) {
+		if (*p == a || *p == b || *p == c || *p == d)
+			return p;
+	}
+	return end;
+}
+
+/* the position is only needed for errors, so is not tracked per-token */
+static guint
+xb_sax_count_lines(const guint8 *p, const guint8 *end)
+{
+	guint lines = 0;
+	while (p < end && (p = memchr(p, '\n', end - p)) != NULL) {
+		lines++;
+		p++;
+	}
+	return lines;
+}
+
+static gsize
+xb_sax_context_get_col(XbSaxContext *ctx, const guint8 *d, gsize pos)
+{
+	for (gsize i = pos; i > 0; i--) {
+		if (d[i - 1] == '\n')
+			return pos - i;
+	}
+	return ctx->col + pos;
+}
+
+static gboolean
+xb_sax_name_validate(const guint8 *name, gsize namesz, GError **error)
+{
+	const gchar *str = (const gchar *)name;
+	gboolean high = FALSE;
+
+	/* fast path for ASCII; like GMarkup the name is only used up to any NUL */
+	for (gsize i = 0; i < namesz; i++) {
+		guint8 c = name[i];
+		if (c == 0x0) {
+			namesz = i;
+			break;
+		}
+		if (c >= 0x80) {
+			high = TRUE;
+			continue;
+		}
+		if (i == 0) {
+			if (!g_ascii_isalpha(c) && c != '_' && c != ':')
+				goto fail;
+		} else {
+			if (!g_ascii_isalnum(c) && c != '.' && c != '-' && c != '_' && c != ':')
+				goto fail;
+		}
+	}
+	if (namesz == 0)
+		goto fail;
+	if (!high)
+		return TRUE;
+
+	/* any other characters have to be letters */
+	if (!g_utf8_validate(str, namesz, NULL)) {
+		g_set_error_literal(error,
+				    G_MARKUP_ERROR,
+				    G_MARKUP_ERROR_BAD_UTF8,
+				    "Invalid UTF-8 encoded text in name");
+		return FALSE;
+	}
+	for (const gchar *tmp = str; tmp < str + namesz; tmp = g_utf8_next_char(tmp)) {
+		if ((guint8)*tmp >= 0x80 && !g_unichar_isalpha(g_utf8_get_char(tmp)))
+			goto fail;
+	}
+	return TRUE;
+fail:
+	g_set_error(error,
+		    G_MARKUP_ERROR,
+		    G_MARKUP_ERROR_PARSE,
+		    "'%.*s' is not a valid name",
+		    (gint)namesz,
+		    name);
+	return FALSE;
+}
+
+static gboolean
+xb_sax_unescape_entity(const guint8 **from, const guint8 *end, guint8 **to, GError **error)
+{
+	const guint8 *name = *from + 1;
+	const guint8 *semi = memchr(name, ';', end - name);
+	gsize namesz;
+
+	if (semi == NULL) {
+		g_set_error_literal(error,
+				    G_MARKUP_ERROR,
+				    G_MARKUP_ERROR_PARSE,
+				    "Entity did not end with a semicolon; most likely you used an "
+				    "ampersand character without intending to start an entity — "
+				    "escape ampersand as &amp;");
+		return FALSE;
+	}
+	namesz = semi - name;
+	if (namesz == 2 && memcmp(name, "lt", 2) == 0) {
+		*(*to)++ = '<';
+	} else if (namesz == 2 && memcmp(name, "gt", 2) == 0) {
+		*(*to)++ = '>';
+	} else if (namesz == 3 && memcmp(name, "amp", 3) == 0) {
+		*(*to)++ = '&';
+	} else if (namesz == 4 && memcmp(name, "quot", 4) == 0) {
+		*(*to)++ = '"';
+	} else if (namesz == 4 && memcmp(name, "apos", 4) == 0) {
+		*(*to)++ = '\'';
+	} else if (namesz > 1 && name[0] == '#') {
+		const gchar *digits = (const gchar *)name + 1;
+		gchar *digits_end = NULL;
+		guint base = 10;
+		gulong ch;
+
+		/* the semicolon stops strtoul() so this cannot overrun */
+		if (*digits == 'x') {
+			base = 16;
+			digits++;
+		}
+		errno = 0;
+		ch = strtoul(digits, &digits_end, base);
+		if (digits_end == digits || errno != 0)
+			goto bad_digit;
+		if ((const guint8 *)digits_end != semi) {
+			g_set_error_literal(error,
+					    G_MARKUP_ERROR,
+					    G_MARKUP_ERROR_PARSE,
+					    "Character reference did not end with a semicolon; most "
+					    "likely you used an ampersand character without intending "
+					    "to start an entity — escape ampersand as &amp;");
+			return FALSE;
+		}
+		if (!((ch > 0 && ch <= 0xD7FF) || (ch >= 0xE000 && ch <= 0xFFFD) ||
+		      (ch >= 0x10000 && ch <= 0x10FFFF))) {
+			g_set_error(error,
+				    G_MARKUP_ERROR,
+				    G_MARKUP_ERROR_PARSE,
+				    "Character reference '%.*s' does not encode a permitted character",
+				    (gint)namesz,
+				    name);
+			return FALSE;
+		}
+
+		/* a character reference is always longer than its UTF-8 encoding */
+		*to += g_unichar_to_utf8(ch, (gchar *)*to);
+	} else if (namesz == 0) {
+		g_set_error_literal(error,
+				    G_MARKUP_ERROR,
+				    G_MARKUP_ERROR_PARSE,
+				    "Empty entity '&;' seen; valid entities are: "
+				    "&amp; &quot; &lt; &gt; &apos;");
+		return FALSE;
+	} else {
+		g_set_error(error,
+			    G_MARKUP_ERROR,
+			    G_MARKUP_ERROR_PARSE,
+			    "Entity name '%.*s' is not known",
+			    (gint)namesz,
+			    name);
+		return FALSE;
+	}
+	*from = semi + 1;
+	return TRUE;
+bad_digit:
+	g_set_error(error,
+		    G_MARKUP_ERROR,
+		    G_MARKUP_ERROR_PARSE,
+		    "Failed to parse '%.*s', which should have been a digit inside a "
+		    "character reference (&#234; for example) - perhaps the digit is too large",
+		    (gint)namesz,
+		    name);
+	return FALSE;
+}
+
+/* decodes entities and line endings in place; attribute values also have
+ * any whitespace normalized to a single space */
+static gboolean
+xb_sax_unescape(guint8 *str, gsize len, gboolean attr, gsize *len_out, GError **error)
+{
+	const guint8 *end = str + len;
+	const guint8 *from = str;
+	guint8 *to = str;
+	guint8 c3 = attr ? '\t' : '&';
+	guint8 c4 = attr ? '\n' : '&';
+
+	while (from < end) {
+		const guint8 *next = xb_sax_scan(from, end, '&', '\r', c3, c4);
+
+		/* copy the run of literal text */
+		if (next != from) {
+			if (to != from)
+				memmove(to, from, next - from);
+			to += next - from;
+			from = next;
+			if (from == end)
+				break;
+		}
+		if (*from == '\r') {
+			*to++ = attr ? ' ' : '\n';
+			from++;
+			if (from < end && *from == '\n')
+				from++;
+		} else if (*from == '&') {
+			if (!xb_sax_unescape_entity(&from, end, &to, error))
+				return FALSE;
+		} else {
+			*to++ = ' ';
+			from++;
+		}
+	}
+	*len_out = to - str;
+	return TRUE;
+}
+
+/* like GMarkup, attribute values are checked as soon as they are complete, but
+ * decoding them has to wait until the tag is complete */
+static gboolean
+xb_sax_value_validate(const guint8 *str, gsize len, GError **error)
+{
+	gboolean plain = xb_sax_is_plain(str, len);
+	const guint8 *end = str + (plain ? len : strnlen((const gchar *)str, len));
+	const guint8 *from = str;
+
+	while ((from = memchr(from, '&', end - from)) != NULL) {
+		guint8 tmp[6];
+		guint8 *to = tmp;
+		if (!xb_sax_unescape_entity(&from, end, &to, error))
+			return FALSE;
+	}
+	if (!plain && !g_utf8_validate((const gchar *)str, end - str, NULL)) {
+		g_set_error_literal(error,
+				    G_MARKUP_ERROR,
+				    G_MARKUP_ERROR_BAD_UTF8,
+				    "Invalid UTF-8 encoded text");
+		return FALSE;
+	}
+	return TRUE;
+}
+
+static gboolean
+xb_sax_context_emit_text(XbSaxContext *ctx,
+			 const guint8 *text,
+			 gsize textsz,
+			 gboolean plain,
+			 GError **error)
+{
+	GError *error_local = NULL;
+
+	if (!plain && !g_utf8_validate((const gchar *)text, textsz, NULL)) {
+		g_set_error_literal(error,
+				    G_MARKUP_ERROR,
+				    G_MARKUP_ERROR_BAD_UTF8,
+				    "Invalid UTF-8 encoded text");
+		return FALSE;
+	}
+	if (ctx->parser->text == NULL)
+		return TRUE;
+	ctx->parser->text((const gchar *)text, textsz, ctx->user_data, &error_local);
+	if (error_local != NULL) {
+		g_propagate_error(error, error_local);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+static gboolean
+xb_sax_context_text(XbSaxContext *ctx, guint8 *text, gsize textsz, gboolean decode, GError **error)
+{
+	gboolean plain = xb_sax_is_plain(text, textsz);
+
+	/* like GMarkup, anything after a NUL is ignored */
+	if (!plain)
+		textsz = strnlen((const gchar *)text, textsz);
+	if (decode && ctx->borrowed) {
+		g_byte_array_set_size(ctx->scratch, 0);
+		g_byte_array_append(ctx->scratch, text, textsz);
+		text = ctx->scratch->data;
+	}
+	if (decode && !xb_sax_unescape(text, textsz, FALSE, &textsz, error))
+		return FALSE;
+	return xb_sax_context_emit_text(ctx, text, textsz, plain, error);
+}
+
+static const gchar *
+xb_sax_context_stack_top(XbSaxContext *ctx)
+{
+	guint32 idx;
+	if (ctx->stack_idx->len == 0)
+		return NULL;
+	idx = g_array_index(ctx->stack_idx, guint32, ctx->stack_idx->len - 1);
+	return (const gchar *)ctx->stack->data + idx;
+}
+
+static void
+xb_sax_context_stack_push(XbSaxContext *ctx, const guint8 *name, gsize namesz)
+{
+	guint32 idx = ctx->stack->len;
+	g_byte_array_append(ctx->stack, name, namesz + 1);
+	g_array_append_val(ctx->stack_idx, idx);
+}
+
+static gboolean
+xb_sax_context_end_element(XbSaxContext *ctx, GError **error)
+{
+	GError *error_local = NULL;
+	guint32 idx = g_array_index(ctx->stack_idx, guint32, ctx->stack_idx->len - 1);
+
+	if (ctx->parser->end_element != NULL) {
+		ctx->parser->end_element(xb_sax_context_stack_top(ctx),
+					 ctx->user_data,
+					 &error_local);
+	}
+	g_byte_array_set_size(ctx->stack, idx);
+	g_array_set_size(ctx->stack_idx, ctx->stack_idx->len - 1);
+	if (error_local != NULL) {
+		g_propagate_error(error, error_local);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/* finds a fixed terminator such as "-->", returning 0 if not yet found */
+static gsize
+xb_sax_find_terminator(const guint8 *p,
+		       const guint8 *end,
+		       gsize start,
+		       gsize skip,
+		       const gchar *term,
+		       gsize termsz)
+{
+	const guint8 *q = p + MAX(start + termsz - 1, skip);
+	while (q < end) {
+		q = memchr(q, '>', end - q);
+		if (q == NULL)
+			return 0;
+		if (memcmp(q - (termsz - 1), term, termsz) == 0)
+			return q + 1 - p;
+		q++;
+	}
+	return 0;
+}
+
+static gboolean
+xb_sax_context_end_tag(XbSaxContext *ctx,
+		       guint8 *p,
+		       const guint8 *end,
+		       gsize *tokensz,
+		       GError **error)
+{
+	const gchar *top;
+	const guint8 *q = p + 2;
+	const guint8 *name = q;
+	gsize namesz;
+
+	while (q < end && !xb_sax_is_name_end(*q))
+		q++;
+	if (q == end)
+		return TRUE;
+	namesz = q - name;
+	if (namesz == 0) {
+		g_set_error(error,
+			    G_MARKUP_ERROR,
+			    G_MARKUP_ERROR_PARSE,
+			    "'%c' is not a valid character following the characters '</'; "
+			    "'%c' may not begin an element name",
+			    *q,
+			    *q);
+		return FALSE;
+	}
+	while (q < end && xb_sax_is_space(*q))
+		q++;
+	if (q == end)
+		return TRUE;
+	if (*q != '>') {
+		g_set_error(error,
+			    G_MARKUP_ERROR,
+			    G_MARKUP_ERROR_PARSE,
+			    "'%c' is not a valid character following the close element name "
+			    "'%.*s'; the allowed character is '>'",
+			    *q,
+			    (gint)namesz,
+			    name);
+		return FALSE;
+	}
+
+	/* must match the open element */
+	namesz = strnlen((const gchar *)name, namesz);
+	top = xb_sax_context_stack_top(ctx);
+	if (top == NULL) {
+		g_set_error(error,
+			    G_MARKUP_ERROR,
+			    G_MARKUP_ERROR_PARSE,
+			    "Element '%.*s' was closed, no element is currently open",
+			    (gint)namesz,
+			    name);
+		return FALSE;
+	}
+	if (strncmp(top, (const gchar *)name, namesz) != 0 || top[namesz] != '\0') {
+		g_set_error(error,
+			    G_MARKUP_ERROR,
+			    G_MARKUP_ERROR_PARSE,
+			    "Element '%.*s' was closed, but the currently open element is '%s'",
+			    (gint)namesz,
+			    name,
+			    top);
+		return FALSE;
+	}
+	*tokensz = q + 1 - p;
+	return xb_sax_context_end_element(ctx, error);
+}
+
+static gboolean
+xb_sax_context_start_tag(XbSaxContext *ctx,
+			 guint8 *p,
+			 const guint8 *end,
+			 gsize *tokensz,
+			 GError **error)
+{
+	GError *error_local = NULL;
+	const guint8 *q = p + 1;
+	const guint8 *name = q;
+	gboolean empty = FALSE;
+	gsize namesz;
+
+	/* find the extent of the tag without modifying it, as it may be incomplete */
+	while (q < end && !xb_sax_is_name_end(*q))
+		q++;
+	if (q == end)
+		return TRUE;
+	namesz = q - name;
+	if (namesz == 0) {
+		g_set_error(error,
+			    G_MARKUP_ERROR,
+			    G_MARKUP_ERROR_PARSE,
+			    "'%c' is not a valid character following a '<' character; "
+			    "it may not begin an element name",
+			    *q);
+		return FALSE;
+	}
+	g_array_set_size(ctx->attrs, 0);
+	while (TRUE) {
+		XbSaxAttr attr = {0};
+		guint8 quote;
+
+		while (q < end && xb_sax_is_space(*q))
+			q++;
+		if (q == end)
+			return TRUE;
+
+		/* GMarkup checks the element name once the attributes are done */
+		if ((*q == '>' || *q == '/') && !xb_sax_name_validate(name, namesz, error))
+			return FALSE;
+		if (*q == '>') {
+			q++;
+			break;
+		}
+		if (*q == '/') {
+			if (q + 1 == end)
+				return TRUE;
+			if (q[1] != '>') {
+				g_set_error(error,
+					    G_MARKUP_ERROR,
+					    G_MARKUP_ERROR_PARSE,
+					    "Odd character '%c', expected a '>' character to end "
+					    "the empty-element tag '%.*s'",
+					    q[1],
+					    (gint)namesz,
+					    name);
+				return FALSE;
+			}
+			empty = TRUE;
+			q += 2;
+			break;
+		}
+
+		/* attribute name */
+		attr.name = q - p;
+		while (q < end && !xb_sax_is_name_end(*q))
+			q++;
+		if (q == end)
+			return TRUE;
+		attr.name_end = q - p;
+		if (attr.name == attr.name_end) {
+			g_set_error(error,
+				    G_MARKUP_ERROR,
+				    G_MARKUP_ERROR_PARSE,
+				    "Odd character '%c', expected a '>' or '/' character to end "
+				    "the start tag of element '%.*s', or optionally an attribute; "
+				    "perhaps you used an invalid character in an attribute name",
+				    p[attr.name],
+				    (gint)namesz,
+				    name);
+			return FALSE;
+		}
+		if (!xb_sax_name_validate(p + attr.name, attr.name_end - attr.name, error))
+			return FALSE;
+
+		/* equals */
+		while (q < end && xb_sax_is_space(*q))
+			q++;
+		if (q == end)
+			return TRUE;
+		if (*q != '=') {
+			g_set_error(error,
+				    G_MARKUP_ERROR,
+				    G_MARKUP_ERROR_PARSE,
+				    "Odd character '%c', expected a '=' after attribute name "
+				    "'%.*s' of element '%.*s'",
+				    *q,
+				    (gint)(attr.name_end - attr.name),
+				    p + attr.name,
+				    (gint)namesz,
+				    name);
+			return FALSE;
+		}
+		q++;
+
+		/* quoted value */
+		while (q < end && xb_sax_is_space(*q))
+			q++;
+		if (q == end)
+			return TRUE;
+		if (*q != '"' && *q != '\'') {
+			g_set_error(error,
+				    G_MARKUP_ERROR,
+				    G_MARKUP_ERROR_PARSE,
+				    "Odd character '%c', expected an open quote mark after the "
+				    "equals sign when giving value for attribute '%.*s' of "
+				    "element '%.*s'",
+				    *q,
+				    (gint)(attr.name_end - attr.name),
+				    p + attr.name,
+				    (gint)namesz,
+				    name);
+			return FALSE;
+		}
+		quote = *q++;
+		attr.value = q - p;
+		q = memchr(q, quote, end - q);
+		if (q == NULL)
+			return TRUE;
+		attr.value_end = q - p;
+		if (!xb_sax_value_validate(p + attr.value, attr.value_end - attr.value, error))
+			return FALSE;
+		q++;
+		g_array_append_val(ctx->attrs, attr);
+	}
+	*tokensz = q - p;
+
+	/* the tag is complete, so terminate and decode the strings in place */
+	if (ctx->borrowed) {
+		g_byte_array_set_size(ctx->scratch, 0);
+		g_byte_array_append(ctx->scratch, p, *tokensz);
+		p = ctx->scratch->data;
+		name = p + 1;
+	}
+	p[1 + namesz] = '\0';
+	g_ptr_array_set_size(ctx->attr_names, 0);
+	g_ptr_array_set_size(ctx->attr_values, 0);
+	for (guint i = 0; i < ctx->attrs->len; i++) {
+		XbSaxAttr *attr = &g_array_index(ctx->attrs, XbSaxAttr, i);
+		gsize valuesz = strnlen((const gchar *)p + attr->value, attr->value_end - attr->value);
+		p[attr->name_end] = '\0';
+		if (!xb_sax_unescape(p + attr->value, valuesz, TRUE, &valuesz, error))
+			return FALSE;
+		p[attr->value + valuesz] = '\0';
+		g_ptr_array_add(ctx->attr_names, p + attr->name);
+		g_ptr_array_add(ctx->attr_values, p + attr->value);
+	}
+	g_ptr_array_add(ctx->attr_names, NULL);
+	g_ptr_array_add(ctx->attr_values, NULL);
+
+	xb_sax_context_stack_push(ctx, name, namesz);
+	if (ctx->parser->start_element != NULL) {
+		ctx->parser->start_element((const gchar *)name,
+					   (const gchar **)ctx->attr_names->pdata,
+					   (const gchar **)ctx->attr_values->pdata,
+					   ctx->user_data,
+					   &error_local);
+		if (error_local != NULL) {
+			g_propagate_error(error, error_local);
+			return FALSE;
+		}
+	}
+	if (empty)
+		return xb_sax_context_end_element(ctx, error);
+	return TRUE;
+}
+
+/* sets @tokensz to zero if more data is required */
+static gboolean
+xb_sax_context_markup(XbSaxContext *ctx,
+		      guint8 *p,
+		      const guint8 *end,
+		      gsize skip,
+		      gsize *tokensz,
+		      GError **error)
+{
+	gsize avail = end - p;
+
+	if (avail < 2)
+		return TRUE;
+
+	/* processing instruction, where like GMarkup "<?>" is complete */
+	if (p[1] == '?') {
+		*tokensz = xb_sax_find_terminator(p, end, 1, skip, "?>", 2);
+		return TRUE;
+	}
+
+	if (p[1] == '!') {
+		/* comment */
+		if (avail < 4 && memcmp(p, "<!--", avail) == 0)
+			return TRUE;
+		if (avail >= 4 && memcmp(p, "<!--", 4) == 0) {
+			*tokensz = xb_sax_find_terminator(p, end, 2, skip, "-->", 3);
+			return TRUE;
+		}
+
+		/* CDATA is passed through as raw text */
+		if (avail < 9 && memcmp(p, "<![CDATA[", avail) == 0)
+			return TRUE;
+		if (avail >= 9 && memcmp(p, "<![CDATA[", 9) == 0) {
+			*tokensz = xb_sax_find_terminator(p, end, 9, skip, "]]>", 3);
+			if (*tokensz == 0)
+				return TRUE;
+			return xb_sax_context_emit_text(ctx, p + 9, *tokensz - 12, FALSE, error);
+		}
+
+		/* DOCTYPE may contain nested declarations */
+		if (avail < 9 && memcmp(p, "<!DOCTYPE", avail) == 0)
+			return TRUE;
+		if (avail >= 9 && memcmp(p, "<!DOCTYPE", 9) == 0) {
+			for (gsize i = 2, depth = 1; i < avail; i++) {
+				if (p[i] == '<') {
+					depth++;
+				} else if (p[i] == '>' && --depth == 0) {
+					*tokensz = i + 1;
+					return TRUE;
+				}
+			}
+		}
+
+		/* anything else is never terminated, which is what GMarkup does */
+		return TRUE;
+	}
+
+	if (p[1] == '/')
+		return xb_sax_context_end_tag(ctx, p, end, tokensz, error);
+	return xb_sax_context_start_tag(ctx, p, end, tokensz, error);
+}
+
+/* tokenizes @d, setting @pos to the start of any trailing partial token */
+static gboolean
+xb_sax_context_parse_data(XbSaxContext *ctx, guint8 *d, gsize n, gsize *pos_out, GError **error)
+{
+	GError *error_local = NULL;
+	gsize pos = 0;
+
+	while (pos < n) {
+		gsize skip = pos == 0 ? ctx->scanned : 0;
+		gsize tokensz = 0;
+
+		/* only whitespace is allowed outside of the elements */
+		if (ctx->stack_idx->len == 0) {
+			gsize start = pos;
+			while (pos < n && xb_sax_is_space(d[pos]))
+				pos++;
+			if (pos == n)
+				break;
+			if (d[pos] != '<') {
+				g_set_error_literal(&error_local,
+						    G_MARKUP_ERROR,
+						    G_MARKUP_ERROR_PARSE,
+						    "Document must begin with an element (e.g. <book>)");
+				goto fail;
+			}
+			if (pos != start)
+				skip = 0;
+		} else if (d[pos] != '<') {
+			guint8 *text = d + pos;
+			const guint8 *lt = xb_sax_scan(text + skip, d + n, '<', '&', '\r', '<');
+			gboolean decode = skip > 0;
+
+			/* only decode when required */
+			if (lt < d + n && *lt != '<') {
+				decode = TRUE;
+				lt = memchr(lt, '<', d + n - lt);
+				if (lt == NULL)
+					lt = d + n;
+			}
+			if (lt == d + n) {
+				ctx->scanned = n - pos;
+				break;
+			}
+			if (!xb_sax_context_text(ctx, text, lt - text, decode, &error_local))
+				goto fail;
+			ctx->text_done = TRUE;
+			ctx->scanned = 0;
+			pos = lt - d;
+			continue;
+		} else if (!ctx->text_done) {
+			/* like GMarkup, the text between two tags is reported even if empty */
+			if (!xb_sax_context_text(ctx, d + pos, 0, FALSE, &error_local))
+				goto fail;
+			ctx->text_done = TRUE;
+		}
+
+		if (!xb_sax_context_markup(ctx, d + pos, d + n, skip, &tokensz, &error_local))
+			goto fail;
+		if (tokensz == 0) {
+			ctx->scanned = n - pos;
+			break;
+		}
+		ctx->text_done = FALSE;
+		ctx->scanned = 0;
+		pos += tokensz;
+	}
+
+	*pos_out = pos;
+	return TRUE;
+fail:
+	ctx->failed = TRUE;
+	g_propagate_prefixed_error(error,
+				   error_local,
+				   "line %u char %u: ",
+				   ctx->lines - xb_sax_count_lines(d + pos, d + n) + 1,
+				   (guint)xb_sax_context_get_col(ctx, d, pos) + 1);
+	return FALSE;
+}
+
+/**
+ * xb_sax_context_parse:
+ * @ctx: a #XbSaxContext
+ * @data: XML data
+ * @data_len: size of @data
+ * @error: the #GError, or %NULL
+ *
+ * Feeds some data into the tokenizer. Complete tokens are passed to the
+ * #XbSaxParser callbacks and any trailing partial token is kept until the next
+ * call. Like #GMarkupParseContext, text is only reported once the next tag has
+ * been seen.
+ *
+ * Returns: %TRUE for success
+ **/
+gboolean
+xb_sax_context_parse(XbSaxContext *ctx, const gchar *data, gsize data_len, GError **error)
+{
+	gsize pos = 0;
+
+	if (ctx->failed) {
+		g_set_error_literal(error,
+				    G_MARKUP_ERROR,
+				    G_MARKUP_ERROR_PARSE,
+				    "A previous error means the document cannot be parsed");
+		return FALSE;
+	}
+
+	ctx->lines += xb_sax_count_lines((const guint8 *)data, (const guint8 *)data + data_len);
+	g_byte_array_append(ctx->buf, (const guint8 *)data, data_len);
+	if (!xb_sax_context_parse_data(ctx, ctx->buf->data, ctx->buf->len, &pos, error))
+		return FALSE;
+
+	/* keep only the partial token */
+	if (pos > 0) {
+		ctx->col = xb_sax_context_get_col(ctx, ctx->buf->data, pos);
+		g_byte_array_remove_range(ctx->buf, 0, pos);
+	}
+	return TRUE;
+}
+
+/**
+ * xb_sax_context_parse_borrowed:
+ * @ctx: a #XbSaxContext
+ * @data: XML data, typically the whole document
+ * @data_len: size of @data
+ * @error: the #GError, or %NULL
+ *
+ * Like xb_sax_context_parse(), but tokenizes @data where it is rather than
+ * copying it into the context first. @data is never modified, so it can be a
+ * read-only mapping; only tags and text that need decoding are copied.
+ *
+ * Returns: %TRUE for success
+ **/
+gboolean
+xb_sax_context_parse_borrowed(XbSaxContext *ctx,
+			      const gchar *data,
+			      gsize data_len,
+			      GError **error)
+{
+	gsize pos = 0;
+	gboolean ret;
+
+	/* the partial token has to be joined to the new data */
+	if (ctx->buf->len > 0 || ctx->failed)
+		return xb_sax_context_parse(ctx, data, data_len, error);
+
+	ctx->lines += xb_sax_count_lines((const guint8 *)data, (const guint8 *)data + data_len);
+	ctx->borrowed = TRUE;
+	ret = xb_sax_context_parse_data(ctx, (guint8 *)data, data_len, &pos, error);
+	ctx->borrowed = FALSE;
+	if (!ret)
+		return FALSE;
+
+	/* keep only the partial token */
+	if (pos < data_len) {
+		ctx->col = xb_sax_context_get_col(ctx, (const guint8 *)data, pos);
+		g_byte_array_append(ctx->buf, (const guint8 *)data + pos, data_len - pos);
+	}
+	return TRUE;
+}
+
+/**
+ * xb_sax_context_free:
+ * @ctx: a #XbSaxContext
+ *
+ * Frees the tokenizer.
+ **/
+void
+xb_sax_context_free(XbSaxContext *ctx)
+{
+	g_byte_array_unref(ctx->buf);
+	g_byte_array_unref(ctx->scratch);
+	g_byte_array_unref(ctx->stack);
+	g_array_unref(ctx->stack_idx);
+	g_array_unref(ctx->attrs);
+	g_ptr_array_unref(ctx->attr_names);
+	g_ptr_array_unref(ctx->attr_values);
+	g_free(ctx);
+}
+
+/**
+ * xb_sax_context_new:
+ * @parser: a #XbSaxParser
+ * @user_data: user data to pass to the callbacks
+ *
+ * Creates a streaming XML tokenizer used when compiling sources. Unlike
+ * #GMarkupParseContext the element names, attributes and text are decoded in
+ * place in the input buffer and are not copied before being passed to the
+ * callbacks, or when using xb_sax_context_parse_borrowed() only tags and
+ * escaped text are copied. CDATA is always treated as text.
+ *
+ * Returns: a #XbSaxContext
+ **/
+XbSaxContext *
+xb_sax_context_new(const XbSaxParser *parser, gpointer user_data)
+{
+	XbSaxContext *ctx = g_new0(XbSaxContext, 1);
+	ctx->parser = parser;
+	ctx->user_data = user_data;
+	ctx->buf = g_byte_array_new();
+	ctx->scratch = g_byte_array_new();
+	ctx->stack = g_byte_array_new();
+	ctx->stack_idx = g_array_new(FALSE, FALSE, sizeof(guint32));
+	ctx->attrs = g_array_new(FALSE, FALSE, sizeof(XbSaxAttr));
+	ctx->attr_names = g_ptr_array_new();
+	ctx->attr_values = g_ptr_array_new();
+	return ctx;
+}
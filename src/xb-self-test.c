@@ -9,13 +9,16 @@
 #include <gio/gio.h>
 #include <locale.h>
 
+#include "xb-builder-node-private.h"
 #include "xb-builder-node.h"
 #include "xb-builder.h"
 #include "xb-common-private.h"
 #include "xb-machine.h"
+#include "xb-node-private.h"
 #include "xb-node-query.h"
 #include "xb-opcode-private.h"
 #include "xb-opcode.h"
+#include "xb-sax-private.h"
 #include "xb-silo-export.h"
 #include "xb-silo-private.h"
 #include "xb-silo-query-private.h"
@@ -405,7 +408,1527 @@ xb_builder_func(void)
 
 	/* check size */
 	bytes = xb_silo_get_bytes(silo);
-	g_assert_cmpint(g_bytes_get_size(bytes), ==, 628);
+	g_assert_cmpint(g_bytes_get_size(bytes), ==, 798);
+}
+
+static void
+xb_builder_postings_func(void)
+{
+	gboolean ret;
+	guint32 idx = 0;
+	guint32 idx_end = 0;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GPtrArray) results = NULL;
+	g_autoptr(XbBuilder) builder = xb_builder_new();
+	g_autoptr(XbNode) n = NULL;
+	g_autoptr(XbSilo) silo = NULL;
+	const gchar *xml = "<components>\n"
+			   "  <component>\n"
+			   "    <id>gimp.desktop</id>\n"
+			   "    <name>GIMP</name>\n"
+			   "    <id>org.gnome.Gimp.desktop</id>\n"
+			   "  </component>\n"
+			   "  <header/>\n"
+			   "  <component>\n"
+			   "    <name>Software</name>\n"
+			   "    <id>gnome-software.desktop</id>\n"
+			   "  </component>\n"
+			   "</components>\n";
+
+	/* not written by default */
+	ret = xb_test_import_xml(builder, xml, &error);
+	g_assert_no_error(error);
+	g_assert_true(ret);
+	silo = xb_builder_compile(builder, XB_BUILDER_COMPILE_FLAG_NONE, NULL, &error);
+	g_assert_no_error(error);
+	g_assert_nonnull(silo);
+	g_assert_false(xb_silo_get_postings(silo, 0, XB_SILO_UNSET, &idx, &idx_end));
+	g_clear_object(&silo);
+
+	silo = xb_builder_compile(builder, XB_BUILDER_COMPILE_FLAG_POSTINGS, NULL, &error);
+	g_assert_no_error(error);
+	g_assert_nonnull(silo);
+
+	/* root level */
+	ret = xb_silo_get_postings(silo,
+				   0,
+				   xb_silo_get_strtab_idx(silo, "components"),
+				   &idx,
+				   &idx_end);
+	g_assert_true(ret);
+	g_assert_cmpint(idx_end - idx, ==, 1);
+	g_assert_cmpint(xb_silo_get_posting(silo, idx), ==, sizeof(XbSiloHeader));
+
+	/* unknown element */
+	ret = xb_silo_get_postings(silo, 0, XB_SILO_UNSET, &idx, &idx_end);
+	g_assert_true(ret);
+	g_assert_cmpint(idx_end - idx, ==, 0);
+
+	/* interleaved siblings, in document order */
+	results = xb_silo_query(silo, "components/component/id", 0, &error);
+	g_assert_no_error(error);
+	g_assert_nonnull(results);
+	g_assert_cmpint(results->len, ==, 3);
+	g_assert_cmpstr(xb_node_get_text(g_ptr_array_index(results, 0)), ==, "gimp.desktop");
+	g_assert_cmpstr(xb_node_get_text(g_ptr_array_index(results, 1)),
+			==,
+			"org.gnome.Gimp.desktop");
+	g_assert_cmpstr(xb_node_get_text(g_ptr_array_index(results, 2)),
+			==,
+			"gnome-software.desktop");
+
+	/* position only counts matching siblings */
+	n = xb_silo_query_first(silo, "components/component[2]/id[1]", &error);
+	g_assert_no_error(error);
+	g_assert_nonnull(n);
+	g_assert_cmpstr(xb_node_get_text(n), ==, "gnome-software.desktop");
+}
+
+static void
+xb_builder_strtab_index_func(void)
+{
+	gboolean ret;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(XbBuilder) builder = xb_builder_new();
+	g_autoptr(XbNode) n = NULL;
+	g_autoptr(XbSilo) silo = NULL;
+
+	ret = xb_test_import_xml(builder,
+				 "<components>\n"
+				 "  <component type=\"desktop\">\n"
+				 "    <id>gimp.desktop</id>\n"
+				 "  </component>\n"
+				 "  <component type=\"firmware\">\n"
+				 "    <id>org.hughski.ColorHug2.firmware</id>\n"
+				 "  </component>\n"
+				 "</components>\n",
+				 &error);
+	g_assert_no_error(error);
+	g_assert_true(ret);
+	silo = xb_builder_compile(builder, XB_BUILDER_COMPILE_FLAG_STRTAB_INDEX, NULL, &error);
+	g_assert_no_error(error);
+	g_assert_nonnull(silo);
+	g_assert_true(xb_silo_has_strtab_index(silo));
+
+	/* no xb_silo_query_build_index() required */
+	g_assert_cmpint(xb_silo_strtab_index_lookup(silo, "firmware"), !=, XB_SILO_UNSET);
+	g_assert_cmpint(xb_silo_strtab_index_lookup(silo, "dave"), ==, XB_SILO_UNSET);
+	n = xb_silo_query_first(
+	    silo,
+	    "components/component[attr($'type')=$'firmware']/id[text()=$'org.hughski.ColorHug2.firmware']",
+	    &error);
+	g_assert_no_error(error);
+	g_assert_nonnull(n);
+	g_clear_object(&n);
+
+	/* index not found */
+	n = xb_silo_query_first(silo, "components[text()=$'dave']", &error);
+	g_assert_error(error, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT);
+	g_assert_null(n);
+}
+
+static void
+xb_builder_tagtab_func(void)
+{
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GString) xml = g_string_new("<root>");
+	g_autoptr(XbSilo) silo = NULL;
+
+	/* enough names to get collisions in the first level */
+	for (guint i = 0; i < 200; i++)
+		g_string_append_printf(xml, "<tag%u attr=\"value%u\">text%u</tag%u>", i, i, i, i);
+	g_string_append(xml, "</root>");
+	silo = xb_silo_new_from_xml(xml->str, &error);
+	g_assert_no_error(error);
+	g_assert_nonnull(silo);
+
+	/* every element name is found, and only element names */
+	g_assert_cmpint(xb_silo_get_strtab_idx(silo, "root"), ==, 0);
+	for (guint i = 0; i < 200; i++) {
+		g_autofree gchar *element = g_strdup_printf("tag%u", i);
+		g_autofree gchar *attr = g_strdup_printf("value%u", i);
+		g_autofree gchar *text = g_strdup_printf("text%u", i);
+		guint32 idx = xb_silo_get_strtab_idx(silo, element);
+		g_assert_cmpint(idx, !=, XB_SILO_UNSET);
+		g_assert_cmpstr(xb_silo_from_strtab(silo, idx, NULL), ==, element);
+		g_assert_cmpint(xb_silo_get_strtab_idx(silo, attr), ==, XB_SILO_UNSET);
+		g_assert_cmpint(xb_silo_get_strtab_idx(silo, text), ==, XB_SILO_UNSET);
+	}
+	g_assert_cmpint(xb_silo_get_strtab_idx(silo, "tag200"), ==, XB_SILO_UNSET);
+	g_assert_cmpint(xb_silo_get_strtab_idx(silo, ""), ==, XB_SILO_UNSET);
+}
+
+static void
+xb_builder_subtree_end_func(void)
+{
+	XbSiloNode *sn;
+	XbSiloNode *sn_child;
+	XbSiloNode *sn_deep;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(XbSilo) silo = NULL;
+
+	silo = xb_silo_new_from_xml("<a><b><c><d/></c></b><e/></a>", &error);
+	g_assert_no_error(error);
+	g_assert_nonnull(silo);
+
+	/* the root subtree covers the entire nodetab */
+	sn = xb_silo_get_root_node(silo, &error);
+	g_assert_no_error(error);
+	g_assert_nonnull(sn);
+	g_assert_cmpint(xb_silo_node_get_end(sn), ==, xb_silo_get_strtab(silo));
+	g_assert_cmpint(xb_silo_get_node_depth(silo, sn), ==, 0);
+
+	/* skipping the subtree lands on the next sibling */
+	sn_child = xb_silo_get_child_node(silo, sn, &error);
+	g_assert_no_error(error);
+	g_assert_nonnull(sn_child);
+	g_assert_cmpint(xb_silo_node_get_end(sn_child), ==, sn_child->next);
+	g_assert_cmpint(xb_silo_get_node_depth(silo, sn_child), ==, 1);
+
+	/* leaf */
+	sn_deep = xb_silo_get_child_node(silo, sn_child, &error);
+	g_assert_no_error(error);
+	sn_deep = xb_silo_get_child_node(silo, sn_deep, &error);
+	g_assert_no_error(error);
+	g_assert_nonnull(sn_deep);
+	g_assert_cmpint(xb_silo_get_node_depth(silo, sn_deep), ==, 3);
+	g_assert_cmpint(xb_silo_node_get_end(sn_deep),
+			==,
+			xb_silo_get_offset_for_node(silo, sn_deep) + xb_silo_node_get_size(sn_deep) +
+			    1);
+}
+
+static void
+xb_builder_element_columns_func(void)
+{
+	gboolean ret;
+	guint16 ids[256 + XB_SILO_COLUMN_PAD];
+	guint16 depths[256 + XB_SILO_COLUMN_PAD];
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GPtrArray) results = NULL;
+	g_autoptr(XbBuilder) builder = xb_builder_new();
+	g_autoptr(XbNode) n = NULL;
+	g_autoptr(XbSilo) silo = NULL;
+
+	/* the vectorized search matches the scalar one */
+	for (guint i = 0; i < G_N_ELEMENTS(ids); i++) {
+		ids[i] = g_random_int_range(0, 4);
+		depths[i] = g_random_int_range(0, 3);
+	}
+	for (guint i = 0; i < 256; i++) {
+		for (guint j = i; j <= 256; j++) {
+			g_assert_cmpint(xb_silo_column_find(ids, depths, i, j, 3, 2),
+					==,
+					xb_silo_column_find_scalar(ids, depths, i, j, 3, 2));
+		}
+	}
+
+	ret = xb_test_import_xml(builder,
+				 "<components>\n"
+				 "  <component>\n"
+				 "    <id>gimp.desktop</id>\n"
+				 "    <provides><id>gimp.exe</id></provides>\n"
+				 "    <id>org.gnome.Gimp.desktop</id>\n"
+				 "  </component>\n"
+				 "  <header/>\n"
+				 "  <component>\n"
+				 "    <id>gnome-software.desktop</id>\n"
+				 "  </component>\n"
+				 "</components>\n",
+				 &error);
+	g_assert_no_error(error);
+	g_assert_true(ret);
+	silo = xb_builder_compile(builder, XB_BUILDER_COMPILE_FLAG_ELEMENT_COLUMNS, NULL, &error);
+	g_assert_no_error(error);
+	g_assert_nonnull(silo);
+
+	/* only direct children match, in document order */
+	results = xb_silo_query(silo, "components/component/id", 0, &error);
+	g_assert_no_error(error);
+	g_assert_nonnull(results);
+	g_assert_cmpint(results->len, ==, 3);
+	g_assert_cmpstr(xb_node_get_text(g_ptr_array_index(results, 0)), ==, "gimp.desktop");
+	g_assert_cmpstr(xb_node_get_text(g_ptr_array_index(results, 1)),
+			==,
+			"org.gnome.Gimp.desktop");
+	g_assert_cmpstr(xb_node_get_text(g_ptr_array_index(results, 2)),
+			==,
+			"gnome-software.desktop");
+	n = xb_silo_query_first(silo, "components/component[2]/id[1]", &error);
+	g_assert_no_error(error);
+	g_assert_nonnull(n);
+	g_assert_cmpstr(xb_node_get_text(n), ==, "gnome-software.desktop");
+	g_clear_object(&n);
+
+	/* no match */
+	n = xb_silo_query_first(silo, "components/header/id", &error);
+	g_assert_error(error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND);
+	g_assert_null(n);
+}
+
+static void
+xb_builder_compact_nodetab_func(void)
+{
+	gboolean ret;
+	const gchar *xml = "<components origin=\"lvfs\">\n"
+			   "  <component type=\"desktop\">\n"
+			   "    <id>gimp.desktop</id>\n"
+			   "    <name>GIMP &amp; Friends</name>\n"
+			   "    <keywords><keyword>image</keyword><keyword>paint</keyword></keywords>\n"
+			   "  </component>\n"
+			   "  <component type=\"firmware\">\n"
+			   "    <id>org.hughski.ColorHug2.firmware</id>\n"
+			   "  </component>\n"
+			   "</components>\n";
+	g_autofree gchar *tmp_xmlb = g_build_filename(g_get_tmp_dir(), "compact.xmlb", NULL);
+	g_autofree gchar *xml_compact = NULL;
+	g_autofree gchar *xml_fixed = NULL;
+	g_autoptr(GBytes) blob_compact = NULL;
+	g_autoptr(GBytes) blob_fixed = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GFile) file = g_file_new_for_path(tmp_xmlb);
+	g_autoptr(GPtrArray) results = NULL;
+	g_autoptr(XbSilo) silo_compact = NULL;
+	g_autoptr(XbSilo) silo_fixed = NULL;
+	g_autoptr(XbSilo) silo_loaded = xb_silo_new();
+
+	for (guint i = 0; i < 2; i++) {
+		g_autoptr(XbBuilder) builder = xb_builder_new();
+		ret = xb_test_import_xml(builder, xml, &error);
+		g_assert_no_error(error);
+		g_assert_true(ret);
+		if (i == 0) {
+			silo_fixed =
+			    xb_builder_compile(builder, XB_BUILDER_COMPILE_FLAG_NONE, NULL, &error);
+			g_assert_no_error(error);
+			g_assert_nonnull(silo_fixed);
+		} else {
+			silo_compact = xb_builder_compile(builder,
+							  XB_BUILDER_COMPILE_FLAG_COMPACT_NODETAB,
+							  NULL,
+							  &error);
+			g_assert_no_error(error);
+			g_assert_nonnull(silo_compact);
+		}
+	}
+
+	/* smaller on disk */
+	blob_fixed = xb_silo_get_bytes(silo_fixed);
+	blob_compact = xb_silo_get_bytes(silo_compact);
+	g_assert_cmpint(g_bytes_get_size(blob_compact), <, g_bytes_get_size(blob_fixed));
+
+	/* but otherwise identical */
+	xml_fixed = xb_silo_export(silo_fixed, XB_NODE_EXPORT_FLAG_NONE, &error);
+	g_assert_no_error(error);
+	xml_compact = xb_silo_export(silo_compact, XB_NODE_EXPORT_FLAG_NONE, &error);
+	g_assert_no_error(error);
+	g_assert_cmpstr(xml_compact, ==, xml_fixed);
+
+	/* the compact form is what gets saved */
+	ret = xb_silo_save_to_file(silo_compact, file, NULL, &error);
+	g_assert_no_error(error);
+	g_assert_true(ret);
+	ret = xb_silo_load_from_file(silo_loaded, file, XB_SILO_LOAD_FLAG_NONE, NULL, &error);
+	g_assert_no_error(error);
+	g_assert_true(ret);
+	results = xb_silo_query(silo_loaded, "components/component/id", 0, &error);
+	g_assert_no_error(error);
+	g_assert_nonnull(results);
+	g_assert_cmpint(results->len, ==, 2);
+	g_assert_cmpstr(xb_node_get_text(g_ptr_array_index(results, 1)),
+			==,
+			"org.hughski.ColorHug2.firmware");
+}
+
+static gboolean
+xb_builder_threads_fixup_cb(XbBuilderFixup *self,
+			    XbBuilderNode *bn,
+			    gpointer user_data,
+			    GError **error)
+{
+	if (g_strcmp0(xb_builder_node_get_element(bn), "name") == 0)
+		xb_builder_node_add_flag(bn, XB_BUILDER_NODE_FLAG_IGNORE);
+	return TRUE;
+}
+
+static void
+xb_builder_threads_func(void)
+{
+	g_autoptr(GBytes) blob_serial = NULL;
+	g_autoptr(GBytes) blob_threaded = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GPtrArray) results = NULL;
+
+	for (guint j = 0; j < 2; j++) {
+		g_autoptr(XbBuilder) builder = xb_builder_new();
+		g_autoptr(XbSilo) silo = NULL;
+
+		for (guint i = 0; i < 40; i++) {
+			gboolean ret;
+			g_autofree gchar *xml = NULL;
+			g_autoptr(XbBuilderFixup) fixup = NULL;
+			g_autoptr(XbBuilderSource) source = xb_builder_source_new();
+
+			/* one broken file in the middle */
+			if (i == 20) {
+				xml = g_strdup("<component><id>broken</id>");
+			} else {
+				xml = g_strdup_printf("<component type=\"desktop\">"
+						      "<id>app%02u.desktop</id>"
+						      "<name>App %u</name>"
+						      "</component>",
+						      i,
+						      i);
+			}
+			fixup = xb_builder_fixup_new("IgnoreName",
+						     xb_builder_threads_fixup_cb,
+						     NULL,
+						     NULL);
+			xb_builder_source_add_fixup(source, fixup);
+			ret = xb_builder_source_load_xml(source,
+							 xml,
+							 XB_BUILDER_SOURCE_FLAG_NONE,
+							 &error);
+			g_assert_no_error(error);
+			g_assert_true(ret);
+			xb_builder_import_source(builder, source);
+		}
+		xb_builder_set_max_threads(builder, j == 0 ? 1 : 4);
+		silo = xb_builder_compile(builder,
+					  XB_BUILDER_COMPILE_FLAG_IGNORE_INVALID,
+					  NULL,
+					  &error);
+		g_assert_no_error(error);
+		g_assert_nonnull(silo);
+		if (j == 0) {
+			blob_serial = xb_silo_get_bytes(silo);
+		} else {
+			blob_threaded = xb_silo_get_bytes(silo);
+			results = xb_silo_query(silo, "component/id", 0, &error);
+			g_assert_no_error(error);
+			g_assert_nonnull(results);
+			g_assert_cmpint(results->len, ==, 39);
+			g_assert_cmpstr(xb_node_get_text(g_ptr_array_index(results, 0)),
+					==,
+					"app00.desktop");
+			g_assert_cmpstr(xb_node_get_text(g_ptr_array_index(results, 20)),
+					==,
+					"app21.desktop");
+		}
+	}
+
+	/* merged in source order, so identical */
+	g_assert_cmpint(g_bytes_compare(blob_serial, blob_threaded), ==, 0);
+}
+
+static GBytes *
+xb_builder_fragment_cache_compile(GFile *cache, guint sources_max, gboolean *loaded)
+{
+	g_autoptr(GError) error = NULL;
+	g_autoptr(XbBuilder) builder = xb_builder_new();
+	g_autoptr(XbSilo) silo = NULL;
+
+	for (guint i = 0; i < sources_max; i++) {
+		gboolean ret;
+		g_autofree gchar *xml = NULL;
+		g_autoptr(XbBuilderFixup) fixup = NULL;
+		g_autoptr(XbBuilderNode) info = xb_builder_node_insert(NULL, "info", NULL);
+		g_autoptr(XbBuilderSource) source = xb_builder_source_new();
+
+		xml = g_strdup_printf("<component type=\"desktop\">"
+				      "<id>app%02u.desktop</id>"
+				      "<name>App %u</name>"
+				      "<summary>Paint\n    things</summary> tail"
+				      "</component>",
+				      i,
+				      i);
+		fixup = xb_builder_fixup_new("IgnoreName", xb_builder_threads_fixup_cb, NULL, NULL);
+		xb_builder_source_add_fixup(source, fixup);
+		xb_builder_node_insert_text(info, "filename", "app.xml", NULL);
+		xb_builder_source_set_info(source, info);
+		ret = xb_builder_source_load_xml(source, xml, XB_BUILDER_SOURCE_FLAG_NONE, &error);
+		g_assert_no_error(error);
+		g_assert_true(ret);
+		xb_builder_import_source(builder, source);
+	}
+	if (cache != NULL)
+		xb_builder_set_fragment_cache(builder, cache);
+	xb_builder_set_profile_flags(builder, XB_SILO_PROFILE_FLAG_APPEND);
+	silo = xb_builder_compile(builder, XB_BUILDER_COMPILE_FLAG_NONE, NULL, &error);
+	g_assert_no_error(error);
+	g_assert_nonnull(silo);
+	*loaded = g_strstr_len(xb_silo_get_profile_string(silo), -1, "load fragment") != NULL;
+	return xb_silo_get_bytes(silo);
+}
+
+static guint
+xb_builder_fragment_cache_count(const gchar *path)
+{
+	guint cnt = 0;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GDir) dir = g_dir_open(path, 0, &error);
+
+	g_assert_no_error(error);
+	while (g_dir_read_name(dir) != NULL)
+		cnt++;
+	return cnt;
+}
+
+static void
+xb_builder_fragment_cache_func(void)
+{
+	gboolean loaded = FALSE;
+	g_autofree gchar *path = NULL;
+	g_autofree gchar *tmpdir = NULL;
+	g_autoptr(GBytes) blob_full = NULL;
+	g_autoptr(GBytes) blob_saved = NULL;
+	g_autoptr(GBytes) blob_loaded = NULL;
+	g_autoptr(GBytes) blob_pruned = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GFile) cache = NULL;
+
+	tmpdir = g_dir_make_tmp("libxmlb-fragments-XXXXXX", &error);
+	g_assert_no_error(error);
+	path = g_build_filename(tmpdir, "cache", NULL);
+	cache = g_file_new_for_path(path);
+
+	/* the silo is identical whether the sources are parsed or loaded */
+	blob_full = xb_builder_fragment_cache_compile(NULL, 5, &loaded);
+	g_assert_false(loaded);
+	blob_saved = xb_builder_fragment_cache_compile(cache, 5, &loaded);
+	g_assert_false(loaded);
+	g_assert_true(g_bytes_equal(blob_full, blob_saved));
+	g_assert_cmpint(xb_builder_fragment_cache_count(path), ==, 5);
+	blob_loaded = xb_builder_fragment_cache_compile(cache, 5, &loaded);
+	g_assert_true(loaded);
+	g_assert_true(g_bytes_equal(blob_full, blob_loaded));
+
+	/* sources that are no longer imported are removed */
+	blob_pruned = xb_builder_fragment_cache_compile(cache, 2, &loaded);
+	g_assert_true(loaded);
+	g_assert_cmpint(xb_builder_fragment_cache_count(path), ==, 2);
+
+	/* a fragment saved without a single root is still rejected */
+	for (guint i = 0; i < 2; i++) {
+		gboolean ret;
+		g_autoptr(XbBuilder) builder = xb_builder_new();
+		g_autoptr(XbSilo) silo = NULL;
+
+		ret = xb_test_import_xml(builder, "<tag>value2</tag><tag>value3</tag>", &error);
+		g_assert_no_error(error);
+		g_assert_true(ret);
+		xb_builder_set_fragment_cache(builder, cache);
+		if (i == 0) {
+			silo = xb_builder_compile(builder,
+						  XB_BUILDER_COMPILE_FLAG_NONE,
+						  NULL,
+						  &error);
+			g_assert_no_error(error);
+			g_assert_nonnull(silo);
+		} else {
+			silo = xb_builder_compile(builder,
+						  XB_BUILDER_COMPILE_FLAG_SINGLE_ROOT,
+						  NULL,
+						  &error);
+			g_assert_error(error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA);
+			g_assert_null(silo);
+		}
+	}
+}
+
+static XbSilo *
+xb_builder_merge_compile(const gchar *const *xmls, XbBuilderCompileFlags flags)
+{
+	g_autoptr(GError) error = NULL;
+	g_autoptr(XbBuilder) builder = xb_builder_new();
+	g_autoptr(XbSilo) silo = NULL;
+
+	for (guint i = 0; xmls[i] != NULL; i++) {
+		gboolean ret;
+		g_autoptr(XbBuilderSource) source = xb_builder_source_new();
+		ret = xb_builder_source_load_xml(source,
+						 xmls[i],
+						 XB_BUILDER_SOURCE_FLAG_NONE,
+						 &error);
+		g_assert_no_error(error);
+		g_assert_true(ret);
+		xb_builder_import_source(builder, source);
+	}
+	silo = xb_builder_compile(builder, flags, NULL, &error);
+	g_assert_no_error(error);
+	g_assert_nonnull(silo);
+	return g_steal_pointer(&silo);
+}
+
+static void
+xb_builder_merge_func(void)
+{
+	const gchar *xml1 = "<components origin=\"one\">"
+			    "<component type=\"desktop\">"
+			    "<id>gimp.desktop</id>"
+			    "<name>GIMP</name>tail"
+			    "</component>"
+			    "</components>";
+	const gchar *xml2 = "<components origin=\"two\">"
+			    "<component type=\"firmware\">"
+			    "<id>dell.firmware</id>"
+			    "<keyword>bios</keyword>"
+			    "</component>"
+			    "</components>"
+			    "<release version=\"1.2.3\"/>";
+	const gchar *xml_both[] = {xml1, xml2, NULL};
+	const gchar *xml_one[] = {xml1, NULL};
+	const gchar *xml_two[] = {xml2, NULL};
+	XbBuilderCompileFlags flags[] = {
+	    XB_BUILDER_COMPILE_FLAG_NONE,
+	    XB_BUILDER_COMPILE_FLAG_COMPACT_NODETAB | XB_BUILDER_COMPILE_FLAG_FRONT_CODED_STRTAB,
+	};
+
+	for (guint i = 0; i < G_N_ELEMENTS(flags); i++) {
+		g_autofree gchar *xml_merged = NULL;
+		g_autofree gchar *xml_compiled = NULL;
+		g_autoptr(GError) error = NULL;
+		g_autoptr(GPtrArray) silos = g_ptr_array_new_with_free_func(g_object_unref);
+		g_autoptr(XbBuilder) builder = xb_builder_new();
+		g_autoptr(XbNode) n = NULL;
+		g_autoptr(XbSilo) silo = NULL;
+		g_autoptr(XbSilo) silo_both = NULL;
+
+		/* merge two silos and compare to compiling both sources at once */
+		g_ptr_array_add(silos, xb_builder_merge_compile(xml_one, flags[i]));
+		g_ptr_array_add(silos, xb_builder_merge_compile(xml_two, flags[i]));
+		silo = xb_builder_merge(builder, silos, flags[i], NULL, &error);
+		g_assert_no_error(error);
+		g_assert_nonnull(silo);
+		silo_both = xb_builder_merge_compile(xml_both, flags[i]);
+		xml_merged = xb_silo_export(silo, XB_NODE_EXPORT_FLAG_INCLUDE_SIBLINGS, &error);
+		g_assert_no_error(error);
+		xml_compiled =
+		    xb_silo_export(silo_both, XB_NODE_EXPORT_FLAG_INCLUDE_SIBLINGS, &error);
+		g_assert_no_error(error);
+		g_assert_cmpstr(xml_merged, ==, xml_compiled);
+
+		/* the lookup tables are rebuilt for the merged strings */
+		n = xb_silo_query_first(silo,
+					"components/component[@type='firmware']/keyword",
+					&error);
+		g_assert_no_error(error);
+		g_assert_nonnull(n);
+		g_assert_cmpstr(xb_node_get_text(n), ==, "bios");
+		g_clear_object(&n);
+		n = xb_silo_query_first(silo, "release", &error);
+		g_assert_no_error(error);
+		g_assert_nonnull(n);
+		g_assert_cmpstr(xb_node_get_attr(n, "version"), ==, "1.2.3");
+	}
+}
+
+static void
+xb_builder_extract_func(void)
+{
+	const gchar *xml[] = {"<components origin=\"lvfs\">"
+			      "<component type=\"desktop\">"
+			      "<id>gimp.desktop</id>"
+			      "<name>GIMP</name>"
+			      "</component>"
+			      "<component type=\"firmware\">"
+			      "<id>dell.firmware</id>"
+			      "<name>Dell BIOS</name>"
+			      "<keyword>bios</keyword>"
+			      "</component>"
+			      "<component type=\"firmware\">"
+			      "<id>hp.firmware</id>"
+			      "</component>"
+			      "</components>",
+			      NULL};
+	g_autofree gchar *xml_new = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GPtrArray) components = NULL;
+	g_autoptr(GPtrArray) roots = NULL;
+	g_autoptr(XbBuilder) builder = xb_builder_new();
+	g_autoptr(XbNode) n = NULL;
+	g_autoptr(XbSilo) silo = NULL;
+	g_autoptr(XbSilo) silo_new = NULL;
+
+	/* copy two subtrees into a new silo */
+	silo = xb_builder_merge_compile(xml, XB_BUILDER_COMPILE_FLAG_NONE);
+	components = xb_silo_query(silo, "components/component[@type='firmware']", 0, &error);
+	g_assert_no_error(error);
+	g_assert_nonnull(components);
+	g_assert_cmpint(components->len, ==, 2);
+	silo_new =
+	    xb_builder_extract(builder, components, XB_BUILDER_COMPILE_FLAG_NONE, NULL, &error);
+	g_assert_no_error(error);
+	g_assert_nonnull(silo_new);
+	xml_new = xb_silo_export(silo_new, XB_NODE_EXPORT_FLAG_INCLUDE_SIBLINGS, &error);
+	g_assert_no_error(error);
+	g_assert_cmpstr(xml_new,
+			==,
+			"<component type=\"firmware\">"
+			"<id>dell.firmware</id>"
+			"<name>Dell BIOS</name>"
+			"<keyword>bios</keyword>"
+			"</component>"
+			"<component type=\"firmware\">"
+			"<id>hp.firmware</id>"
+			"</component>");
+
+	/* the extracted nodes are the new roots */
+	roots = xb_silo_query(silo_new, "component", 0, &error);
+	g_assert_no_error(error);
+	g_assert_nonnull(roots);
+	g_assert_cmpint(roots->len, ==, 2);
+	for (guint i = 0; i < roots->len; i++) {
+		XbNode *root = g_ptr_array_index(roots, i);
+		g_assert_null(xb_node_get_parent(root));
+		g_assert_cmpint(xb_node_get_depth(root), ==, 0);
+	}
+	n = xb_silo_query_first(silo_new, "component/name", &error);
+	g_assert_no_error(error);
+	g_assert_nonnull(n);
+	g_assert_cmpint(xb_node_get_depth(n), ==, 1);
+
+	/* only the referenced strings are kept */
+	g_assert_cmpint(xb_silo_get_size(silo_new), <, xb_silo_get_size(silo));
+	g_clear_object(&n);
+	n = xb_silo_query_first(silo_new, "component/id[text()='gimp.desktop']", &error);
+	g_assert_error(error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND);
+	g_assert_null(n);
+}
+
+static gboolean
+xb_builder_source_silo_fixup_cb(XbBuilderFixup *self,
+				XbBuilderNode *bn,
+				gpointer user_data,
+				GError **error)
+{
+	if (g_strcmp0(xb_builder_node_get_element(bn), "component") == 0)
+		xb_builder_node_set_attr(bn, "type", "desktop");
+	return TRUE;
+}
+
+static void
+xb_builder_source_silo_func(void)
+{
+	const gchar *xml[] = {"<components origin=\"lvfs\">"
+			      "<component>"
+			      "<id>gimp.desktop</id>"
+			      "<name>GIMP</name>tail"
+			      "</component>"
+			      "</components>",
+			      NULL};
+	gboolean ret;
+	g_autofree gchar *tmp_xmlb = g_build_filename(g_get_tmp_dir(), "source.xmlb", NULL);
+	g_autofree gchar *xml_expected = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GFile) file = g_file_new_for_path(tmp_xmlb);
+	g_autoptr(XbSilo) silo_src = NULL;
+
+	/* compile once to use as the input of the second stage */
+	silo_src = xb_builder_merge_compile(xml, XB_BUILDER_COMPILE_FLAG_NONE);
+	ret = xb_silo_save_to_file(silo_src, file, NULL, &error);
+	g_assert_no_error(error);
+	g_assert_true(ret);
+
+	/* the silo is imported with the fixups, prefix and info of the source */
+	for (guint i = 0; i < 3; i++) {
+		g_autofree gchar *xml_new = NULL;
+		g_autoptr(XbBuilder) builder = xb_builder_new();
+		g_autoptr(XbBuilderFixup) fixup = NULL;
+		g_autoptr(XbBuilderNode) info = xb_builder_node_new("info");
+		g_autoptr(XbBuilderSource) source = xb_builder_source_new();
+		g_autoptr(XbNode) n = NULL;
+		g_autoptr(XbSilo) silo = NULL;
+
+		if (i == 0) {
+			ret = xb_builder_source_load_xml(source,
+							 xml[0],
+							 XB_BUILDER_SOURCE_FLAG_NONE,
+							 &error);
+		} else if (i == 1) {
+			g_autoptr(GBytes) blob = xb_silo_get_bytes(silo_src);
+			ret = xb_builder_source_load_bytes(source,
+							   blob,
+							   XB_BUILDER_SOURCE_FLAG_NONE,
+							   &error);
+		} else {
+			ret = xb_builder_source_load_file(source,
+							  file,
+							  XB_BUILDER_SOURCE_FLAG_NONE,
+							  NULL,
+							  &error);
+		}
+		g_assert_no_error(error);
+		g_assert_true(ret);
+		fixup = xb_builder_fixup_new("AddType",
+					     xb_builder_source_silo_fixup_cb,
+					     NULL,
+					     NULL);
+		xb_builder_source_add_fixup(source, fixup);
+		xb_builder_source_set_prefix(source, "local");
+		xb_builder_node_insert_text(info, "scope", "user", NULL);
+		xb_builder_source_set_info(source, info);
+		xb_builder_import_source(builder, source);
+		silo = xb_builder_compile(builder, XB_BUILDER_COMPILE_FLAG_NONE, NULL, &error);
+		g_assert_no_error(error);
+		g_assert_nonnull(silo);
+
+		n = xb_silo_query_first(silo,
+					"local/components/component[@type='desktop']/info/scope",
+					&error);
+		g_assert_no_error(error);
+		g_assert_nonnull(n);
+		g_assert_cmpstr(xb_node_get_text(n), ==, "user");
+
+		/* identical to parsing the original XML */
+		xml_new = xb_silo_export(silo, XB_NODE_EXPORT_FLAG_INCLUDE_SIBLINGS, &error);
+		g_assert_no_error(error);
+		if (i == 0)
+			xml_expected = g_steal_pointer(&xml_new);
+		else
+			g_assert_cmpstr(xml_new, ==, xml_expected);
+	}
+	g_unlink(tmp_xmlb);
+}
+
+static void
+xb_builder_source_silo_attrs_func(void)
+{
+	gboolean ret;
+	const gchar *xml[] = {NULL, NULL};
+	g_autofree gchar *xml_new = NULL;
+	g_autoptr(GBytes) blob = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GString) str = g_string_new("<component");
+	g_autoptr(XbBuilder) builder = xb_builder_new();
+	g_autoptr(XbBuilderSource) source = xb_builder_source_new();
+	g_autoptr(XbSilo) silo = NULL;
+	g_autoptr(XbSilo) silo_src = NULL;
+
+	/* the most attributes a silo node can store */
+	for (guint i = 0; i < 63; i++)
+		g_string_append_printf(str, " attr%02u=\"value%02u\"", i, i);
+	g_string_append(str, "></component>");
+	xml[0] = str->str;
+	silo_src = xb_builder_merge_compile(xml, XB_BUILDER_COMPILE_FLAG_NONE);
+	blob = xb_silo_get_bytes(silo_src);
+
+	/* every attribute survives the import */
+	ret = xb_builder_source_load_bytes(source, blob, XB_BUILDER_SOURCE_FLAG_NONE, &error);
+	g_assert_no_error(error);
+	g_assert_true(ret);
+	xb_builder_import_source(builder, source);
+	silo = xb_builder_compile(builder, XB_BUILDER_COMPILE_FLAG_NONE, NULL, &error);
+	g_assert_no_error(error);
+	g_assert_nonnull(silo);
+	xml_new = xb_silo_export(silo, XB_NODE_EXPORT_FLAG_NONE, &error);
+	g_assert_no_error(error);
+	g_assert_cmpstr(xml_new, ==, str->str);
+}
+
+static gboolean
+xb_builder_fragment_cache_strip_cb(XbBuilderFixup *self,
+				   XbBuilderNode *bn,
+				   gpointer user_data,
+				   GError **error)
+{
+	if (g_strcmp0(xb_builder_node_get_element(bn), "name") == 0)
+		xb_builder_node_add_flag(bn, XB_BUILDER_NODE_FLAG_STRIP_TEXT);
+	return TRUE;
+}
+
+static GBytes *
+xb_builder_fragment_cache_strip_compile(GFile *cache, gboolean *loaded)
+{
+	gboolean ret;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(XbBuilder) builder = xb_builder_new();
+	g_autoptr(XbBuilderFixup) fixup = NULL;
+	g_autoptr(XbBuilderSource) source = xb_builder_source_new();
+	g_autoptr(XbSilo) silo = NULL;
+
+	/* both elements have the same text, but only one is stripped */
+	ret = xb_builder_source_load_xml(source,
+					 "<component>"
+					 "<name>  Paint  </name>"
+					 "<summary>  Paint  </summary>"
+					 "</component>",
+					 XB_BUILDER_SOURCE_FLAG_LITERAL_TEXT,
+					 &error);
+	g_assert_no_error(error);
+	g_assert_true(ret);
+	xb_builder_import_source(builder, source);
+	fixup = xb_builder_fixup_new("StripName", xb_builder_fragment_cache_strip_cb, NULL, NULL);
+	xb_builder_add_fixup(builder, fixup);
+	if (cache != NULL)
+		xb_builder_set_fragment_cache(builder, cache);
+	xb_builder_set_profile_flags(builder, XB_SILO_PROFILE_FLAG_APPEND);
+	silo = xb_builder_compile(builder, XB_BUILDER_COMPILE_FLAG_NONE, NULL, &error);
+	g_assert_no_error(error);
+	g_assert_nonnull(silo);
+	*loaded = g_strstr_len(xb_silo_get_profile_string(silo), -1, "load fragment") != NULL;
+	return xb_silo_get_bytes(silo);
+}
+
+static void
+xb_builder_fragment_cache_strip_func(void)
+{
+	gboolean loaded = FALSE;
+	gboolean ret;
+	g_autofree gchar *path = NULL;
+	g_autofree gchar *tmpdir = NULL;
+	g_autofree gchar *xml = NULL;
+	g_autoptr(GBytes) blob_full = NULL;
+	g_autoptr(GBytes) blob_saved = NULL;
+	g_autoptr(GBytes) blob_loaded = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GFile) cache = NULL;
+	g_autoptr(XbSilo) silo = xb_silo_new();
+
+	tmpdir = g_dir_make_tmp("libxmlb-fragments-XXXXXX", &error);
+	g_assert_no_error(error);
+	path = g_build_filename(tmpdir, "cache", NULL);
+	cache = g_file_new_for_path(path);
+
+	/* stripping one node must not change the other */
+	blob_full = xb_builder_fragment_cache_strip_compile(NULL, &loaded);
+	g_assert_false(loaded);
+	blob_saved = xb_builder_fragment_cache_strip_compile(cache, &loaded);
+	g_assert_false(loaded);
+	blob_loaded = xb_builder_fragment_cache_strip_compile(cache, &loaded);
+	g_assert_true(loaded);
+	g_assert_true(g_bytes_equal(blob_full, blob_saved));
+	g_assert_true(g_bytes_equal(blob_full, blob_loaded));
+	ret = xb_silo_load_from_bytes(silo, blob_loaded, XB_SILO_LOAD_FLAG_NONE, &error);
+	g_assert_no_error(error);
+	g_assert_true(ret);
+	xml = xb_silo_export(silo, XB_NODE_EXPORT_FLAG_NONE, &error);
+	g_assert_no_error(error);
+	g_assert_cmpstr(xml,
+			==,
+			"<component><name>Paint</name><summary>  Paint  </summary></component>");
+}
+
+static gboolean
+xb_builder_tokenize_fixup_cb(XbBuilderFixup *self,
+			     XbBuilderNode *bn,
+			     gpointer user_data,
+			     GError **error)
+{
+	gboolean deferred = GPOINTER_TO_UINT(user_data);
+	if (g_strcmp0(xb_builder_node_get_element(bn), "name") != 0)
+		return TRUE;
+	if (deferred)
+		xb_builder_node_add_flag(bn, XB_BUILDER_NODE_FLAG_TOKENIZE_TEXT);
+	else
+		xb_builder_node_tokenize_text(bn);
+	return TRUE;
+}
+
+static void
+xb_builder_tokenize_func(void)
+{
+	g_autoptr(GBytes) blob_serial = NULL;
+	g_autoptr(GBytes) blob_threaded = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(XbNode) n = NULL;
+
+	for (guint j = 0; j < 2; j++) {
+		g_autoptr(XbBuilder) builder = xb_builder_new();
+		g_autoptr(XbBuilderFixup) fixup = NULL;
+		g_autoptr(XbSilo) silo = NULL;
+
+		fixup = xb_builder_fixup_new("TextTokenize",
+					     xb_builder_tokenize_fixup_cb,
+					     GUINT_TO_POINTER(j),
+					     NULL);
+		xb_builder_add_fixup(builder, fixup);
+		for (guint i = 0; i < 40; i++) {
+			gboolean ret;
+			g_autofree gchar *xml = NULL;
+			g_autoptr(XbBuilderSource) source = xb_builder_source_new();
+			xml = g_strdup_printf("<component>"
+					      "<id>app%02u.desktop</id>"
+					      "<name>Größe App %u<lang>Deutsch</lang></name>"
+					      "</component>",
+					      i,
+					      i);
+			ret = xb_builder_source_load_xml(source,
+							 xml,
+							 XB_BUILDER_SOURCE_FLAG_NONE,
+							 &error);
+			g_assert_no_error(error);
+			g_assert_true(ret);
+			xb_builder_import_source(builder, source);
+		}
+		xb_builder_set_max_threads(builder, j == 0 ? 1 : 4);
+		silo = xb_builder_compile(builder, XB_BUILDER_COMPILE_FLAG_NONE, NULL, &error);
+		g_assert_no_error(error);
+		g_assert_nonnull(silo);
+		if (j == 0) {
+			blob_serial = xb_silo_get_bytes(silo);
+		} else {
+			blob_threaded = xb_silo_get_bytes(silo);
+			n = xb_silo_query_first(silo, "component/name[text()~='gro']", &error);
+			g_assert_no_error(error);
+			g_assert_nonnull(n);
+			g_clear_object(&n);
+
+			/* only the flagged node, not the children */
+			n = xb_silo_query_first(silo, "component/name/lang", &error);
+			g_assert_no_error(error);
+			g_assert_nonnull(n);
+			g_assert_false(xb_silo_node_has_flag(xb_node_get_sn(n),
+							     XB_SILO_NODE_FLAG_IS_TOKENIZED));
+		}
+	}
+
+	/* tokens written back in tree order, so identical */
+	g_assert_cmpint(g_bytes_compare(blob_serial, blob_threaded), ==, 0);
+}
+
+static XbBuilder *
+xb_builder_compile_to_file_builder(void)
+{
+	gboolean ret;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GString) xml_big = g_string_new("<components>");
+	g_autoptr(XbBuilder) builder = xb_builder_new();
+	g_autoptr(XbBuilderNode) bn = xb_builder_node_new("custom");
+	g_autoptr(XbBuilderNode) info = xb_builder_node_new("info");
+	const gchar *xmls[] = {
+	    "<component><id>gimp.desktop</id><name>GIMP</name>"
+	    "<name xml:lang=\"de\">Die GIMP</name><p>Hello <b>world</b> tail</p></component>",
+	    "<component><id>broken</id>",
+	    "<component><id>inkscape.desktop</id></component>",
+	    NULL,
+	};
+
+	/* big enough that the nodetab has to be flushed to disk */
+	for (guint i = 0; i < 20000; i++)
+		g_string_append_printf(xml_big,
+				       "<component type=\"desktop\"><id>app%05u</id></component>",
+				       i);
+	g_string_append(xml_big, "</components>");
+	for (guint i = 0; xmls[i] != NULL; i++) {
+		g_autoptr(XbBuilderSource) source = xb_builder_source_new();
+		ret = xb_builder_source_load_xml(source,
+						 xmls[i],
+						 XB_BUILDER_SOURCE_FLAG_NONE,
+						 &error);
+		g_assert_no_error(error);
+		g_assert_true(ret);
+		xb_builder_source_set_prefix(source, "local");
+		if (i == 0) {
+			xb_builder_node_insert_text(info, "filename", "/tmp/gimp.xml", NULL);
+			xb_builder_source_set_info(source, info);
+		}
+		xb_builder_import_source(builder, source);
+	}
+	{
+		g_autoptr(XbBuilderSource) source = xb_builder_source_new();
+		ret = xb_builder_source_load_xml(source,
+						 xml_big->str,
+						 XB_BUILDER_SOURCE_FLAG_NONE,
+						 &error);
+		g_assert_no_error(error);
+		g_assert_true(ret);
+		xb_builder_import_source(builder, source);
+	}
+	xb_builder_node_set_attr(bn, "key", "value");
+	xb_builder_node_insert_text(bn, "child", "text", NULL);
+	xb_builder_import_node(builder, bn);
+	xb_builder_add_locale(builder, "C");
+	return g_steal_pointer(&builder);
+}
+
+static void
+xb_builder_compile_to_file_func(void)
+{
+	g_autofree gchar *tmp_xmlb = g_build_filename(g_get_tmp_dir(), "stream.xmlb", NULL);
+	g_autofree gchar *xml_memory = NULL;
+	g_autofree gchar *xml_stream = NULL;
+	g_autofree gchar *buf = NULL;
+	gsize bufsz = 0;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GFile) file = g_file_new_for_path(tmp_xmlb);
+	g_autoptr(XbBuilder) builder_memory = xb_builder_compile_to_file_builder();
+	g_autoptr(XbBuilder) builder_stream = xb_builder_compile_to_file_builder();
+	g_autoptr(XbSilo) silo_memory = NULL;
+	g_autoptr(XbSilo) silo_stream = NULL;
+	g_autoptr(XbSilo) silo_verify = xb_silo_new();
+	g_autoptr(XbSilo) silo_unsupported = NULL;
+	g_autoptr(XbNode) n = NULL;
+	gboolean ret;
+
+	silo_memory = xb_builder_compile(builder_memory,
+					 XB_BUILDER_COMPILE_FLAG_IGNORE_INVALID |
+					     XB_BUILDER_COMPILE_FLAG_NATIVE_LANGS,
+					 NULL,
+					 &error);
+	g_assert_no_error(error);
+	g_assert_nonnull(silo_memory);
+	silo_stream = xb_builder_compile_to_file(builder_stream,
+						 file,
+						 XB_BUILDER_COMPILE_FLAG_IGNORE_INVALID |
+						     XB_BUILDER_COMPILE_FLAG_NATIVE_LANGS,
+						 NULL,
+						 &error);
+	g_assert_no_error(error);
+	g_assert_nonnull(silo_stream);
+
+	/* same document, same GUID */
+	xml_memory = xb_silo_export(silo_memory, XB_NODE_EXPORT_FLAG_NONE, &error);
+	g_assert_no_error(error);
+	xml_stream = xb_silo_export(silo_stream, XB_NODE_EXPORT_FLAG_NONE, &error);
+	g_assert_no_error(error);
+	g_assert_cmpstr(xml_stream, ==, xml_memory);
+	g_assert_cmpstr(xb_silo_get_guid(silo_stream), ==, xb_silo_get_guid(silo_memory));
+	n = xb_silo_query_first(silo_stream, "local/component/info/filename", &error);
+	g_assert_no_error(error);
+	g_assert_nonnull(n);
+
+	/* the checksum and links are valid */
+	ret = xb_silo_load_from_file(silo_verify, file, XB_SILO_LOAD_FLAG_VERIFY, NULL, &error);
+	g_assert_no_error(error);
+	g_assert_true(ret);
+
+	/* strings from the ignored source were dropped from the strtab */
+	ret = g_file_get_contents(tmp_xmlb, &buf, &bufsz, &error);
+	g_assert_no_error(error);
+	g_assert_true(ret);
+	for (gsize i = 0; i + sizeof("broken") <= bufsz; i++)
+		g_assert_cmpint(memcmp(buf + i, "broken", sizeof("broken")), !=, 0);
+
+	/* needs the whole tree */
+	silo_unsupported = xb_builder_compile_to_file(builder_stream,
+						      file,
+						      XB_BUILDER_COMPILE_FLAG_SINGLE_LANG,
+						      NULL,
+						      &error);
+	g_assert_error(error, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED);
+	g_assert_null(silo_unsupported);
+}
+
+static void
+xb_builder_front_coded_strtab_func(void)
+{
+	gboolean ret;
+	guint32 decoded;
+	g_autofree gchar *xml_fc = NULL;
+	g_autofree gchar *xml_flat = NULL;
+	g_autofree gchar *xml_lazy = NULL;
+	g_autoptr(GBytes) blob_fc = NULL;
+	g_autoptr(GBytes) blob_flat = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GString) xml = g_string_new("<components>");
+	g_autoptr(XbNode) n = NULL;
+	g_autoptr(XbSilo) silo_fc = NULL;
+	g_autoptr(XbSilo) silo_flat = NULL;
+	g_autoptr(XbSilo) silo_lazy = xb_silo_new();
+
+	/* lots of shared prefixes */
+	for (guint i = 0; i < 100; i++) {
+		g_string_append_printf(xml,
+				       "<component type=\"desktop\">"
+				       "<id>org.freedesktop.Application%u</id>"
+				       "<url type=\"homepage\">https://www.freedesktop.org/app/%u</url>"
+				       "<icon>/usr/share/icons/hicolor/64x64/apps/app%u.png</icon>"
+				       "</component>",
+				       i,
+				       i,
+				       i);
+	}
+	g_string_append(xml, "</components>");
+	for (guint i = 0; i < 2; i++) {
+		g_autoptr(XbBuilder) builder = xb_builder_new();
+		ret = xb_test_import_xml(builder, xml->str, &error);
+		g_assert_no_error(error);
+		g_assert_true(ret);
+		if (i == 0) {
+			silo_flat = xb_builder_compile(builder,
+						       XB_BUILDER_COMPILE_FLAG_NONE,
+						       NULL,
+						       &error);
+			g_assert_no_error(error);
+			g_assert_nonnull(silo_flat);
+		} else {
+			silo_fc = xb_builder_compile(builder,
+						     XB_BUILDER_COMPILE_FLAG_FRONT_CODED_STRTAB |
+							 XB_BUILDER_COMPILE_FLAG_STRTAB_INDEX,
+						     NULL,
+						     &error);
+			g_assert_no_error(error);
+			g_assert_nonnull(silo_fc);
+		}
+	}
+
+	/* smaller, but otherwise identical */
+	blob_flat = xb_silo_get_bytes(silo_flat);
+	blob_fc = xb_silo_get_bytes(silo_fc);
+	g_assert_cmpint(g_bytes_get_size(blob_fc), <, g_bytes_get_size(blob_flat));
+	xml_flat = xb_silo_export(silo_flat, XB_NODE_EXPORT_FLAG_NONE, &error);
+	g_assert_no_error(error);
+	xml_fc = xb_silo_export(silo_fc, XB_NODE_EXPORT_FLAG_NONE, &error);
+	g_assert_no_error(error);
+	g_assert_cmpstr(xml_fc, ==, xml_flat);
+
+	/* decoded strings are stable */
+	n = xb_silo_query_first(
+	    silo_fc,
+	    "components/component/url[text()='https://www.freedesktop.org/app/42']/../id",
+	    &error);
+	g_assert_no_error(error);
+	g_assert_nonnull(n);
+	g_assert_cmpstr(xb_node_get_text(n), ==, "org.freedesktop.Application42");
+	g_assert_true(xb_node_get_text(n) == xb_node_get_text(n));
+	g_assert_cmpint(xb_silo_strtab_index_lookup(silo_fc, "org.freedesktop.Application99"),
+			!=,
+			XB_SILO_UNSET);
+
+	/* strings are decoded one restart interval at a time, and only once */
+	ret = xb_silo_load_from_bytes(silo_lazy, blob_fc, XB_SILO_LOAD_FLAG_NONE, &error);
+	g_assert_no_error(error);
+	g_assert_true(ret);
+	decoded = xb_silo_get_strtab_fc_decoded(silo_lazy);
+	xml_lazy = xb_silo_export(silo_lazy, XB_NODE_EXPORT_FLAG_NONE, &error);
+	g_assert_no_error(error);
+	g_assert_cmpstr(xml_lazy, ==, xml_flat);
+	g_assert_cmpint(xb_silo_get_strtab_fc_decoded(silo_lazy), >, decoded);
+	decoded = xb_silo_get_strtab_fc_decoded(silo_lazy);
+	g_clear_pointer(&xml_lazy, g_free);
+	xml_lazy = xb_silo_export(silo_lazy, XB_NODE_EXPORT_FLAG_NONE, &error);
+	g_assert_no_error(error);
+	g_assert_cmpstr(xml_lazy, ==, xml_flat);
+	g_assert_cmpint(xb_silo_get_strtab_fc_decoded(silo_lazy), ==, decoded);
+}
+
+static void
+xb_silo_verify_func(void)
+{
+	gboolean ret;
+	guint8 *data;
+	gsize datasz = 0;
+	XbSiloHeader *hdr;
+	XbSiloNode *sn;
+	g_autoptr(GBytes) blob = NULL;
+	g_autoptr(GBytes) blob_bad = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(XbNode) n = NULL;
+	g_autoptr(XbSilo) silo = NULL;
+	g_autoptr(XbSilo) silo_verified = xb_silo_new();
+
+	silo = xb_silo_new_from_xml("<components><component><id>gimp.desktop</id></component>"
+				    "<component><id>inkscape.desktop</id></component></components>",
+				    &error);
+	g_assert_no_error(error);
+	g_assert_nonnull(silo);
+	blob = xb_silo_get_bytes(silo);
+	ret = xb_silo_load_from_bytes(silo_verified, blob, XB_SILO_LOAD_FLAG_VERIFY, &error);
+	g_assert_no_error(error);
+	g_assert_true(ret);
+	g_assert_true(xb_silo_is_verified(silo_verified));
+	n = xb_silo_query_first(silo_verified, "components/component/id", &error);
+	g_assert_no_error(error);
+	g_assert_nonnull(n);
+	g_assert_cmpstr(xb_node_get_text(n), ==, "gimp.desktop");
+	g_clear_object(&n);
+
+	/* leaves are not an error */
+	n = xb_silo_query_first(silo_verified, "components/component/id/child", &error);
+	g_assert_error(error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND);
+	g_assert_null(n);
+	g_clear_error(&error);
+
+	/* any change is detected by the checksum */
+	data = g_malloc(g_bytes_get_size(blob));
+	memcpy(data, g_bytes_get_data(blob, &datasz), g_bytes_get_size(blob));
+	data[datasz - 2] ^= 0xff;
+	blob_bad = g_bytes_new_take(data, datasz);
+	ret = xb_silo_load_from_bytes(silo_verified, blob_bad, XB_SILO_LOAD_FLAG_VERIFY, &error);
+	g_assert_error(error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA);
+	g_assert_false(ret);
+	g_clear_error(&error);
+	g_clear_pointer(&blob_bad, g_bytes_unref);
+
+	/* ...and a damaged link by the sweep, even with a matching checksum */
+	data = g_malloc(g_bytes_get_size(blob));
+	memcpy(data, g_bytes_get_data(blob, &datasz), g_bytes_get_size(blob));
+	hdr = (XbSiloHeader *)data;
+	sn = (XbSiloNode *)(data + sizeof(XbSiloHeader));
+	sn->end = hdr->strtab + 1;
+	hdr->checksum = xb_silo_compute_checksum(data, datasz);
+	blob_bad = g_bytes_new_take(data, datasz);
+	ret = xb_silo_load_from_bytes(silo_verified, blob_bad, XB_SILO_LOAD_FLAG_NONE, &error);
+	g_assert_no_error(error);
+	g_assert_true(ret);
+	ret = xb_silo_load_from_bytes(silo_verified, blob_bad, XB_SILO_LOAD_FLAG_VERIFY, &error);
+	g_assert_error(error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA);
+	g_assert_false(ret);
+}
+
+static gpointer
+xb_silo_snapshot_thread_cb(gpointer user_data)
+{
+	XbSilo *snapshot = XB_SILO(user_data);
+	for (guint i = 0; i < 100; i++) {
+		g_autoptr(GError) error = NULL;
+		g_autoptr(XbNode) n = NULL;
+		n = xb_silo_query_first(snapshot, "components/component/id", &error);
+		g_assert_no_error(error);
+		g_assert_nonnull(n);
+		g_assert_cmpstr(xb_node_get_text(n), ==, "gimp.desktop");
+	}
+	return NULL;
+}
+
+static gboolean
+xb_silo_snapshot_yes_cb(XbMachine *self,
+			XbStack *stack,
+			gboolean *result,
+			gpointer user_data,
+			gpointer exec_data,
+			GError **error)
+{
+	return xb_stack_push_bool(stack, TRUE, error);
+}
+
+static void
+xb_silo_snapshot_func(void)
+{
+	gboolean ret;
+	GThread *thread;
+	g_autoptr(GBytes) blob1 = NULL;
+	g_autoptr(GBytes) blob2 = NULL;
+	g_autoptr(GBytes) blob_bad = g_bytes_new_static("XMLb", 4);
+	g_autoptr(GError) error = NULL;
+	g_autoptr(XbNode) n = NULL;
+	g_autoptr(XbSilo) silo = xb_silo_new();
+	g_autoptr(XbSilo) silo1 = NULL;
+	g_autoptr(XbSilo) silo2 = NULL;
+	g_autoptr(XbSilo) snapshot1 = NULL;
+	g_autoptr(XbSilo) snapshot2 = NULL;
+	g_autoptr(XbSilo) snapshot3 = NULL;
+
+	/* nothing loaded yet */
+	snapshot1 = xb_silo_get_snapshot(silo, &error);
+	g_assert_error(error, G_IO_ERROR, G_IO_ERROR_NOT_INITIALIZED);
+	g_assert_null(snapshot1);
+	g_clear_error(&error);
+
+	silo1 = xb_silo_new_from_xml("<components><component><id>gimp.desktop</id>"
+				     "</component></components>",
+				     &error);
+	g_assert_no_error(error);
+	g_assert_nonnull(silo1);
+	blob1 = xb_silo_get_bytes(silo1);
+	silo2 = xb_silo_new_from_xml("<components><component><id>inkscape.desktop</id>"
+				     "</component></components>",
+				     &error);
+	g_assert_no_error(error);
+	g_assert_nonnull(silo2);
+	blob2 = xb_silo_get_bytes(silo2);
+
+	/* the snapshot is shared until the next load */
+	ret = xb_silo_load_from_bytes(silo, blob1, XB_SILO_LOAD_FLAG_NONE, &error);
+	g_assert_no_error(error);
+	g_assert_true(ret);
+	xb_machine_add_method(xb_silo_get_machine(silo),
+			      "yes",
+			      0,
+			      xb_silo_snapshot_yes_cb,
+			      NULL,
+			      NULL);
+	snapshot1 = xb_silo_get_snapshot(silo, &error);
+	g_assert_no_error(error);
+	g_assert_nonnull(snapshot1);
+	snapshot2 = xb_silo_get_snapshot(silo, &error);
+	g_assert_no_error(error);
+	g_assert_true(snapshot1 == snapshot2);
+	g_clear_object(&snapshot2);
+	snapshot2 = xb_silo_get_snapshot(snapshot1, &error);
+	g_assert_no_error(error);
+	g_assert_true(snapshot1 == snapshot2);
+	g_clear_object(&snapshot2);
+
+	/* methods added to the machine are copied */
+	n = xb_silo_query_first(snapshot1, "components/component[yes()]/id", &error);
+	g_assert_no_error(error);
+	g_assert_nonnull(n);
+	g_assert_cmpstr(xb_node_get_text(n), ==, "gimp.desktop");
+	g_clear_object(&n);
+
+	/* snapshots cannot be reloaded */
+	ret = xb_silo_load_from_bytes(snapshot1, blob2, XB_SILO_LOAD_FLAG_NONE, &error);
+	g_assert_error(error, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED);
+	g_assert_false(ret);
+	g_clear_error(&error);
+
+	/* reload while another thread is querying the old snapshot */
+	thread = g_thread_new("snapshot", xb_silo_snapshot_thread_cb, snapshot1);
+	for (guint i = 0; i < 20; i++) {
+		ret = xb_silo_load_from_bytes(silo,
+					      i % 2 == 0 ? blob2 : blob1,
+					      XB_SILO_LOAD_FLAG_NONE,
+					      &error);
+		g_assert_no_error(error);
+		g_assert_true(ret);
+		g_clear_object(&snapshot2);
+		snapshot2 = xb_silo_get_snapshot(silo, &error);
+		g_assert_no_error(error);
+		g_assert_nonnull(snapshot2);
+		g_assert_true(snapshot2 != snapshot1);
+	}
+	g_thread_join(thread);
+
+	/* a failed load keeps the last snapshot */
+	ret = xb_silo_load_from_bytes(silo, blob_bad, XB_SILO_LOAD_FLAG_NONE, &error);
+	g_assert_error(error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA);
+	g_assert_false(ret);
+	g_clear_error(&error);
+	snapshot3 = xb_silo_get_snapshot(silo, &error);
+	g_assert_no_error(error);
+	g_assert_true(snapshot3 == snapshot2);
+	g_assert_true(xb_silo_is_valid(snapshot3));
+	n = xb_silo_query_first(snapshot3, "components/component/id", &error);
+	g_assert_no_error(error);
+	g_assert_nonnull(n);
+	g_assert_cmpstr(xb_node_get_text(n), ==, "gimp.desktop");
+}
+
+static void
+xb_silo_compressed_func(void)
+{
+	gboolean ret;
+	g_autofree gchar *tmp_xmlb = g_build_filename(g_get_tmp_dir(), "compressed.xmlb", NULL);
+	g_autofree gchar *xml_compressed = NULL;
+	g_autofree gchar *xml_plain = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GFile) file = g_file_new_for_path(tmp_xmlb);
+	g_autoptr(GString) xml = g_string_new("<components>");
+	g_autoptr(XbNode) n = NULL;
+	g_autoptr(XbSilo) silo = NULL;
+	g_autoptr(XbSilo) silo_compressed = xb_silo_new();
+
+#ifndef HAVE_ZSTD
+	/* not supported */
+	g_test_skip("compiled without -Dzstd");
+	return;
+#endif
+
+	/* enough for a few blocks */
+	for (guint i = 0; i < 2000; i++) {
+		g_string_append_printf(xml,
+				       "<component type=\"firmware\"><id>%06u.firmware</id>"
+				       "<name>ColorHug%u</name></component>",
+				       i,
+				       i);
+	}
+	g_string_append(xml, "</components>");
+	silo = xb_silo_new_from_xml(xml->str, &error);
+	g_assert_no_error(error);
+	g_assert_nonnull(silo);
+	ret = xb_silo_save_to_file_compressed(silo, file, NULL, &error);
+	g_assert_no_error(error);
+	g_assert_true(ret);
+
+	/* opt-in only */
+	ret = xb_silo_load_from_file(silo_compressed, file, XB_SILO_LOAD_FLAG_NONE, NULL, &error);
+	g_assert_error(error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA);
+	g_assert_false(ret);
+	g_clear_error(&error);
+	ret = xb_silo_load_from_file(silo_compressed,
+				     file,
+				     XB_SILO_LOAD_FLAG_COMPRESSED,
+				     NULL,
+				     &error);
+	g_assert_no_error(error);
+	g_assert_true(ret);
+
+	/* only the blocks that are used get decompressed */
+	n = xb_silo_query_first(silo_compressed, "components/component/id", &error);
+	g_assert_no_error(error);
+	g_assert_nonnull(n);
+	g_assert_cmpstr(xb_node_get_text(n), ==, "000000.firmware");
+	g_assert_cmpint(xb_silo_get_blocks_decompressed(silo_compressed),
+			<,
+			xb_silo_get_blocks_decompressed(silo));
+
+	/* everything else is identical */
+	xml_plain = xb_silo_export(silo, XB_NODE_EXPORT_FLAG_NONE, &error);
+	g_assert_no_error(error);
+	xml_compressed = xb_silo_export(silo_compressed, XB_NODE_EXPORT_FLAG_NONE, &error);
+	g_assert_no_error(error);
+	g_assert_cmpstr(xml_compressed, ==, xml_plain);
+	g_assert_cmpint(xb_silo_get_blocks_decompressed(silo_compressed),
+			==,
+			xb_silo_get_blocks_decompressed(silo));
+}
+
+static void
+xb_silo_compressed_corrupt_func(void)
+{
+	gboolean ret;
+	gsize bufsz = 0;
+	guint32 off;
+	guint32 *offs;
+	const XbSiloBlocksHeader *hdr;
+	g_autofree gchar *buf = NULL;
+	g_autofree gchar *tmp_xmlb = g_build_filename(g_get_tmp_dir(), "corrupt.xmlb", NULL);
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GFile) file = g_file_new_for_path(tmp_xmlb);
+	g_autoptr(GString) xml = g_string_new("<components>");
+	g_autoptr(XbSilo) silo = NULL;
+	g_autoptr(XbSilo) silo_corrupt = xb_silo_new();
+
+#ifndef HAVE_ZSTD
+	/* not supported */
+	g_test_skip("compiled without -Dzstd");
+	return;
+#endif
+
+	for (guint i = 0; i < 2000; i++) {
+		g_string_append_printf(xml,
+				       "<component type=\"firmware\"><id>%06u.firmware</id>"
+				       "<name>ColorHug%u</name></component>",
+				       i,
+				       i);
+	}
+	g_string_append(xml, "</components>");
+	silo = xb_silo_new_from_xml(xml->str, &error);
+	g_assert_no_error(error);
+	g_assert_nonnull(silo);
+	ret = xb_silo_save_to_file_compressed(silo, file, NULL, &error);
+	g_assert_no_error(error);
+	g_assert_true(ret);
+	ret = g_file_get_contents(tmp_xmlb, &buf, &bufsz, &error);
+	g_assert_no_error(error);
+	g_assert_true(ret);
+	hdr = (const XbSiloBlocksHeader *)buf;
+	g_assert_cmpint(hdr->n_blocks, >, 1);
+	offs = (guint32 *)(buf + sizeof(XbSiloBlocksHeader));
+
+	/* a block that is shorter than the index says */
+	offs[1]++;
+	ret = g_file_set_contents(tmp_xmlb, buf, bufsz, &error);
+	g_assert_no_error(error);
+	g_assert_true(ret);
+	ret = xb_silo_load_from_file(silo_corrupt, file, XB_SILO_LOAD_FLAG_COMPRESSED, NULL, &error);
+	g_assert_error(error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA);
+	g_assert_false(ret);
+	g_clear_error(&error);
+	offs[1]--;
+
+	/* damaged data in the last block, which is needed to load the silo */
+	off = offs[hdr->n_blocks - 1] + (offs[hdr->n_blocks] - offs[hdr->n_blocks - 1]) / 2;
+	buf[off] ^= 0xff;
+	ret = g_file_set_contents(tmp_xmlb, buf, bufsz, &error);
+	g_assert_no_error(error);
+	g_assert_true(ret);
+	ret = xb_silo_load_from_file(silo_corrupt, file, XB_SILO_LOAD_FLAG_COMPRESSED, NULL, &error);
+	g_assert_error(error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA);
+	g_assert_false(ret);
+	g_unlink(tmp_xmlb);
 }
 
 static void
@@ -481,6 +2004,78 @@ xb_builder_custom_mime_func(void)
 			xml);
 }
 
+static gchar *
+xb_builder_source_fingerprint_ctime(GFile *file)
+{
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GFileInfo) fileinfo = NULL;
+
+	fileinfo = g_file_query_info(file,
+				     G_FILE_ATTRIBUTE_TIME_CHANGED
+				     "," G_FILE_ATTRIBUTE_TIME_CHANGED_USEC,
+				     G_FILE_QUERY_INFO_NONE,
+				     NULL,
+				     &error);
+	g_assert_no_error(error);
+	g_assert_nonnull(fileinfo);
+	return g_strdup_printf(
+	    "%" G_GUINT64_FORMAT ".%" G_GUINT32_FORMAT,
+	    g_file_info_get_attribute_uint64(fileinfo, G_FILE_ATTRIBUTE_TIME_CHANGED),
+	    g_file_info_get_attribute_uint32(fileinfo, G_FILE_ATTRIBUTE_TIME_CHANGED_USEC));
+}
+
+static gchar *
+xb_builder_source_fingerprint_guid(const gchar *fn, const gchar *xml)
+{
+	gboolean ret;
+	g_autofree gchar *ctime = NULL;
+	g_autofree gchar *ctime_new = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GFile) file = g_file_new_for_path(fn);
+	g_autoptr(XbBuilder) builder = xb_builder_new();
+	g_autoptr(XbBuilderSource) source = xb_builder_source_new();
+	g_autoptr(XbSilo) silo = NULL;
+
+	ret = g_file_set_contents(fn, xml, -1, &error);
+	g_assert_no_error(error);
+	g_assert_true(ret);
+	ctime = xb_builder_source_fingerprint_ctime(file);
+	ret = xb_builder_source_load_file(source,
+					  file,
+					  XB_BUILDER_SOURCE_FLAG_FINGERPRINT,
+					  NULL,
+					  &error);
+	g_assert_no_error(error);
+	g_assert_true(ret);
+	xb_builder_import_source(builder, source);
+	silo = xb_builder_compile(builder, XB_BUILDER_COMPILE_FLAG_NONE, NULL, &error);
+	g_assert_no_error(error);
+	g_assert_nonnull(silo);
+
+	/* the source file is never written to */
+	ctime_new = xb_builder_source_fingerprint_ctime(file);
+	g_assert_cmpstr(ctime, ==, ctime_new);
+	return g_strdup(xb_silo_get_guid(silo));
+}
+
+static void
+xb_builder_source_fingerprint_func(void)
+{
+	g_autofree gchar *fn = g_build_filename(g_get_tmp_dir(), "fingerprint.xml", NULL);
+	g_autofree gchar *guid1 = NULL;
+	g_autofree gchar *guid2 = NULL;
+	g_autofree gchar *guid3 = NULL;
+
+	/* rewriting the same content changes the ctime but not the GUID */
+	guid1 = xb_builder_source_fingerprint_guid(fn, "<components><c/></components>");
+	guid2 = xb_builder_source_fingerprint_guid(fn, "<components><c/></components>");
+	g_assert_cmpstr(guid1, ==, guid2);
+
+	/* different content */
+	guid3 = xb_builder_source_fingerprint_guid(fn, "<components><d/></components>");
+	g_assert_cmpstr(guid1, !=, guid3);
+}
+
 static void
 xb_builder_source_lzma_func(void)
 {
@@ -981,59 +2576,201 @@ xb_builder_node_vfunc_remove_func(void)
 	g_assert_no_error(error);
 	g_assert_nonnull(silo);
 
-	/* check the XML */
-	xml2 = xb_silo_export(silo, XB_NODE_EXPORT_FLAG_NONE, &error);
-	g_assert_no_error(error);
-	g_assert_nonnull(xml2);
-	g_print("%s\n", xml2);
-	g_assert_cmpstr("<components>"
-			"<component>"
-			"<id>inkscape.desktop</id>"
-			"</component>"
-			"</components>",
+	/* check the XML */
+	xml2 = xb_silo_export(silo, XB_NODE_EXPORT_FLAG_NONE, &error);
+	g_assert_no_error(error);
+	g_assert_nonnull(xml2);
+	g_print("%s\n", xml2);
+	g_assert_cmpstr("<components>"
+			"<component>"
+			"<id>inkscape.desktop</id>"
+			"</component>"
+			"</components>",
+			==,
+			xml2);
+}
+
+static gboolean
+xb_builder_fixup_root_node_only_cb(XbBuilderFixup *self,
+				   XbBuilderNode *bn,
+				   gpointer user_data,
+				   GError **error)
+{
+	g_debug(">%s<", xb_builder_node_get_element(bn));
+	g_assert_cmpstr(xb_builder_node_get_element(bn), ==, NULL);
+	return TRUE;
+}
+
+static void
+xb_builder_node_vfunc_depth_func(void)
+{
+	gboolean ret;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(XbBuilder) builder = xb_builder_new();
+	g_autoptr(XbBuilderFixup) fixup = NULL;
+	g_autoptr(XbBuilderSource) source = xb_builder_source_new();
+	g_autoptr(XbSilo) silo = NULL;
+	const gchar *xml = "  <components>\n"
+			   "    <component>\n"
+			   "      <id>gimp.desktop</id>\n"
+			   "    </component>\n"
+			   "  </components>\n";
+
+	/* add fixup */
+	fixup = xb_builder_fixup_new("OnlyRoot", xb_builder_fixup_root_node_only_cb, NULL, NULL);
+	xb_builder_fixup_set_max_depth(fixup, 0);
+	xb_builder_source_add_fixup(source, fixup);
+
+	/* import some XML */
+	ret = xb_builder_source_load_xml(source, xml, XB_BUILDER_SOURCE_FLAG_NONE, &error);
+	g_assert_no_error(error);
+	g_assert_true(ret);
+	xb_builder_import_source(builder, source);
+	silo = xb_builder_compile(builder, XB_BUILDER_COMPILE_FLAG_NONE, NULL, &error);
+	g_assert_no_error(error);
+	g_assert_nonnull(silo);
+}
+
+static gboolean
+xb_builder_fixup_rename_cb(XbBuilderFixup *self,
+			   XbBuilderNode *bn,
+			   gpointer user_data,
+			   GError **error)
+{
+	guint *cnt = (guint *)user_data;
+	(*cnt)++;
+	if (g_strcmp0(xb_builder_node_get_element(bn), "application") == 0)
+		xb_builder_node_set_element(bn, "component");
+	return TRUE;
+}
+
+static gboolean
+xb_builder_fixup_mark_cb(XbBuilderFixup *self,
+			 XbBuilderNode *bn,
+			 gpointer user_data,
+			 GError **error)
+{
+	guint *cnt = (guint *)user_data;
+	(*cnt)++;
+	if (g_strcmp0(xb_builder_node_get_element(bn), "component") == 0 ||
+	    g_strcmp0(xb_builder_node_get_element(bn), "name") == 0)
+		xb_builder_node_set_attr(bn, "seen", "true");
+	return TRUE;
+}
+
+static void
+xb_builder_fixup_elements_func(void)
+{
+	guint cnt_all = 0;
+	guint cnt_filtered = 0;
+	g_autofree gchar *xml_all = NULL;
+	g_autofree gchar *xml_filtered = NULL;
+	g_autoptr(GError) error = NULL;
+	const gchar *xml = "<components>"
+			   "<application><id>gimp.desktop</id><name>GIMP</name></application>"
+			   "<component><id>inkscape.desktop</id><name>Inkscape</name></component>"
+			   "</components>";
+
+	for (guint j = 0; j < 2; j++) {
+		gboolean ret;
+		guint *cnt = j == 0 ? &cnt_all : &cnt_filtered;
+		g_autoptr(XbBuilder) builder = xb_builder_new();
+		g_autoptr(XbBuilderFixup) fixup1 = NULL;
+		g_autoptr(XbBuilderFixup) fixup2 = NULL;
+		g_autoptr(XbBuilderSource) source = xb_builder_source_new();
+		g_autoptr(XbSilo) silo = NULL;
+
+		/* the second fixup has to see the renamed element */
+		fixup1 = xb_builder_fixup_new("Rename", xb_builder_fixup_rename_cb, cnt, NULL);
+		fixup2 = xb_builder_fixup_new("Mark", xb_builder_fixup_mark_cb, cnt, NULL);
+		if (j == 1) {
+			xb_builder_fixup_add_element(fixup1, "application");
+			xb_builder_fixup_add_element(fixup2, "component");
+			xb_builder_fixup_add_element(fixup2, "name");
+		}
+		xb_builder_source_add_fixup(source, fixup1);
+		xb_builder_source_add_fixup(source, fixup2);
+		ret = xb_builder_source_load_xml(source, xml, XB_BUILDER_SOURCE_FLAG_NONE, &error);
+		g_assert_no_error(error);
+		g_assert_true(ret);
+		xb_builder_import_source(builder, source);
+		silo = xb_builder_compile(builder, XB_BUILDER_COMPILE_FLAG_NONE, NULL, &error);
+		g_assert_no_error(error);
+		g_assert_nonnull(silo);
+		if (j == 0)
+			xml_all = xb_silo_export(silo, XB_NODE_EXPORT_FLAG_NONE, &error);
+		else
+			xml_filtered = xb_silo_export(silo, XB_NODE_EXPORT_FLAG_NONE, &error);
+		g_assert_no_error(error);
+	}
+	g_assert_cmpstr(xml_filtered, ==, xml_all);
+	g_assert_cmpstr(xml_filtered,
 			==,
-			xml2);
+			"<components>"
+			"<component seen=\"true\"><id>gimp.desktop</id>"
+			"<name seen=\"true\">GIMP</name></component>"
+			"<component seen=\"true\"><id>inkscape.desktop</id>"
+			"<name seen=\"true\">Inkscape</name></component>"
+			"</components>");
+
+	/* both fixups see all 8 nodes, against one rename and four marks */
+	g_assert_cmpint(cnt_all, ==, 16);
+	g_assert_cmpint(cnt_filtered, ==, 5);
 }
 
 static gboolean
-xb_builder_fixup_root_node_only_cb(XbBuilderFixup *self,
-				   XbBuilderNode *bn,
-				   gpointer user_data,
-				   GError **error)
+xb_builder_fixup_set_text_cb(XbBuilderFixup *self,
+			     XbBuilderNode *bn,
+			     gpointer user_data,
+			     GError **error)
 {
-	g_debug(">%s<", xb_builder_node_get_element(bn));
-	g_assert_cmpstr(xb_builder_node_get_element(bn), ==, NULL);
+	xb_builder_node_set_text(bn, "fixed", -1);
+	return TRUE;
+}
+
+static gboolean
+xb_builder_fixup_copy_text_cb(XbBuilderFixup *self,
+			      XbBuilderNode *bn,
+			      gpointer user_data,
+			      GError **error)
+{
+	g_autoptr(XbBuilderNode) bc = xb_builder_node_get_child(bn, "c", NULL);
+	xb_builder_node_set_attr(bn, "text", xb_builder_node_get_text(bc));
 	return TRUE;
 }
 
 static void
-xb_builder_node_vfunc_depth_func(void)
+xb_builder_fixup_elements_order_func(void)
 {
 	gboolean ret;
+	g_autofree gchar *xml = NULL;
 	g_autoptr(GError) error = NULL;
 	g_autoptr(XbBuilder) builder = xb_builder_new();
-	g_autoptr(XbBuilderFixup) fixup = NULL;
+	g_autoptr(XbBuilderFixup) fixup1 = NULL;
+	g_autoptr(XbBuilderFixup) fixup2 = NULL;
 	g_autoptr(XbBuilderSource) source = xb_builder_source_new();
 	g_autoptr(XbSilo) silo = NULL;
-	const gchar *xml = "  <components>\n"
-			   "    <component>\n"
-			   "      <id>gimp.desktop</id>\n"
-			   "    </component>\n"
-			   "  </components>\n";
-
-	/* add fixup */
-	fixup = xb_builder_fixup_new("OnlyRoot", xb_builder_fixup_root_node_only_cb, NULL, NULL);
-	xb_builder_fixup_set_max_depth(fixup, 0);
-	xb_builder_source_add_fixup(source, fixup);
 
-	/* import some XML */
-	ret = xb_builder_source_load_xml(source, xml, XB_BUILDER_SOURCE_FLAG_NONE, &error);
+	/* the parent is handled by a later fixup than the child */
+	fixup1 = xb_builder_fixup_new("SetText", xb_builder_fixup_set_text_cb, NULL, NULL);
+	xb_builder_fixup_add_element(fixup1, "c");
+	xb_builder_source_add_fixup(source, fixup1);
+	fixup2 = xb_builder_fixup_new("CopyText", xb_builder_fixup_copy_text_cb, NULL, NULL);
+	xb_builder_fixup_add_element(fixup2, "b");
+	xb_builder_source_add_fixup(source, fixup2);
+	ret = xb_builder_source_load_xml(source,
+					 "<a><b><c>original</c></b></a>",
+					 XB_BUILDER_SOURCE_FLAG_NONE,
+					 &error);
 	g_assert_no_error(error);
 	g_assert_true(ret);
 	xb_builder_import_source(builder, source);
 	silo = xb_builder_compile(builder, XB_BUILDER_COMPILE_FLAG_NONE, NULL, &error);
 	g_assert_no_error(error);
 	g_assert_nonnull(silo);
+	xml = xb_silo_export(silo, XB_NODE_EXPORT_FLAG_NONE, &error);
+	g_assert_no_error(error);
+	g_assert_cmpstr(xml, ==, "<a><b text=\"fixed\"><c>fixed</c></b></a>");
 }
 
 static void
@@ -2238,6 +3975,78 @@ xb_builder_native_lang_func(void)
 	g_assert_cmpstr(tmp, ==, "<p xml:lang=\"fr\">Salut</p><p xml:lang=\"fr\">Au revoir</p>");
 }
 
+static gboolean
+xb_builder_single_lang_noop_cb(XbBuilderFixup *self,
+			       XbBuilderNode *bn,
+			       gpointer user_data,
+			       GError **error)
+{
+	return TRUE;
+}
+
+static void
+xb_builder_single_lang_func(void)
+{
+	g_autofree gchar *xml_filtered = NULL;
+	g_autofree gchar *xml_pruned = NULL;
+	g_autoptr(GError) error = NULL;
+	const gchar *xml = "<components>\n"
+			   "  <component>\n"
+			   "    <name>GIMP</name>\n"
+			   "    <name xml:lang=\"de\">Gimp <b>de</b> tail</name> after de\n"
+			   "    <name xml:lang=\"fr\">Gimp fr</name> after fr\n"
+			   "    <name xml:lang=\"fr_FR\">Gimp fr_FR</name>\n"
+			   "    <summary xml:lang=\"fr\">Résumé</summary>\n"
+			   "    <summary>Summary</summary>\n"
+			   "    <description>\n"
+			   "      <p>One</p><p xml:lang=\"fr\">Un</p><p xml:lang=\"it\">Uno</p>\n"
+			   "      <ul xml:lang=\"it\"><li>Uno</li></ul><ul><li>One</li></ul>\n"
+			   "    </description>\n"
+			   "    <keywords><keyword>paint</keyword><keyword>draw</keyword></keywords>\n"
+			   "  </component>\n"
+			   "  <component><id>C</id></component>\n"
+			   "</components>\n";
+
+	/* a fixup forces every translation to be built as a node first */
+	for (guint j = 0; j < 2; j++) {
+		gboolean ret;
+		g_autoptr(XbBuilder) builder = xb_builder_new();
+		g_autoptr(XbSilo) silo = NULL;
+
+		ret = xb_test_import_xml(builder, xml, &error);
+		g_assert_no_error(error);
+		g_assert_true(ret);
+		if (j == 1) {
+			g_autoptr(XbBuilderFixup) fixup = NULL;
+			fixup = xb_builder_fixup_new("Noop",
+						     xb_builder_single_lang_noop_cb,
+						     NULL,
+						     NULL);
+			xb_builder_add_fixup(builder, fixup);
+		}
+		xb_builder_add_locale(builder, "fr_FR");
+		xb_builder_add_locale(builder, "fr");
+		xb_builder_add_locale(builder, "C");
+		silo = xb_builder_compile(builder,
+					  XB_BUILDER_COMPILE_FLAG_SINGLE_LANG,
+					  NULL,
+					  &error);
+		g_assert_no_error(error);
+		g_assert_nonnull(silo);
+		if (j == 0)
+			xml_filtered = xb_silo_export(silo, XB_NODE_EXPORT_FLAG_NONE, &error);
+		else
+			xml_pruned = xb_silo_export(silo, XB_NODE_EXPORT_FLAG_NONE, &error);
+		g_assert_no_error(error);
+	}
+	g_assert_cmpstr(xml_filtered, ==, xml_pruned);
+	g_assert_nonnull(g_strstr_len(xml_filtered, -1, "Gimp fr_FR"));
+	g_assert_null(g_strstr_len(xml_filtered, -1, "after"));
+	g_assert_null(g_strstr_len(xml_filtered, -1, "Summary"));
+	g_assert_null(g_strstr_len(xml_filtered, -1, "Uno"));
+	g_assert_nonnull(g_strstr_len(xml_filtered, -1, "draw"));
+}
+
 static void
 xb_builder_comments_func(void)
 {
@@ -2665,6 +4474,39 @@ xb_builder_single_root_func(void)
 	g_assert_null(silo);
 }
 
+static void
+xb_builder_node_string_arena_func(void)
+{
+	g_autoptr(XbBuilderStringArena) arena = xb_builder_string_arena_new();
+	g_autoptr(XbBuilderNode) root = xb_builder_node_new_with_arena(arena, "components");
+	g_autoptr(XbBuilderNode) bn1 = xb_builder_node_new_with_arena(arena, "component");
+	g_autoptr(XbBuilderNode) bn2 = xb_builder_node_new_with_arena(arena, "component");
+	g_autofree gchar *xml = NULL;
+	g_autoptr(GError) error = NULL;
+
+	/* element names are shared */
+	g_assert_true(xb_builder_node_get_element(bn1) == xb_builder_node_get_element(bn2));
+
+	/* strings can be replaced */
+	xb_builder_node_set_attr(bn1, "type", "desktop");
+	xb_builder_node_set_attr(bn1, "type", "generic");
+	xb_builder_node_set_text(bn1, "  one  ", -1);
+	xb_builder_node_add_flag(bn1, XB_BUILDER_NODE_FLAG_STRIP_TEXT);
+	xb_builder_node_set_element(bn2, "app");
+	xb_builder_node_set_tail(bn2, "tail", -1);
+	xb_builder_node_add_child(root, bn1);
+	xb_builder_node_add_child(root, bn2);
+
+	/* the nodes keep the arena alive */
+	g_clear_pointer(&arena, xb_builder_string_arena_unref);
+	xml = xb_builder_node_export(root, XB_NODE_EXPORT_FLAG_COLLAPSE_EMPTY, &error);
+	g_assert_no_error(error);
+	g_assert_cmpstr(xml,
+			==,
+			"<components><component type=\"generic\">one</component>"
+			"<app />tail</components>");
+}
+
 static void
 xb_builder_node_token_max_func(void)
 {
@@ -2695,6 +4537,200 @@ xb_builder_node_token_max_func(void)
 	g_assert_cmpstr("<components />", ==, xml);
 }
 
+static void
+xb_sax_start_element_cb(const gchar *element_name,
+			const gchar **attr_names,
+			const gchar **attr_values,
+			gpointer user_data,
+			GError **error)
+{
+	GString *str = (GString *)user_data;
+	g_string_append_printf(str, "<%s", element_name);
+	for (guint i = 0; attr_names[i] != NULL; i++)
+		g_string_append_printf(str, " %s=%s", attr_names[i], attr_values[i]);
+	g_string_append(str, ">");
+}
+
+static void
+xb_sax_end_element_cb(const gchar *element_name, gpointer user_data, GError **error)
+{
+	GString *str = (GString *)user_data;
+	g_string_append_printf(str, "</%s>", element_name);
+}
+
+static void
+xb_sax_text_cb(const gchar *text, gsize text_len, gpointer user_data, GError **error)
+{
+	GString *str = (GString *)user_data;
+	g_string_append_printf(str, "[%.*s]", (gint)text_len, text);
+}
+
+static gboolean
+xb_sax_parse_chunked_full(const gchar *xml, gsize len, gsize chunksz, GString *str, GError **error)
+{
+	const XbSaxParser parser = {xb_sax_start_element_cb, xb_sax_end_element_cb, xb_sax_text_cb};
+	g_autoptr(XbSaxContext) ctx = xb_sax_context_new(&parser, str);
+
+	for (gsize i = 0; i < len; i += chunksz) {
+		if (!xb_sax_context_parse(ctx, xml + i, MIN(chunksz, len - i), error))
+			return FALSE;
+	}
+	return xb_sax_context_parse(ctx, "", 0, error);
+}
+
+static gchar *
+xb_sax_parse_chunked(const gchar *xml, gsize chunksz, GError **error)
+{
+	g_autoptr(GString) str = g_string_new(NULL);
+	if (!xb_sax_parse_chunked_full(xml, strlen(xml), chunksz, str, error))
+		return NULL;
+	return g_string_free(g_steal_pointer(&str), FALSE);
+}
+
+static void
+xb_sax_markup_start_element_cb(GMarkupParseContext *context,
+			       const gchar *element_name,
+			       const gchar **attr_names,
+			       const gchar **attr_values,
+			       gpointer user_data,
+			       GError **error)
+{
+	xb_sax_start_element_cb(element_name, attr_names, attr_values, user_data, error);
+}
+
+static void
+xb_sax_markup_end_element_cb(GMarkupParseContext *context,
+			     const gchar *element_name,
+			     gpointer user_data,
+			     GError **error)
+{
+	xb_sax_end_element_cb(element_name, user_data, error);
+}
+
+static void
+xb_sax_markup_text_cb(GMarkupParseContext *context,
+		      const gchar *text,
+		      gsize text_len,
+		      gpointer user_data,
+		      GError **error)
+{
+	xb_sax_text_cb(text, text_len, user_data, error);
+}
+
+/* the reference, using the same flags the builder used before XbSaxContext */
+static gboolean
+xb_sax_markup_parse_chunked(const gchar *xml,
+			    gsize len,
+			    gsize chunksz,
+			    GString *str,
+			    GError **error)
+{
+	const GMarkupParser parser = {xb_sax_markup_start_element_cb,
+				      xb_sax_markup_end_element_cb,
+				      xb_sax_markup_text_cb,
+				      NULL,
+				      NULL};
+	g_autoptr(GMarkupParseContext) ctx =
+	    g_markup_parse_context_new(&parser,
+				       G_MARKUP_PREFIX_ERROR_POSITION | G_MARKUP_TREAT_CDATA_AS_TEXT,
+				       str,
+				       NULL);
+
+	for (gsize i = 0; i < len; i += chunksz) {
+		if (!g_markup_parse_context_parse(ctx, xml + i, MIN(chunksz, len - i), error))
+			return FALSE;
+	}
+	return TRUE;
+}
+
+static void
+xb_sax_markup_func(void)
+{
+	const gchar *fn;
+	const gsize chunkszs[] = {1, 3, 17, 64, 4096, 0}; /* 0 is the whole file */
+	g_autofree gchar *path = g_test_build_filename(G_TEST_DIST, "fuzzing-src", NULL);
+	g_autoptr(GDir) dir = g_dir_open(path, 0, NULL);
+
+	/* not installed */
+	if (dir == NULL) {
+		g_test_skip("no fuzzing corpus");
+		return;
+	}
+
+	/* every file gives the same callbacks and error code as GMarkup */
+	while ((fn = g_dir_read_name(dir)) != NULL) {
+		gboolean ret;
+		gsize len = 0;
+		g_autofree gchar *data = NULL;
+		g_autofree gchar *filename = g_build_filename(path, fn, NULL);
+		g_autoptr(GError) error = NULL;
+
+		ret = g_file_get_contents(filename, &data, &len, &error);
+		g_assert_no_error(error);
+		g_assert_true(ret);
+		for (guint i = 0; i < G_N_ELEMENTS(chunkszs); i++) {
+			gsize chunksz = chunkszs[i] != 0 ? chunkszs[i] : MAX(len, 1);
+			g_autoptr(GError) error_markup = NULL;
+			g_autoptr(GError) error_sax = NULL;
+			g_autoptr(GString) str_markup = g_string_new(NULL);
+			g_autoptr(GString) str_sax = g_string_new(NULL);
+
+			g_debug("%s in chunks of %" G_GSIZE_FORMAT, fn, chunksz);
+			xb_sax_markup_parse_chunked(data, len, chunksz, str_markup, &error_markup);
+			xb_sax_parse_chunked_full(data, len, chunksz, str_sax, &error_sax);
+			g_assert_cmpstr(str_sax->str, ==, str_markup->str);
+			if (error_markup != NULL) {
+				g_debug("%s", error_markup->message);
+				g_assert_error(error_sax, error_markup->domain, error_markup->code);
+			} else {
+				g_assert_no_error(error_sax);
+			}
+		}
+	}
+}
+
+static void
+xb_sax_func(void)
+{
+	const gchar *xml = "<?xml version=\"1.0\"?>\n"
+			   "<!-- comment -->\n"
+			   "<a x=\"1 &amp; 2\" y='&#65;&#x42;'>"
+			   "t&lt;t<b/><![CDATA[<raw>]]><c>\r\nd</c>"
+			   "</a>\n";
+	const gchar *expected = "<a x=1 & 2 y=AB>[t<t]<b></b>[]"
+				"[<raw>][]<c>[\nd]</c>[]</a>";
+	g_autoptr(GError) error = NULL;
+
+	/* same result regardless of how the input is split */
+	for (gsize chunksz = 1; chunksz <= 64; chunksz *= 4) {
+		g_autofree gchar *str = xb_sax_parse_chunked(xml, chunksz, &error);
+		g_assert_no_error(error);
+		g_assert_cmpstr(str, ==, expected);
+	}
+
+	/* parsing in place must not write to the read-only string */
+	{
+		const XbSaxParser parser = {xb_sax_start_element_cb,
+					    xb_sax_end_element_cb,
+					    xb_sax_text_cb};
+		g_autoptr(GString) str = g_string_new(NULL);
+		g_autoptr(XbSaxContext) ctx = xb_sax_context_new(&parser, str);
+		gboolean ret = xb_sax_context_parse_borrowed(ctx, xml, strlen(xml), &error);
+		g_assert_no_error(error);
+		g_assert_true(ret);
+		g_assert_cmpstr(str->str, ==, expected);
+	}
+
+	/* invalid documents */
+	for (guint i = 0; i < 4; i++) {
+		const gchar *invalid[] = {"<a></b>", "<a x=\"1\" x2></a>", "<a>&bad;</a>", "text"};
+		g_autofree gchar *str = xb_sax_parse_chunked(invalid[i], 3, &error);
+		g_assert_error(error, G_MARKUP_ERROR, G_MARKUP_ERROR_PARSE);
+		g_assert_null(str);
+		g_clear_error(&error);
+	}
+}
+
 static void
 xb_builder_node_nul_func(void)
 {
@@ -3294,6 +5330,264 @@ xb_speed_func(void)
 	g_print("query[x%u]: %.3fms\n", n_components, g_timer_elapsed(timer, NULL) * 1000);
 }
 
+static void
+xb_speed_element_columns_func(void)
+{
+	const XbBuilderCompileFlags flags[] = {XB_BUILDER_COMPILE_FLAG_NONE,
+					       XB_BUILDER_COMPILE_FLAG_ELEMENT_COLUMNS,
+					       XB_BUILDER_COMPILE_FLAG_POSTINGS};
+	const gchar *names[] = {"siblings", "columns", "postings"};
+	const gchar *xpaths[] = {"components/component/id",
+				 "components/component/id[text()='000199.firmware']"};
+	g_autoptr(GString) xml = g_string_new("<components>");
+
+	/* wide sibling lists with a few rare elements */
+	for (guint i = 0; i < 200; i++) {
+		g_string_append(xml, "<component>");
+		for (guint j = 0; j < 200; j++)
+			g_string_append_printf(xml, "<keyword>%u</keyword>", j);
+		g_string_append_printf(xml, "<id>%06u.firmware</id>", i);
+		g_string_append(xml, "</component>");
+	}
+	g_string_append(xml, "</components>");
+
+	for (guint i = 0; i < G_N_ELEMENTS(flags); i++) {
+		gboolean ret;
+		g_autoptr(GError) error = NULL;
+		g_autoptr(XbBuilder) builder = xb_builder_new();
+		g_autoptr(XbSilo) silo = NULL;
+
+		ret = xb_test_import_xml(builder, xml->str, &error);
+		g_assert_no_error(error);
+		g_assert_true(ret);
+		silo = xb_builder_compile(builder, flags[i], NULL, &error);
+		g_assert_no_error(error);
+		g_assert_nonnull(silo);
+
+		for (guint j = 0; j < G_N_ELEMENTS(xpaths); j++) {
+			g_autoptr(GTimer) timer = g_timer_new();
+			for (guint k = 0; k < 100; k++) {
+				g_autoptr(GPtrArray) results = NULL;
+				results = xb_silo_query(silo, xpaths[j], 0, &error);
+				g_assert_no_error(error);
+				g_assert_nonnull(results);
+				g_assert_cmpint(results->len, ==, j == 0 ? 200 : 1);
+			}
+			g_print("%s using %s: %.3fms\n",
+				xpaths[j],
+				names[i],
+				g_timer_elapsed(timer, NULL) * 1000 / 100);
+		}
+	}
+}
+
+static void
+xb_speed_compile_func(void)
+{
+	g_autoptr(GString) xml = g_string_new("<components>");
+	g_autoptr(XbSilo) silo = NULL;
+	gdouble elapsed = 0;
+	gdouble elapsed_min = G_MAXDOUBLE;
+	guint n_compiles = 10;
+
+	/* a wide root, which is what makes the strtab and nodetab walks slow */
+	for (guint i = 0; i < 20000; i++) {
+		g_string_append(xml, "<component type=\"firmware\">");
+		g_string_append_printf(xml, "<id>%06u.firmware</id>", i);
+		g_string_append(xml, "<name>ColorHug2</name>");
+		g_string_append(xml, "<summary>Firmware</summary>");
+		g_string_append(xml, "<description><p>New features!</p></description>");
+		g_string_append(xml, "<url type=\"homepage\">http://com/</url>");
+		g_string_append(xml, "</component>");
+	}
+	g_string_append(xml, "</components>");
+
+	/* only the compile is timed, and the profile of the last is shown */
+	for (guint i = 0; i < n_compiles; i++) {
+		gboolean ret;
+		g_autoptr(GError) error = NULL;
+		g_autoptr(GTimer) timer = NULL;
+		g_autoptr(XbBuilder) builder = xb_builder_new();
+
+		ret = xb_test_import_xml(builder, xml->str, &error);
+		g_assert_no_error(error);
+		g_assert_true(ret);
+		xb_builder_set_profile_flags(builder, XB_SILO_PROFILE_FLAG_APPEND);
+		g_clear_object(&silo);
+		timer = g_timer_new();
+		silo = xb_builder_compile(builder, XB_BUILDER_COMPILE_FLAG_NONE, NULL, &error);
+		elapsed += g_timer_elapsed(timer, NULL);
+		elapsed_min = MIN(elapsed_min, g_timer_elapsed(timer, NULL));
+		g_assert_no_error(error);
+		g_assert_nonnull(silo);
+	}
+
+	/* the fastest run is the most stable number to compare between builds */
+	g_print("compile[x%u]: mean %.3fms, min %.3fms\n%s",
+		n_compiles,
+		elapsed * 1000 / n_compiles,
+		elapsed_min * 1000,
+		xb_silo_get_profile_string(silo));
+}
+
+/* the resident set size in bytes, or 0 if not known */
+static guint64
+xb_test_get_rss(void)
+{
+	const gchar *tmp;
+	g_autofree gchar *buf = NULL;
+
+	if (!g_file_get_contents("/proc/self/status", &buf, NULL, NULL))
+		return 0;
+	tmp = g_strstr_len(buf, -1, "VmRSS:");
+	if (tmp == NULL)
+		return 0;
+	return g_ascii_strtoull(tmp + strlen("VmRSS:"), NULL, 10) * 1024;
+}
+
+static void
+xb_speed_compressed_func(void)
+{
+	g_autofree gchar *tmp_compressed =
+	    g_build_filename(g_get_tmp_dir(), "speed-compressed.xmlb", NULL);
+	g_autofree gchar *tmp_plain = g_build_filename(g_get_tmp_dir(), "speed-plain.xmlb", NULL);
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GString) xml = g_string_new("<components>");
+	g_autoptr(XbSilo) silo = NULL;
+	const gchar *fns[] = {tmp_plain, tmp_compressed};
+
+#ifndef HAVE_ZSTD
+	g_test_skip("compiled without -Dzstd");
+	return;
+#endif
+
+	for (guint i = 0; i < 5000; i++) {
+		g_string_append(xml, "<component type=\"firmware\">");
+		g_string_append_printf(xml, "<id>%06u.firmware</id>", i);
+		g_string_append(xml, "<name>ColorHug2</name>");
+		g_string_append(xml, "<summary>Firmware</summary>");
+		g_string_append(xml, "<description><p>New features!</p></description>");
+		g_string_append(xml, "<url type=\"homepage\">http://com/</url>");
+		g_string_append(xml, "</component>");
+	}
+	g_string_append(xml, "</components>");
+	silo = xb_silo_new_from_xml(xml->str, &error);
+	g_assert_no_error(error);
+	g_assert_nonnull(silo);
+
+	for (guint i = 0; i < G_N_ELEMENTS(fns); i++) {
+		gboolean ret;
+		guint64 rss;
+		g_autoptr(GFile) file = g_file_new_for_path(fns[i]);
+		g_autoptr(GFileInfo) info = NULL;
+		g_autoptr(GTimer) timer = NULL;
+		g_autoptr(XbNode) n = NULL;
+		g_autoptr(XbSilo) silo_tmp = xb_silo_new();
+
+		if (i == 0)
+			ret = xb_silo_save_to_file(silo, file, NULL, &error);
+		else
+			ret = xb_silo_save_to_file_compressed(silo, file, NULL, &error);
+		g_assert_no_error(error);
+		g_assert_true(ret);
+		info = g_file_query_info(file,
+					 G_FILE_ATTRIBUTE_STANDARD_SIZE,
+					 G_FILE_QUERY_INFO_NONE,
+					 NULL,
+					 &error);
+		g_assert_no_error(error);
+		g_assert_nonnull(info);
+
+		/* load and a single query, as a service would on startup */
+		rss = xb_test_get_rss();
+		timer = g_timer_new();
+		ret = xb_silo_load_from_file(silo_tmp,
+					     file,
+					     XB_SILO_LOAD_FLAG_COMPRESSED,
+					     NULL,
+					     &error);
+		g_assert_no_error(error);
+		g_assert_true(ret);
+		n = xb_silo_query_first(silo_tmp,
+					"components/component/id[text()='000100.firmware']",
+					&error);
+		g_assert_no_error(error);
+		g_assert_nonnull(n);
+		g_print("%s: %" G_GINT64_FORMAT " bytes, load+query %.3fms, "
+			"%u bytes decompressed, RSS grew by %" G_GINT64_FORMAT " bytes\n",
+			i == 0 ? "plain" : "compressed",
+			g_file_info_get_size(info),
+			g_timer_elapsed(timer, NULL) * 1000,
+			xb_silo_get_blocks_decompressed(silo_tmp),
+			(gint64)(xb_test_get_rss() - rss));
+	}
+}
+
+static void
+xb_speed_verified_func(void)
+{
+	const XbSiloLoadFlags flags[] = {XB_SILO_LOAD_FLAG_NONE, XB_SILO_LOAD_FLAG_VERIFY};
+	const gchar *xpaths[] = {"components/component/id[text()='004999.firmware']",
+				 "components/component/requires/firmware",
+				 "components/component/releases/release/description/p",
+				 NULL};
+	g_autoptr(GBytes) blob = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GString) xml = g_string_new("<components>");
+	g_autoptr(XbSilo) silo = NULL;
+
+	for (guint i = 0; i < 5000; i++) {
+		g_string_append(xml, "<component type=\"firmware\">");
+		g_string_append_printf(xml, "<id>%06u.firmware</id>", i);
+		g_string_append(xml, "<name>ColorHug2</name>");
+		g_string_append(xml, "<provides><firmware type=\"flashed\">2082b5e0</firmware></provides>");
+		g_string_append(xml, "<requires><id compare=\"ge\">fwupd</id>");
+		g_string_append(xml, "<firmware compare=\"eq\" version=\"2.0.99\"/></requires>");
+		g_string_append(xml, "<releases><release version=\"2.0.3\">");
+		g_string_append(xml, "<description><p>stable:</p><ul><li>Quicker</li></ul></description>");
+		g_string_append(xml, "</release></releases>");
+		g_string_append(xml, "</component>");
+	}
+	g_string_append(xml, "</components>");
+	silo = xb_silo_new_from_xml(xml->str, &error);
+	g_assert_no_error(error);
+	g_assert_nonnull(silo);
+	blob = xb_silo_get_bytes(silo);
+
+	/* the same queries with and without the per-access checks */
+	for (guint i = 0; i < G_N_ELEMENTS(flags); i++) {
+		gboolean ret;
+		g_autoptr(GTimer) timer = g_timer_new();
+		g_autoptr(XbSilo) silo_tmp = xb_silo_new();
+
+		ret = xb_silo_load_from_bytes(silo_tmp, blob, flags[i], &error);
+		g_assert_no_error(error);
+		g_assert_true(ret);
+		g_print("%s load: %.3fms\n",
+			i == 0 ? "unverified" : "verified",
+			g_timer_elapsed(timer, NULL) * 1000);
+		for (guint j = 0; xpaths[j] != NULL; j++) {
+			g_timer_reset(timer);
+			for (guint k = 0; k < 10; k++) {
+				g_autoptr(XbQuery) query = NULL;
+				g_autoptr(GPtrArray) results = NULL;
+				query = xb_query_new_full(silo_tmp,
+							  xpaths[j],
+							  XB_QUERY_FLAG_NONE,
+							  &error);
+				g_assert_no_error(error);
+				results = xb_silo_query_full(silo_tmp, query, &error);
+				g_assert_no_error(error);
+				g_assert_nonnull(results);
+			}
+			g_print("%s %s: %.3fms\n",
+				i == 0 ? "unverified" : "verified",
+				xpaths[j],
+				g_timer_elapsed(timer, NULL) * 1000 / 10);
+		}
+	}
+}
+
 static void
 xb_speed_precompiled_func(void)
 {
@@ -3367,10 +5661,33 @@ main(int argc, char **argv)
 	g_test_add_func("/libxmlb/node{export}", xb_node_export_func);
 	g_test_add_func("/libxmlb/node{export-collapse}", xb_node_export_collapse_func);
 	g_test_add_func("/libxmlb/builder", xb_builder_func);
+	g_test_add_func("/libxmlb/builder{postings}", xb_builder_postings_func);
+	g_test_add_func("/libxmlb/builder{strtab-index}", xb_builder_strtab_index_func);
+	g_test_add_func("/libxmlb/builder{tagtab}", xb_builder_tagtab_func);
+	g_test_add_func("/libxmlb/builder{subtree-end}", xb_builder_subtree_end_func);
+	g_test_add_func("/libxmlb/builder{element-columns}", xb_builder_element_columns_func);
+	g_test_add_func("/libxmlb/builder{compact-nodetab}", xb_builder_compact_nodetab_func);
+	g_test_add_func("/libxmlb/builder{threads}", xb_builder_threads_func);
+	g_test_add_func("/libxmlb/builder{tokenize}", xb_builder_tokenize_func);
+	g_test_add_func("/libxmlb/builder{fragment-cache}", xb_builder_fragment_cache_func);
+	g_test_add_func("/libxmlb/builder{fragment-cache-strip}",
+			xb_builder_fragment_cache_strip_func);
+	g_test_add_func("/libxmlb/builder{merge}", xb_builder_merge_func);
+	g_test_add_func("/libxmlb/builder{extract}", xb_builder_extract_func);
+	g_test_add_func("/libxmlb/builder{source-silo}", xb_builder_source_silo_func);
+	g_test_add_func("/libxmlb/builder{source-silo-attrs}", xb_builder_source_silo_attrs_func);
+	g_test_add_func("/libxmlb/builder{compile-to-file}", xb_builder_compile_to_file_func);
+	g_test_add_func("/libxmlb/builder{front-coded-strtab}",
+			xb_builder_front_coded_strtab_func);
+	g_test_add_func("/libxmlb/silo{verify}", xb_silo_verify_func);
+	g_test_add_func("/libxmlb/silo{compressed}", xb_silo_compressed_func);
+	g_test_add_func("/libxmlb/silo{compressed-corrupt}", xb_silo_compressed_corrupt_func);
+	g_test_add_func("/libxmlb/silo{snapshot}", xb_silo_snapshot_func);
 	g_test_add_func("/libxmlb/builder{comments}", xb_builder_comments_func);
 	g_test_add_func("/libxmlb/builder{cdata}", xb_builder_cdata_func);
 	g_test_add_func("/libxmlb/builder{native-lang}", xb_builder_native_lang_func);
 	g_test_add_func("/libxmlb/builder{native-lang-nested}", xb_builder_native_lang2_func);
+	g_test_add_func("/libxmlb/builder{single-lang}", xb_builder_single_lang_func);
 	g_test_add_func("/libxmlb/builder{empty}", xb_builder_empty_func);
 	g_test_add_func("/libxmlb/builder{ensure}", xb_builder_ensure_func);
 	g_test_add_func("/libxmlb/builder{ensure-watch-source}",
@@ -3380,18 +5697,26 @@ main(int argc, char **argv)
 	g_test_add_func("/libxmlb/builder{node-vfunc-depth}", xb_builder_node_vfunc_depth_func);
 	g_test_add_func("/libxmlb/builder{node-vfunc-error}", xb_builder_node_vfunc_error_func);
 	g_test_add_func("/libxmlb/builder{node-vfunc-ignore}", xb_builder_node_vfunc_ignore_func);
+	g_test_add_func("/libxmlb/builder{fixup-elements}", xb_builder_fixup_elements_func);
+	g_test_add_func("/libxmlb/builder{fixup-elements-order}",
+			xb_builder_fixup_elements_order_func);
 	g_test_add_func("/libxmlb/builder{ignore-invalid}", xb_builder_ignore_invalid_func);
 	g_test_add_func("/libxmlb/builder{custom-mime}", xb_builder_custom_mime_func);
 	g_test_add_func("/libxmlb/builder{chained-adapters}", xb_builder_chained_adapters_func);
 	g_test_add_func("/libxmlb/builder{source-lzma}", xb_builder_source_lzma_func);
 	g_test_add_func("/libxmlb/builder{source-zstd}", xb_builder_source_zstd_func);
+	g_test_add_func("/libxmlb/builder{source-fingerprint}",
+			xb_builder_source_fingerprint_func);
 	g_test_add_func("/libxmlb/builder-node", xb_builder_node_func);
 	g_test_add_func("/libxmlb/builder-node/nul", xb_builder_node_nul_func);
 	g_test_add_func("/libxmlb/builder-node{token-max}", xb_builder_node_token_max_func);
+	g_test_add_func("/libxmlb/builder-node{string-arena}", xb_builder_node_string_arena_func);
 	g_test_add_func("/libxmlb/builder-node{info}", xb_builder_node_info_func);
 	g_test_add_func("/libxmlb/builder-node{literal-text}", xb_builder_node_literal_text_func);
 	g_test_add_func("/libxmlb/builder-node{source-text}", xb_builder_node_source_text_func);
 	g_test_add_func("/libxmlb/markup", xb_markup_func);
+	g_test_add_func("/libxmlb/sax", xb_sax_func);
+	g_test_add_func("/libxmlb/sax{markup}", xb_sax_markup_func);
 	g_test_add_func("/libxmlb/token-search", xb_manual_token_search_func);
 	g_test_add_func("/libxmlb/xpath", xb_xpath_func);
 	g_test_add_func("/libxmlb/xpath{null-attr}", xb_xpath_null_attr_func);
@@ -3421,6 +5746,10 @@ main(int argc, char **argv)
 		g_test_add_func("/libxmlb/threading", xb_threading_func);
 		g_test_add_func("/libxmlb/speed", xb_speed_func);
 		g_test_add_func("/libxmlb/speed-precompiled", xb_speed_precompiled_func);
+		g_test_add_func("/libxmlb/speed-element-columns", xb_speed_element_columns_func);
+		g_test_add_func("/libxmlb/speed-compile", xb_speed_compile_func);
+		g_test_add_func("/libxmlb/speed-compressed", xb_speed_compressed_func);
+		g_test_add_func("/libxmlb/speed-verified", xb_speed_verified_func);
 	}
 	return g_test_run();
 }
@@ -69,12 +69,8 @@ xb_silo_export_node(XbSilo *self, XbSiloExportHelper *helper, XbSiloNode *sn, GE
 	    xb_silo_get_child_node(self, sn, NULL) == NULL) {
 		g_string_append(helper->xml, " />");
 
-		/* offset by opening tag and single byte sentinel */
-		helper->off += xb_silo_node_get_size(sn);
-		sn2 = xb_silo_get_node(self, helper->off, error);
-		if (sn2 == NULL)
-			return FALSE;
-		helper->off += xb_silo_node_get_size(sn2);
+		/* skip the opening tag and single byte sentinel */
+		helper->off = xb_silo_node_get_end(sn);
 	} else {
 		/* finish the opening tag and add any text if it exists */
 		if (xb_silo_node_get_text_idx(sn) != XB_SILO_UNSET) {
@@ -181,16 +177,8 @@ xb_silo_export_with_root(XbSilo *self, XbSiloNode *sroot, XbNodeExportFlags flag
 	if (sroot != NULL) {
 		sn = sroot;
 		if (sn != NULL && flags & XB_NODE_EXPORT_FLAG_ONLY_CHILDREN) {
-			g_autoptr(GError) error_local = NULL;
-			sn = xb_silo_get_child_node(self, sn, &error_local);
-			if (sn == NULL) {
-				if (!g_error_matches(error_local,
-						     G_IO_ERROR,
-						     G_IO_ERROR_INVALID_ARGUMENT)) {
-					g_propagate_error(error, g_steal_pointer(&error_local));
-					return NULL;
-				}
-			}
+			if (!xb_silo_try_get_child_node(self, sn, &sn, error))
+				return NULL;
 		}
 	} else {
 		sn = xb_silo_get_root_node(self, error);
@@ -209,21 +197,17 @@ xb_silo_export_with_root(XbSilo *self, XbSiloNode *sroot, XbNodeExportFlags flag
 	if ((flags & XB_NODE_EXPORT_FLAG_ADD_HEADER) > 0)
 		g_string_append(helper.xml, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n");
 	do {
-		g_autoptr(GError) error_local = NULL;
 		if (!xb_silo_export_node(self, &helper, sn, error)) {
 			g_string_free(helper.xml, TRUE);
 			return NULL;
 		}
 		if ((flags & XB_NODE_EXPORT_FLAG_INCLUDE_SIBLINGS) == 0)
 			break;
-		sn = xb_silo_get_next_node(self, sn, &error_local);
-		if (sn == NULL) {
-			if (g_error_matches(error_local, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT))
-				break;
-			g_propagate_error(error, g_steal_pointer(&error_local));
+		if (!xb_silo_try_get_next_node(self, sn, &sn, error)) {
+			g_string_free(helper.xml, TRUE);
 			return NULL;
 		}
-	} while (TRUE);
+	} while (sn != NULL);
 
 	/* success */
 	return helper.xml;
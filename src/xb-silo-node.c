@@ -24,6 +24,8 @@ xb_silo_node_to_string(const XbSiloNode *self)
 			g_string_append_printf(str, "  text: %u\n", self->text);
 		if (self->tail != XB_SILO_UNSET)
 			g_string_append_printf(str, "  tail: %u\n", self->tail);
+		g_string_append_printf(str, "  end: @%u\n", self->end);
+		g_string_append_printf(str, "  depth: %u\n", (guint)self->depth);
 	}
 	for (guint idx = 0; idx < self->attr_count; idx++) {
 		XbSiloNodeAttr *attr = xb_silo_node_get_attr(self, idx);
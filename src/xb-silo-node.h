@@ -25,6 +25,8 @@ typedef struct __attribute__((packed)) {
 	guint32 next;	      /* ONLY when is_element: from 0 */
 	guint32 text;	      /* ONLY when is_element: from strtab */
 	guint32 tail;	      /* ONLY when is_element: from strtab */
+	guint32 end;	      /* ONLY when is_element: from 0, after the sentinel */
+	guint16 depth;	      /* ONLY when is_element: saturates at G_MAXUINT16 */
 			      /*
 			      guint32		attrs[attr_count];
 			      guint32		tokens[token_count];
@@ -81,6 +83,13 @@ xb_silo_node_get_tail_idx(const XbSiloNode *self)
 	return self->tail;
 }
 
+/* private */
+static inline guint32
+xb_silo_node_get_end(const XbSiloNode *self)
+{
+	return self->end;
+}
+
 /* private */
 static inline guint8
 xb_silo_node_get_attr_count(const XbSiloNode *self)
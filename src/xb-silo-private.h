@@ -15,19 +15,160 @@
 
 G_BEGIN_DECLS
 
-/* 32 bytes, native byte order */
+/* 64 bytes, native byte order */
 typedef struct __attribute__((packed)) {
 	guint32 magic;
 	guint32 version;
 	XbGuid guid;
 	guint16 strtab_ntags;
-	guint8 padding[2];
+	guint16 flags; /* XbSiloHeaderFlags */
 	guint32 strtab;
 	guint64 filesz;
+	guint32 postings; /* optional, 0 if unset */
+	guint32 strindex; /* optional, 0 if unset */
+	guint32 tagtab;	  /* optional, 0 if unset */
+	guint32 columns;  /* optional, 0 if unset */
+	guint64 checksum; /* of the entire file when this is zero */
 } XbSiloHeader;
 
+/* XXH64 state, so the checksum can be computed without the whole file */
+typedef struct {
+	guint64 v[4];
+	guint64 seed;
+	guint64 total;
+	guint8 mem[32];
+	gsize memsz;
+} XbSiloChecksum;
+
+typedef enum {
+	XB_SILO_HEADER_FLAG_NONE = 0,
+	XB_SILO_HEADER_FLAG_COMPACT_NODETAB = 1 << 0,
+	XB_SILO_HEADER_FLAG_FRONT_CODED_STRTAB = 1 << 1,
+} XbSiloHeaderFlags;
+
+/* with XB_SILO_HEADER_FLAG_COMPACT_NODETAB every node is stored as its first
+ * byte followed by LEB128 varints, where strtab offsets are stored plus one
+ * and node offsets relative to the node itself, or zero when unset; the
+ * strtab and section offsets in the header are those of the decoded silo */
+#define XB_SILO_VARINT_MAX 5
+
 #define XB_SILO_MAGIC_BYTES 0x624c4d58
-#define XB_SILO_VERSION	    0x00000009
+#define XB_SILO_VERSION	    0x0000000E
+
+/* with XB_SILO_HEADER_FLAG_FRONT_CODED_STRTAB the strtab is stored as each
+ * string as a varint of the prefix shared with the previous string, a varint
+ * of the suffix length and then the suffix; strings are still referenced by
+ * their offset in the decoded strtab */
+typedef struct __attribute__((packed)) {
+	guint32 n_strings;
+	guint32 n_restarts;
+	guint32 size; /* of the decoded strtab */
+	/*
+	XbSiloStrtabFcRestart	restarts[n_restarts];
+	guint8			data[];
+	*/
+} XbSiloStrtabFcHeader;
+
+typedef struct __attribute__((packed)) {
+	guint32 offset; /* in the decoded strtab, sorted */
+	guint32 data;	/* where the string is stored with no shared prefix */
+} XbSiloStrtabFcRestart;
+
+#define XB_SILO_STRTAB_FC_INTERVAL 16
+
+/* element-name posting lists, stored after the strtab */
+typedef struct __attribute__((packed)) {
+	guint32 n_entries;
+	guint32 n_groups;
+	guint32 n_nodes;
+	/*
+	XbSiloPostingEntry	entries[n_entries];
+	XbSiloPostingGroup	groups[n_groups];
+	guint32			nodes[n_nodes];
+	*/
+} XbSiloPostingsHeader;
+
+typedef struct __attribute__((packed)) {
+	guint32 element_name; /* from strtab, sorted */
+	guint32 group_idx;    /* groups run until the next entry */
+} XbSiloPostingEntry;
+
+typedef struct __attribute__((packed)) {
+	guint32 parent;	  /* from 0, sorted */
+	guint32 node_idx; /* nodes run until the next group */
+} XbSiloPostingGroup;
+
+/* read-only string index, stored after the posting lists */
+typedef struct __attribute__((packed)) {
+	guint32 n_buckets; /* power of two */
+	/*
+	guint32			buckets[n_buckets]; from strtab, or XB_SILO_UNSET
+	*/
+} XbSiloStrindexHeader;
+
+/* minimal perfect hash of the element names, stored after the string index */
+typedef struct __attribute__((packed)) {
+	guint32 n_tags;
+	/*
+	gint32			displacements[n_tags]; seed, or -(slot + 1)
+	guint32			offsets[n_tags]; from strtab
+	*/
+} XbSiloTagtabHeader;
+
+/* dense per-element columns in document order, stored after the tagtab */
+typedef struct __attribute__((packed)) {
+	guint32 n_nodes;
+	guint32 n_padded; /* multiple of XB_SILO_COLUMN_PAD, plus one spare block */
+	guint32 data;	  /* from the section start, so the columns are aligned */
+	/*
+	guint8			padding[data - 12];
+	guint16			ids[n_padded]; ordinal of the element name, or G_MAXUINT16
+	guint16			depths[n_padded];
+	guint32			offsets[n_padded]; from 0
+	guint32			tags[strtab_ntags]; from strtab, sorted
+	*/
+} XbSiloColumnsHeader;
+
+#define XB_SILO_COLUMN_PAD 32
+
+typedef struct {
+	/*< private >*/
+	guint32 idx;
+	guint32 idx_end;
+	guint16 id;
+	guint16 depth;
+} XbSiloColumnIter;
+
+/* seekable container of independently zstd-compressed blocks of a silo */
+typedef struct __attribute__((packed)) {
+	guint32 magic;
+	guint32 block_size;
+	guint32 n_blocks;
+	guint32 datasz; /* of the uncompressed silo */
+	/*
+	guint32			offsets[n_blocks + 1]; from 0, the last is the end
+	*/
+} XbSiloBlocksHeader;
+
+#define XB_SILO_BLOCKS_MAGIC 0x5a424d58
+#define XB_SILO_BLOCK_SIZE   0x10000
+
+/* FNV-1a with a finalizer; as the tables are persisted it has to be stable */
+static inline guint32
+xb_silo_strtab_hash(const gchar *str, guint32 seed)
+{
+	guint32 hash = 0x811c9dc5 ^ seed;
+	for (const guint8 *p = (const guint8 *)str; *p != '\0'; p++) {
+		hash ^= *p;
+		hash *= 0x01000193;
+	}
+	hash ^= hash >> 16;
+	hash *= 0x85ebca6b;
+	hash ^= hash >> 13;
+	hash *= 0xc2b2ae35;
+	hash ^= hash >> 16;
+	return hash;
+}
 
 typedef struct {
 	/*< private >*/
@@ -38,6 +179,8 @@ typedef struct {
 const gchar *
 xb_silo_from_strtab(XbSilo *self, guint32 offset, GError **error) G_GNUC_NON_NULL(1);
 gboolean
+xb_silo_has_strtab_index(XbSilo *self) G_GNUC_NON_NULL(1);
+gboolean
 xb_silo_strtab_index_insert(XbSilo *self, guint32 offset, GError **error) G_GNUC_NON_NULL(1);
 guint32
 xb_silo_strtab_index_lookup(XbSilo *self, const gchar *str) G_GNUC_NON_NULL(1);
@@ -49,6 +192,49 @@ guint32
 xb_silo_get_strtab(XbSilo *self) G_GNUC_NON_NULL(1);
 guint32
 xb_silo_get_strtab_idx(XbSilo *self, const gchar *element) G_GNUC_NON_NULL(1);
+gboolean
+xb_silo_get_postings(XbSilo *self,
+		     guint32 parent,
+		     guint32 element_name,
+		     guint32 *idx,
+		     guint32 *idx_end) G_GNUC_NON_NULL(1, 4, 5);
+guint32
+xb_silo_get_posting(XbSilo *self, guint32 idx) G_GNUC_NON_NULL(1);
+gboolean
+xb_silo_column_iter_init(XbSilo *self,
+			 XbSiloColumnIter *iter,
+			 XbSiloNode *parent,
+			 guint32 element_name) G_GNUC_NON_NULL(1, 2);
+guint32
+xb_silo_column_iter_next(XbSilo *self, XbSiloColumnIter *iter) G_GNUC_NON_NULL(1, 2);
+guint32
+xb_silo_get_blocks_decompressed(XbSilo *self) G_GNUC_NON_NULL(1);
+guint32
+xb_silo_get_strtab_fc_decoded(XbSilo *self) G_GNUC_NON_NULL(1);
+guint64
+xb_silo_compute_checksum(const guint8 *data, gsize datasz) G_GNUC_NON_NULL(1);
+void
+xb_silo_checksum_init(XbSiloChecksum *st, const XbSiloHeader *hdr) G_GNUC_NON_NULL(1, 2);
+void
+xb_silo_checksum_init_data(XbSiloChecksum *st) G_GNUC_NON_NULL(1);
+void
+xb_silo_checksum_update(XbSiloChecksum *st, const guint8 *buf, gsize bufsz) G_GNUC_NON_NULL(1);
+guint64
+xb_silo_checksum_finish(XbSiloChecksum *st) G_GNUC_NON_NULL(1);
+guint32
+xb_silo_column_find(const guint16 *ids,
+		    const guint16 *depths,
+		    guint32 idx,
+		    guint32 idx_end,
+		    guint16 id,
+		    guint16 depth);
+guint32
+xb_silo_column_find_scalar(const guint16 *ids,
+			   const guint16 *depths,
+			   guint32 idx,
+			   guint32 idx_end,
+			   guint16 id,
+			   guint16 depth);
 guint32
 xb_silo_get_offset_for_node(XbSilo *self, XbSiloNode *n) G_GNUC_NON_NULL(1, 2);
 XbSiloNode *
@@ -59,6 +245,14 @@ XbSiloNode *
 xb_silo_get_next_node(XbSilo *self, XbSiloNode *n, GError **error) G_GNUC_NON_NULL(1, 2);
 XbSiloNode *
 xb_silo_get_child_node(XbSilo *self, XbSiloNode *n, GError **error) G_GNUC_NON_NULL(1, 2);
+gboolean
+xb_silo_try_get_next_node(XbSilo *self, XbSiloNode *n, XbSiloNode **next, GError **error)
+    G_GNUC_NON_NULL(1, 2, 3);
+gboolean
+xb_silo_try_get_child_node(XbSilo *self, XbSiloNode *n, XbSiloNode **child, GError **error)
+    G_GNUC_NON_NULL(1, 2, 3);
+gboolean
+xb_silo_is_verified(XbSilo *self) G_GNUC_NON_NULL(1);
 const gchar *
 xb_silo_get_node_element(XbSilo *self, XbSiloNode *n, GError **error) G_GNUC_NON_NULL(1, 2);
 XbSiloNodeAttr *
@@ -203,6 +203,11 @@ xb_silo_query_section_root(XbSilo *self,
 	XbMachine *machine = xb_silo_get_machine(self);
 	XbSiloQueryData *query_data = helper->query_data;
 	XbQuerySection *section = g_ptr_array_index(helper->sections, i);
+	gboolean use_columns = FALSE;
+	gboolean use_postings = FALSE;
+	XbSiloColumnIter column_iter = {0x0};
+	guint32 posting_idx = 0;
+	guint32 posting_idx_end = 0;
 
 	/* handle parent */
 	if (section->kind == XB_SILO_QUERY_KIND_PARENT) {
@@ -229,20 +234,39 @@ xb_silo_query_section_root(XbSilo *self,
 						  error);
 	}
 
-	/* no node means root */
-	if (sn == NULL) {
+	/* jump straight to the matching children if possible; the postings
+	 * only contain the matches, but the columns scan the whole subtree */
+	if (section->kind == XB_SILO_QUERY_KIND_UNKNOWN &&
+	    xb_silo_get_postings(self,
+				 sn != NULL ? xb_silo_get_offset_for_node(self, sn) : 0,
+				 section->element_idx,
+				 &posting_idx,
+				 &posting_idx_end)) {
+		if (posting_idx == posting_idx_end)
+			return TRUE;
+		use_postings = TRUE;
+		sn = xb_silo_get_node(self, xb_silo_get_posting(self, posting_idx), error);
+		if (sn == NULL)
+			return FALSE;
+	} else if (section->kind == XB_SILO_QUERY_KIND_UNKNOWN &&
+		   xb_silo_column_iter_init(self, &column_iter, sn, section->element_idx)) {
+		guint32 off = xb_silo_column_iter_next(self, &column_iter);
+		if (off == 0)
+			return TRUE;
+		use_columns = TRUE;
+		sn = xb_silo_get_node(self, off, error);
+		if (sn == NULL)
+			return FALSE;
+	} else if (sn == NULL) {
+		/* no node means root */
 		sn = xb_silo_get_root_node(self, error);
 		if (sn == NULL)
 			return FALSE;
 	} else {
-		g_autoptr(GError) error_local = NULL;
-		sn = xb_silo_get_child_node(self, sn, &error_local);
-		if (sn == NULL) {
-			if (g_error_matches(error_local, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT))
-				return TRUE;
-			g_propagate_error(error, g_steal_pointer(&error_local));
+		if (!xb_silo_try_get_child_node(self, sn, &sn, error))
 			return FALSE;
-		}
+		if (sn == NULL)
+			return TRUE;
 	}
 
 	/* set up level pointer */
@@ -281,9 +305,21 @@ xb_silo_query_section_root(XbSilo *self,
 					break;
 			}
 		}
-		if (sn->next == 0x0)
-			break;
-		sn_new = xb_silo_get_node(self, sn->next, error);
+		if (use_columns) {
+			guint32 off = xb_silo_column_iter_next(self, &column_iter);
+			if (off == 0)
+				break;
+			sn_new = xb_silo_get_node(self, off, error);
+		} else if (use_postings) {
+			if (++posting_idx >= posting_idx_end)
+				break;
+			sn_new = xb_silo_get_node(self, xb_silo_get_posting(self, posting_idx), error);
+		} else {
+			if (!xb_silo_try_get_next_node(self, sn, &sn_new, error))
+				return FALSE;
+			if (sn_new == NULL)
+				break;
+		}
 		if (sn_new == NULL)
 			return FALSE;
 		if (sn_new <= sn) {
@@ -768,6 +804,9 @@ xb_silo_query_first(XbSilo *self, const gchar *xpath, GError **error)
  *
  * Adds the `attr()` or `text()` results of a query to the index.
  *
+ * This does nothing if the silo was compiled with
+ * %XB_BUILDER_COMPILE_FLAG_STRTAB_INDEX as every string is already indexed.
+ *
  * Returns: %TRUE for success
  *
  * Since: 0.1.4
@@ -782,6 +821,10 @@ xb_silo_query_build_index(XbSilo *self, const gchar *xpath, const gchar *attr, G
 	g_return_val_if_fail(xpath != NULL, FALSE);
 	g_return_val_if_fail(error == NULL || *error == NULL, FALSE);
 
+	/* already persisted in the blob */
+	if (xb_silo_has_strtab_index(self))
+		return TRUE;
+
 	/* do the query */
 	array =
 	    silo_query_with_root(self, NULL, xpath, 0, XB_SILO_QUERY_HELPER_USE_SN, &error_local);
@@ -34,6 +34,18 @@
 #include <libstemmer.h>
 #endif
 
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+
+/* blocks are written once and then read many times */
+#define XB_SILO_BLOCK_ZSTD_LEVEL 9
+#endif
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define XB_SILO_HAVE_AVX2 1
+#endif
+
 #include "xb-builder.h"
 #include "xb-common-private.h"
 #include "xb-machine-private.h"
@@ -43,17 +55,50 @@
 #include "xb-stack-private.h"
 #include "xb-string-private.h"
 
+typedef struct {
+	gint refcount;	   /* (atomic) */
+	const guint8 *src; /* pointer into the compressed blob */
+	guint32 block_size;
+	guint32 n_blocks;
+	guint32 datasz;
+	guint8 *data;	      /* only the ready blocks are valid */
+	gint *ready;	      /* (atomic) */
+	gint decompressed;    /* (atomic) */
+	GMutex mutex;
+#ifdef HAVE_ZSTD
+	ZSTD_DCtx *dctx; /* (mutex mutex) */
+#endif
+} XbSiloBlocks;
+
+typedef struct {
+	gint refcount; /* (atomic) */
+	gchar *data;   /* decoded one restart interval at a time */
+	gint *ready;   /* (atomic) for each restart */
+	gint decoded;  /* (atomic) */
+	GMutex mutex;
+} XbSiloStrtabFc;
+
 typedef struct {
 	GMappedFile *mmap;
 	gchar *guid;
 	gboolean valid;
+	gboolean verified; /* every node offset has been checked */
 	GBytes *blob;
-	const guint8 *data; /* pointers into ->blob */
+	GBytes *blob_decoded; /* only set for a compact nodetab */
+	XbSiloBlocks *blocks; /* only set for a block-compressed blob */
+	const guint8 *data;   /* pointers into ->blob, or ->blob_decoded */
 	guint32 datasz;
 	guint32 strtab;
+	guint32 strtabsz;
+	guint32 postings;
+	guint32 strindex_off;
+	guint32 tagtab;
+	guint32 columns;
 	GHashTable *strtab_tags;
 	GHashTable *strindex;
 	GRWLock strindex_mutex;
+	guint32 strtab_fc_sz;	   /* encoded size, or 0 if the strtab is flat */
+	XbSiloStrtabFc *strtab_fc; /* only set for a front-coded strtab */
 	gboolean enable_node_cache;
 	GHashTable *nodes; /* (mutex nodes_mutex) */
 	GMutex nodes_mutex;
@@ -66,6 +111,10 @@ typedef struct {
 	GRWLock query_cache_mutex;
 	GHashTable *query_cache;
 	GMainContext *context; /* (owned) */
+	gboolean is_snapshot;
+	XbSilo *snapshot;	 /* (mutex snapshot_mutex) (owned): last successful load */
+	gboolean snapshot_bound; /* (mutex snapshot_mutex): machine copied */
+	GMutex snapshot_mutex;
 #ifdef HAVE_LIBSTEMMER
 	struct sb_stemmer *stemmer_ctx; /* lazy loaded */
 	GMutex stemmer_mutex;
@@ -174,6 +223,628 @@ xb_silo_stem(XbSilo *self, const gchar *value)
 #endif
 }
 
+static XbSiloBlocks *
+xb_silo_blocks_ref(XbSiloBlocks *blocks)
+{
+	g_atomic_int_inc(&blocks->refcount);
+	return blocks;
+}
+
+static void
+xb_silo_blocks_unref(XbSiloBlocks *blocks)
+{
+	if (!g_atomic_int_dec_and_test(&blocks->refcount))
+		return;
+#ifdef HAVE_ZSTD
+	ZSTD_freeDCtx(blocks->dctx);
+#endif
+	g_mutex_clear(&blocks->mutex);
+	g_free(blocks->ready);
+	g_free(blocks->data);
+	g_free(blocks);
+}
+
+static XbSiloBlocks *
+xb_silo_blocks_new(const guint8 *src, gsize srcsz, GError **error)
+{
+	const XbSiloBlocksHeader *bhdr = (const XbSiloBlocksHeader *)src;
+	guint64 indexsz;
+	guint32 off_last = 0;
+	XbSiloBlocks *blocks;
+
+#ifndef HAVE_ZSTD
+	g_set_error_literal(error,
+			    G_IO_ERROR,
+			    G_IO_ERROR_NOT_SUPPORTED,
+			    "block-compressed silos require zstd support");
+	return NULL;
+#endif
+
+	/* validate the index */
+	if (bhdr->block_size == 0 || bhdr->datasz < sizeof(XbSiloHeader) ||
+	    bhdr->datasz > G_MAXINT32 ||
+	    bhdr->n_blocks != (bhdr->datasz + (guint64)bhdr->block_size - 1) / bhdr->block_size) {
+		g_set_error_literal(error,
+				    G_IO_ERROR,
+				    G_IO_ERROR_INVALID_DATA,
+				    "blocks header incorrect");
+		return NULL;
+	}
+	indexsz = sizeof(XbSiloBlocksHeader) + ((guint64)bhdr->n_blocks + 1) * sizeof(guint32);
+	if (indexsz > srcsz) {
+		g_set_error_literal(error,
+				    G_IO_ERROR,
+				    G_IO_ERROR_INVALID_DATA,
+				    "blocks index truncated");
+		return NULL;
+	}
+	for (guint32 i = 0; i <= bhdr->n_blocks; i++) {
+		guint32 off;
+		memcpy(&off,
+		       src + sizeof(XbSiloBlocksHeader) + i * sizeof(guint32),
+		       sizeof(off));
+		if (off < indexsz || off < off_last || off > srcsz ||
+		    (i > 0 && off == off_last)) {
+			g_set_error(error,
+				    G_IO_ERROR,
+				    G_IO_ERROR_INVALID_DATA,
+				    "blocks index incorrect for block %u",
+				    i);
+			return NULL;
+		}
+#ifdef HAVE_ZSTD
+		/* each block is exactly one frame of the expected size */
+		if (i > 0) {
+			guint32 idx = i - 1;
+			guint64 sz = MIN(bhdr->block_size,
+					 bhdr->datasz - (guint64)idx * bhdr->block_size);
+			gsize framesz = ZSTD_findFrameCompressedSize(src + off_last, off - off_last);
+			unsigned long long contentsz =
+			    ZSTD_getFrameContentSize(src + off_last, off - off_last);
+			if (ZSTD_isError(framesz) || framesz != off - off_last ||
+			    contentsz != sz) {
+				g_set_error(error,
+					    G_IO_ERROR,
+					    G_IO_ERROR_INVALID_DATA,
+					    "block %u size incorrect",
+					    idx);
+				return NULL;
+			}
+		}
+#endif
+		off_last = off;
+	}
+
+	/* the buffer is not touched until each block is required, but blocks are
+	 * never evicted as nodes and strings are returned as pointers into it */
+	blocks = g_new0(XbSiloBlocks, 1);
+	blocks->refcount = 1;
+	blocks->src = src;
+	blocks->block_size = bhdr->block_size;
+	blocks->n_blocks = bhdr->n_blocks;
+	blocks->datasz = bhdr->datasz;
+	blocks->data = g_malloc0(bhdr->datasz);
+	blocks->ready = g_new0(gint, bhdr->n_blocks);
+	g_mutex_init(&blocks->mutex);
+#ifdef HAVE_ZSTD
+	blocks->dctx = ZSTD_createDCtx();
+#endif
+	return blocks;
+}
+
+/* a block is only marked as ready if it decompressed to the expected size */
+static gboolean
+xb_silo_blocks_ensure_block(XbSiloBlocks *blocks, guint32 idx, GError **error)
+{
+	guint32 off;
+	guint32 off_next;
+	gsize sz = MIN(blocks->block_size, blocks->datasz - idx * blocks->block_size);
+	g_autoptr(GMutexLocker) locker = NULL;
+
+	if (g_atomic_int_get(&blocks->ready[idx]))
+		return TRUE;
+	locker = g_mutex_locker_new(&blocks->mutex);
+	if (g_atomic_int_get(&blocks->ready[idx]))
+		return TRUE;
+
+	memcpy(&off, blocks->src + sizeof(XbSiloBlocksHeader) + idx * sizeof(guint32), sizeof(off));
+	memcpy(&off_next,
+	       blocks->src + sizeof(XbSiloBlocksHeader) + (idx + 1) * sizeof(guint32),
+	       sizeof(off_next));
+#ifdef HAVE_ZSTD
+	{
+		gsize rc = ZSTD_decompressDCtx(blocks->dctx,
+					       blocks->data + (gsize)idx * blocks->block_size,
+					       sz,
+					       blocks->src + off,
+					       off_next - off);
+		if (ZSTD_isError(rc)) {
+			g_set_error(error,
+				    G_IO_ERROR,
+				    G_IO_ERROR_INVALID_DATA,
+				    "failed to decompress block %u: %s",
+				    idx,
+				    ZSTD_getErrorName(rc));
+			return FALSE;
+		}
+		if (rc != sz) {
+			g_set_error(error,
+				    G_IO_ERROR,
+				    G_IO_ERROR_INVALID_DATA,
+				    "block %u decompressed to 0x%x bytes",
+				    idx,
+				    (guint)rc);
+			return FALSE;
+		}
+	}
+#endif
+	g_atomic_int_add(&blocks->decompressed, (gint)sz);
+	g_atomic_int_set(&blocks->ready[idx], TRUE);
+	return TRUE;
+}
+
+static gboolean
+xb_silo_blocks_ensure(XbSiloBlocks *blocks, guint32 off, guint32 sz, GError **error)
+{
+	guint32 end = MIN((guint64)off + sz, blocks->datasz);
+	if (off >= end)
+		return TRUE;
+	for (guint32 i = off / blocks->block_size; i <= (end - 1) / blocks->block_size; i++) {
+		if (!xb_silo_blocks_ensure_block(blocks, i, error))
+			return FALSE;
+	}
+	return TRUE;
+}
+
+/* the string may continue into the next block */
+static gboolean
+xb_silo_blocks_ensure_str(XbSiloBlocks *blocks, guint32 off, GError **error)
+{
+	for (guint32 i = off / blocks->block_size; i < blocks->n_blocks; i++) {
+		guint32 block_end = MIN((i + 1) * (guint64)blocks->block_size, blocks->datasz);
+		if (!xb_silo_blocks_ensure_block(blocks, i, error))
+			return FALSE;
+		if (memchr(blocks->data + off, '\0', block_end - off) != NULL)
+			return TRUE;
+		off = block_end;
+	}
+	return TRUE;
+}
+
+/* private: returns the number of bytes that have been decompressed */
+guint32
+xb_silo_get_blocks_decompressed(XbSilo *self)
+{
+	XbSiloPrivate *priv = GET_PRIVATE(self);
+	if (priv->blocks == NULL)
+		return priv->datasz;
+	return (guint32)g_atomic_int_get(&priv->blocks->decompressed);
+}
+
+static gboolean
+xb_silo_varint_read(const guint8 *data, gsize sz, gsize *off, guint32 *value, GError **error)
+{
+	guint32 tmp = 0;
+	for (guint i = 0; i < XB_SILO_VARINT_MAX; i++) {
+		if (*off >= sz) {
+			g_set_error_literal(error,
+					    G_IO_ERROR,
+					    G_IO_ERROR_INVALID_DATA,
+					    "varint truncated");
+			return FALSE;
+		}
+		tmp |= ((guint32)(data[*off] & 0x7f)) << (7 * i);
+		if ((data[(*off)++] & 0x80) == 0) {
+			*value = tmp;
+			return TRUE;
+		}
+	}
+	g_set_error_literal(error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA, "varint too long");
+	return FALSE;
+}
+
+static XbSiloStrtabFc *
+xb_silo_strtab_fc_new(guint32 size, guint32 n_restarts)
+{
+	XbSiloStrtabFc *fc = g_new0(XbSiloStrtabFc, 1);
+	fc->refcount = 1;
+	fc->data = g_malloc(size);
+	fc->ready = g_new0(gint, n_restarts);
+	g_mutex_init(&fc->mutex);
+	return fc;
+}
+
+static XbSiloStrtabFc *
+xb_silo_strtab_fc_ref(XbSiloStrtabFc *fc)
+{
+	g_atomic_int_inc(&fc->refcount);
+	return fc;
+}
+
+static void
+xb_silo_strtab_fc_unref(XbSiloStrtabFc *fc)
+{
+	if (!g_atomic_int_dec_and_test(&fc->refcount))
+		return;
+	g_mutex_clear(&fc->mutex);
+	g_free(fc->ready);
+	g_free(fc->data);
+	g_free(fc);
+}
+
+/* decodes each restart interval into the flat strtab the first time it is used,
+ * so the returned string is valid for as long as the blob is loaded */
+static const gchar *
+xb_silo_strtab_fc_lookup(XbSilo *self, guint32 offset, GError **error)
+{
+	XbSiloPrivate *priv = GET_PRIVATE(self);
+	XbSiloStrtabFc *fc = priv->strtab_fc;
+	const XbSiloStrtabFcHeader *fchdr =
+	    (const XbSiloStrtabFcHeader *)(priv->data + priv->strtab);
+	const XbSiloStrtabFcRestart *restarts =
+	    (const XbSiloStrtabFcRestart *)(priv->data + priv->strtab +
+					    sizeof(XbSiloStrtabFcHeader));
+	const guint8 *data = (const guint8 *)(restarts + fchdr->n_restarts);
+	gsize datasz = priv->strtab_fc_sz - sizeof(XbSiloStrtabFcHeader) -
+		       fchdr->n_restarts * sizeof(XbSiloStrtabFcRestart);
+	gsize pos;
+	guint32 logical;
+	guint32 end;
+	guint32 lo = 0;
+	guint32 hi = fchdr->n_restarts;
+	g_autoptr(GMutexLocker) locker = NULL;
+	g_autoptr(GString) str = NULL;
+
+	/* find the last restart at or before the offset */
+	while (hi - lo > 1) {
+		guint32 mid = lo + (hi - lo) / 2;
+		if (restarts[mid].offset <= offset)
+			lo = mid;
+		else
+			hi = mid;
+	}
+
+	/* already decoded */
+	if (g_atomic_int_get(&fc->ready[lo]))
+		return fc->data + offset;
+	locker = g_mutex_locker_new(&fc->mutex);
+	if (g_atomic_int_get(&fc->ready[lo]))
+		return fc->data + offset;
+
+	/* every string up to the next restart */
+	str = g_string_new(NULL);
+	pos = restarts[lo].data;
+	logical = restarts[lo].offset;
+	end = lo + 1 < fchdr->n_restarts ? restarts[lo + 1].offset : fchdr->size;
+	while (logical < end) {
+		guint32 shared = 0;
+		guint32 suffix = 0;
+		if (!xb_silo_varint_read(data, datasz, &pos, &shared, error) ||
+		    !xb_silo_varint_read(data, datasz, &pos, &suffix, error))
+			return NULL;
+		if (shared > str->len || suffix > datasz - pos ||
+		    (guint64)shared + suffix >= end - logical) {
+			g_set_error(error,
+				    G_IO_ERROR,
+				    G_IO_ERROR_INVALID_DATA,
+				    "front-coded strtab invalid for %u",
+				    offset);
+			return NULL;
+		}
+		g_string_truncate(str, shared);
+		g_string_append_len(str, (const gchar *)data + pos, suffix);
+		pos += suffix;
+		memcpy(fc->data + logical, str->str, str->len + 1);
+		logical += str->len + 1;
+	}
+	g_atomic_int_add(&fc->decoded, (gint)(end - restarts[lo].offset));
+	g_atomic_int_set(&fc->ready[lo], TRUE);
+	return fc->data + offset;
+}
+
+/* private: returns the number of bytes of the front-coded strtab decoded */
+guint32
+xb_silo_get_strtab_fc_decoded(XbSilo *self)
+{
+	XbSiloPrivate *priv = GET_PRIVATE(self);
+	if (priv->strtab_fc == NULL)
+		return 0;
+	return (guint32)g_atomic_int_get(&priv->strtab_fc->decoded);
+}
+
+#define XB_SILO_XXH_PRIME1 0x9E3779B185EBCA87ull
+#define XB_SILO_XXH_PRIME2 0xC2B2AE3D27D4EB4Full
+#define XB_SILO_XXH_PRIME3 0x165667B19E3779F9ull
+#define XB_SILO_XXH_PRIME4 0x85EBCA77C2B2AE63ull
+#define XB_SILO_XXH_PRIME5 0x27D4EB2F165667C5ull
+
+static inline guint64
+xb_silo_xxh64_rotl(guint64 value, guint bits)
+{
+	return (value << bits) | (value >> (64 - bits));
+}
+
+static inline guint64
+xb_silo_xxh64_round(guint64 acc, guint64 input)
+{
+	acc += input * XB_SILO_XXH_PRIME2;
+	acc = xb_silo_xxh64_rotl(acc, 31);
+	return acc * XB_SILO_XXH_PRIME1;
+}
+
+static inline guint64
+xb_silo_xxh64_merge(guint64 acc, guint64 value)
+{
+	acc ^= xb_silo_xxh64_round(0, value);
+	return acc * XB_SILO_XXH_PRIME1 + XB_SILO_XXH_PRIME4;
+}
+
+static inline guint64
+xb_silo_xxh64_read64(const guint8 *buf)
+{
+	guint64 tmp;
+	memcpy(&tmp, buf, sizeof(tmp));
+	return GUINT64_FROM_LE(tmp);
+}
+
+static void
+xb_silo_xxh64_init(XbSiloChecksum *st, guint64 seed)
+{
+	st->v[0] = seed + XB_SILO_XXH_PRIME1 + XB_SILO_XXH_PRIME2;
+	st->v[1] = seed + XB_SILO_XXH_PRIME2;
+	st->v[2] = seed;
+	st->v[3] = seed - XB_SILO_XXH_PRIME1;
+	st->seed = seed;
+	st->total = 0;
+	st->memsz = 0;
+}
+
+static inline void
+xb_silo_xxh64_stripe(XbSiloChecksum *st, const guint8 *buf)
+{
+	st->v[0] = xb_silo_xxh64_round(st->v[0], xb_silo_xxh64_read64(buf));
+	st->v[1] = xb_silo_xxh64_round(st->v[1], xb_silo_xxh64_read64(buf + 8));
+	st->v[2] = xb_silo_xxh64_round(st->v[2], xb_silo_xxh64_read64(buf + 16));
+	st->v[3] = xb_silo_xxh64_round(st->v[3], xb_silo_xxh64_read64(buf + 24));
+}
+
+static void
+xb_silo_xxh64_update(XbSiloChecksum *st, const guint8 *buf, gsize bufsz)
+{
+	const guint8 *end = buf + bufsz;
+
+	st->total += bufsz;
+
+	/* not enough for a whole stripe */
+	if (st->memsz + bufsz < sizeof(st->mem)) {
+		memcpy(st->mem + st->memsz, buf, bufsz);
+		st->memsz += bufsz;
+		return;
+	}
+
+	/* complete the stripe from last time */
+	if (st->memsz > 0) {
+		gsize fill = sizeof(st->mem) - st->memsz;
+		memcpy(st->mem + st->memsz, buf, fill);
+		xb_silo_xxh64_stripe(st, st->mem);
+		buf += fill;
+		st->memsz = 0;
+	}
+	for (; end - buf >= 32; buf += 32)
+		xb_silo_xxh64_stripe(st, buf);
+
+	/* save for next time */
+	memcpy(st->mem, buf, end - buf);
+	st->memsz = end - buf;
+}
+
+static guint64
+xb_silo_xxh64_finish(XbSiloChecksum *st)
+{
+	const guint8 *buf = st->mem;
+	const guint8 *end = st->mem + st->memsz;
+	guint64 h;
+
+	if (st->total >= 32) {
+		h = xb_silo_xxh64_rotl(st->v[0], 1) + xb_silo_xxh64_rotl(st->v[1], 7) +
+		    xb_silo_xxh64_rotl(st->v[2], 12) + xb_silo_xxh64_rotl(st->v[3], 18);
+		h = xb_silo_xxh64_merge(h, st->v[0]);
+		h = xb_silo_xxh64_merge(h, st->v[1]);
+		h = xb_silo_xxh64_merge(h, st->v[2]);
+		h = xb_silo_xxh64_merge(h, st->v[3]);
+	} else {
+		h = st->seed + XB_SILO_XXH_PRIME5;
+	}
+	h += st->total;
+	for (; end - buf >= 8; buf += 8) {
+		h ^= xb_silo_xxh64_round(0, xb_silo_xxh64_read64(buf));
+		h = xb_silo_xxh64_rotl(h, 27) * XB_SILO_XXH_PRIME1 + XB_SILO_XXH_PRIME4;
+	}
+	if (end - buf >= 4) {
+		guint32 tmp;
+		memcpy(&tmp, buf, sizeof(tmp));
+		h ^= (guint64)GUINT32_FROM_LE(tmp) * XB_SILO_XXH_PRIME1;
+		h = xb_silo_xxh64_rotl(h, 23) * XB_SILO_XXH_PRIME2 + XB_SILO_XXH_PRIME3;
+		buf += 4;
+	}
+	for (; buf < end; buf++) {
+		h ^= (*buf) * XB_SILO_XXH_PRIME5;
+		h = xb_silo_xxh64_rotl(h, 11) * XB_SILO_XXH_PRIME1;
+	}
+	h ^= h >> 33;
+	h *= XB_SILO_XXH_PRIME2;
+	h ^= h >> 29;
+	h *= XB_SILO_XXH_PRIME3;
+	h ^= h >> 32;
+	return h;
+}
+
+/* private: the header is hashed with the checksum cleared, and then used as
+ * the seed for the rest of the file, which can be added in pieces */
+void
+xb_silo_checksum_init(XbSiloChecksum *st, const XbSiloHeader *hdr)
+{
+	XbSiloHeader hdr_tmp;
+	memcpy(&hdr_tmp, hdr, sizeof(hdr_tmp));
+	hdr_tmp.checksum = 0;
+	xb_silo_xxh64_init(st, 0);
+	xb_silo_xxh64_update(st, (const guint8 *)&hdr_tmp, sizeof(hdr_tmp));
+	xb_silo_xxh64_init(st, xb_silo_xxh64_finish(st));
+}
+
+/* private, for content that is not a silo */
+void
+xb_silo_checksum_init_data(XbSiloChecksum *st)
+{
+	xb_silo_xxh64_init(st, 0);
+}
+
+/* private */
+void
+xb_silo_checksum_update(XbSiloChecksum *st, const guint8 *buf, gsize bufsz)
+{
+	xb_silo_xxh64_update(st, buf, bufsz);
+}
+
+/* private */
+guint64
+xb_silo_checksum_finish(XbSiloChecksum *st)
+{
+	return xb_silo_xxh64_finish(st);
+}
+
+/* private */
+guint64
+xb_silo_compute_checksum(const guint8 *data, gsize datasz)
+{
+	XbSiloChecksum st;
+	g_return_val_if_fail(datasz >= sizeof(XbSiloHeader), 0);
+	xb_silo_checksum_init(&st, (const XbSiloHeader *)data);
+	xb_silo_checksum_update(&st, data + sizeof(XbSiloHeader), datasz - sizeof(XbSiloHeader));
+	return xb_silo_checksum_finish(&st);
+}
+
+static inline gboolean
+xb_silo_verify_is_node(const guint8 *starts, guint32 strtab, guint32 off)
+{
+	return off < strtab && (starts[off / 8] & (1 << (off % 8))) > 0;
+}
+
+static inline gboolean
+xb_silo_verify_is_string(XbSilo *self, guint32 off)
+{
+	XbSiloPrivate *priv = GET_PRIVATE(self);
+	return off < priv->strtabsz;
+}
+
+/* a single sweep of every node so the hot paths can skip their checks */
+static gboolean
+xb_silo_verify(XbSilo *self, GError **error)
+{
+	XbSiloPrivate *priv = GET_PRIVATE(self);
+	g_autofree guint8 *starts = g_new0(guint8, priv->strtab / 8 + 1);
+
+	/* every node fits, and refers only to strings that exist */
+	for (guint32 off = sizeof(XbSiloHeader); off < priv->strtab;) {
+		XbSiloNode *n = (XbSiloNode *)(priv->data + off);
+		guint32 nodesz = sizeof(guint8);
+		if (xb_silo_node_has_flag(n, XB_SILO_NODE_FLAG_IS_ELEMENT)) {
+			nodesz = sizeof(XbSiloNode);
+			if (nodesz <= priv->strtab - off)
+				nodesz = xb_silo_node_get_size(n);
+		}
+		if (nodesz > priv->strtab - off) {
+			g_set_error(error,
+				    G_IO_ERROR,
+				    G_IO_ERROR_INVALID_DATA,
+				    "node @%u overflows the nodetab",
+				    off);
+			return FALSE;
+		}
+		if (xb_silo_node_has_flag(n, XB_SILO_NODE_FLAG_IS_ELEMENT)) {
+			gboolean ok = xb_silo_verify_is_string(self, n->element_name);
+			if (n->text != XB_SILO_UNSET)
+				ok &= xb_silo_verify_is_string(self, n->text);
+			if (n->tail != XB_SILO_UNSET)
+				ok &= xb_silo_verify_is_string(self, n->tail);
+			for (guint32 i = sizeof(XbSiloNode); i < nodesz; i += sizeof(guint32)) {
+				guint32 tmp;
+				memcpy(&tmp, priv->data + off + i, sizeof(tmp));
+				ok &= xb_silo_verify_is_string(self, tmp);
+			}
+			if (!ok) {
+				g_set_error(error,
+					    G_IO_ERROR,
+					    G_IO_ERROR_INVALID_DATA,
+					    "node @%u has an invalid string",
+					    off);
+				return FALSE;
+			}
+			starts[off / 8] |= 1 << (off % 8);
+		}
+		off += nodesz;
+	}
+
+	/* every link points at an element, and every subtree is closed */
+	for (guint32 off = sizeof(XbSiloHeader); off < priv->strtab;) {
+		XbSiloNode *n = (XbSiloNode *)(priv->data + off);
+		guint32 nodesz = xb_silo_node_get_size(n);
+		if (xb_silo_node_has_flag(n, XB_SILO_NODE_FLAG_IS_ELEMENT)) {
+			if ((n->parent != 0 &&
+			     (n->parent >= off || !xb_silo_verify_is_node(starts, off, n->parent))) ||
+			    (n->next != 0 && (n->next < n->end || !xb_silo_verify_is_node(starts,
+											  priv->strtab,
+											  n->next))) ||
+			    n->end <= off + nodesz || n->end > priv->strtab ||
+			    xb_silo_node_has_flag((XbSiloNode *)(priv->data + n->end - 1),
+						  XB_SILO_NODE_FLAG_IS_ELEMENT)) {
+				g_set_error(error,
+					    G_IO_ERROR,
+					    G_IO_ERROR_INVALID_DATA,
+					    "node @%u has an invalid link",
+					    off);
+				return FALSE;
+			}
+		}
+		off += nodesz;
+	}
+
+	/* the accelerators only point at elements */
+	if (priv->postings != 0) {
+		const XbSiloPostingsHeader *phdr =
+		    (const XbSiloPostingsHeader *)(priv->data + priv->postings);
+		for (guint32 i = 0; i < phdr->n_nodes; i++) {
+			if (!xb_silo_verify_is_node(starts,
+						    priv->strtab,
+						    xb_silo_get_posting(self, i))) {
+				g_set_error(error,
+					    G_IO_ERROR,
+					    G_IO_ERROR_INVALID_DATA,
+					    "posting %u is invalid",
+					    i);
+				return FALSE;
+			}
+		}
+	}
+	if (priv->columns != 0) {
+		const XbSiloColumnsHeader *chdr =
+		    (const XbSiloColumnsHeader *)(priv->data + priv->columns);
+		const guint32 *offsets = (const guint32 *)(priv->data + priv->columns + chdr->data +
+							   chdr->n_padded * 2 * sizeof(guint16));
+		for (guint32 i = 0; i < chdr->n_nodes; i++) {
+			if (!xb_silo_verify_is_node(starts, priv->strtab, offsets[i])) {
+				g_set_error(error,
+					    G_IO_ERROR,
+					    G_IO_ERROR_INVALID_DATA,
+					    "column %u is invalid",
+					    i);
+				return FALSE;
+			}
+		}
+	}
+	return TRUE;
+}
+
 /* private */
 const gchar *
 xb_silo_from_strtab(XbSilo *self, guint32 offset, GError **error)
@@ -183,7 +854,7 @@ xb_silo_from_strtab(XbSilo *self, guint32 offset, GError **error)
 		g_set_error_literal(error, G_IO_ERROR, G_IO_ERROR_NOT_FOUND, "offset was unset");
 		return NULL;
 	}
-	if (offset >= priv->datasz - priv->strtab) {
+	if (offset >= priv->strtabsz) {
 		g_set_error(error,
 			    G_IO_ERROR,
 			    G_IO_ERROR_INVALID_DATA,
@@ -191,9 +862,23 @@ xb_silo_from_strtab(XbSilo *self, guint32 offset, GError **error)
 			    offset);
 		return NULL;
 	}
+	if (priv->strtab_fc_sz != 0)
+		return xb_silo_strtab_fc_lookup(self, offset, error);
+	if (G_UNLIKELY(priv->blocks != NULL)) {
+		if (!xb_silo_blocks_ensure_str(priv->blocks, priv->strtab + offset, error))
+			return NULL;
+	}
 	return (const gchar *)(priv->data + priv->strtab + offset);
 }
 
+/* private */
+gboolean
+xb_silo_has_strtab_index(XbSilo *self)
+{
+	XbSiloPrivate *priv = GET_PRIVATE(self);
+	return priv->strindex_off != 0;
+}
+
 /* private */
 gboolean
 xb_silo_strtab_index_insert(XbSilo *self, guint32 offset, GError **error)
@@ -202,6 +887,10 @@ xb_silo_strtab_index_insert(XbSilo *self, guint32 offset, GError **error)
 	const gchar *tmp;
 	g_autoptr(GRWLockWriterLocker) locker_rw = NULL;
 
+	/* every string is already in the persisted index */
+	if (priv->strindex_off != 0)
+		return TRUE;
+
 	/* get the string version */
 	tmp = xb_silo_from_strtab(self, offset, error);
 	if (tmp == NULL)
@@ -213,6 +902,30 @@ xb_silo_strtab_index_insert(XbSilo *self, guint32 offset, GError **error)
 	return TRUE;
 }
 
+static guint32
+xb_silo_strtab_index_lookup_blob(XbSilo *self, const gchar *str)
+{
+	XbSiloPrivate *priv = GET_PRIVATE(self);
+	const XbSiloStrindexHeader *ihdr =
+	    (const XbSiloStrindexHeader *)(priv->data + priv->strindex_off);
+	const guint8 *buckets = priv->data + priv->strindex_off + sizeof(XbSiloStrindexHeader);
+	guint32 mask = ihdr->n_buckets - 1;
+	guint32 idx = xb_silo_strtab_hash(str, 0) & mask;
+
+	/* linear probe until an empty bucket */
+	for (guint32 i = 0; i < ihdr->n_buckets; i++) {
+		const gchar *tmp;
+		guint32 off;
+		memcpy(&off, buckets + (((idx + i) & mask) * sizeof(guint32)), sizeof(off));
+		if (off == XB_SILO_UNSET)
+			break;
+		tmp = xb_silo_from_strtab(self, off, NULL);
+		if (tmp != NULL && strcmp(tmp, str) == 0)
+			return off;
+	}
+	return XB_SILO_UNSET;
+}
+
 /* private */
 guint32
 xb_silo_strtab_index_lookup(XbSilo *self, const gchar *str)
@@ -221,6 +934,10 @@ xb_silo_strtab_index_lookup(XbSilo *self, const gchar *str)
 	gpointer val = NULL;
 	g_autoptr(GRWLockReaderLocker) locker_ro = NULL;
 
+	/* read directly from the mapping, no locking required */
+	if (priv->strindex_off != 0)
+		return xb_silo_strtab_index_lookup_blob(self, str);
+
 	locker_ro = g_rw_lock_reader_locker_new(&priv->strindex_mutex);
 	if (!g_hash_table_lookup_extended(priv->strindex, str, NULL, &val))
 		return XB_SILO_UNSET;
@@ -232,7 +949,7 @@ XbSiloNode *
 xb_silo_get_node(XbSilo *self, guint32 off, GError **error)
 {
 	XbSiloPrivate *priv = GET_PRIVATE(self);
-	if (G_UNLIKELY(off + 1 > priv->strtab)) {
+	if (G_UNLIKELY(!priv->verified && off + 1 > priv->strtab)) {
 		g_set_error(error,
 			    G_IO_ERROR,
 			    G_IO_ERROR_INVALID_DATA,
@@ -240,6 +957,15 @@ xb_silo_get_node(XbSilo *self, guint32 off, GError **error)
 			    off);
 		return NULL;
 	}
+	if (G_UNLIKELY(priv->blocks != NULL)) {
+		if (!xb_silo_blocks_ensure(priv->blocks, off, 1, error))
+			return NULL;
+		if (!xb_silo_blocks_ensure(priv->blocks,
+					   off,
+					   xb_silo_node_get_size((XbSiloNode *)(priv->data + off)),
+					   error))
+			return NULL;
+	}
 	return (XbSiloNode *)(priv->data + off);
 }
 
@@ -309,6 +1035,51 @@ xb_silo_get_next_node(XbSilo *self, XbSiloNode *n, GError **error)
 	return xb_silo_get_node(self, n->next, error);
 }
 
+/* private: as xb_silo_get_next_node(), but the last sibling is not an error */
+gboolean
+xb_silo_try_get_next_node(XbSilo *self, XbSiloNode *n, XbSiloNode **next, GError **error)
+{
+	XbSiloPrivate *priv = GET_PRIVATE(self);
+	if (n->next == 0x0) {
+		*next = NULL;
+		return TRUE;
+	}
+	if (priv->verified && priv->blocks == NULL) {
+		*next = (XbSiloNode *)(priv->data + n->next);
+		return TRUE;
+	}
+	*next = xb_silo_get_node(self, n->next, error);
+	return *next != NULL;
+}
+
+/* private: as xb_silo_get_child_node(), but a leaf is not an error */
+gboolean
+xb_silo_try_get_child_node(XbSilo *self, XbSiloNode *n, XbSiloNode **child, GError **error)
+{
+	XbSiloPrivate *priv = GET_PRIVATE(self);
+	XbSiloNode *c;
+
+	/* every element is followed by a child or a sentinel */
+	if (priv->verified && priv->blocks == NULL) {
+		c = (XbSiloNode *)(((guint8 *)n) + xb_silo_node_get_size(n));
+	} else {
+		guint32 off = xb_silo_get_offset_for_node(self, n) + xb_silo_node_get_size(n);
+		c = xb_silo_get_node(self, off, error);
+		if (c == NULL)
+			return FALSE;
+	}
+	*child = xb_silo_node_has_flag(c, XB_SILO_NODE_FLAG_IS_ELEMENT) ? c : NULL;
+	return TRUE;
+}
+
+/* private */
+gboolean
+xb_silo_is_verified(XbSilo *self)
+{
+	XbSiloPrivate *priv = GET_PRIVATE(self);
+	return priv->verified;
+}
+
 /* private */
 XbSiloNode *
 xb_silo_get_child_node(XbSilo *self, XbSiloNode *n, GError **error)
@@ -347,27 +1118,349 @@ xb_silo_get_root(XbSilo *self)
 	XbSiloNode *sn;
 	g_autoptr(GError) error_local = NULL;
 
-	g_return_val_if_fail(XB_IS_SILO(self), NULL);
+	g_return_val_if_fail(XB_IS_SILO(self), NULL);
+
+	sn = xb_silo_get_root_node(self, &error_local);
+	if (sn == NULL) {
+		/* if there are no XbSiloNodes, still build a root XbNode */
+		if (!g_error_matches(error_local, G_IO_ERROR, G_IO_ERROR_NOT_FOUND))
+			return NULL;
+		g_debug("ignoring: %s", error_local->message);
+	}
+	return xb_silo_create_node(self, sn, FALSE);
+}
+
+static guint32
+xb_silo_get_strtab_idx_blob(XbSilo *self, const gchar *element)
+{
+	XbSiloPrivate *priv = GET_PRIVATE(self);
+	const XbSiloTagtabHeader *thdr = (const XbSiloTagtabHeader *)(priv->data + priv->tagtab);
+	const guint8 *displacements = priv->data + priv->tagtab + sizeof(XbSiloTagtabHeader);
+	const guint8 *offsets = displacements + thdr->n_tags * sizeof(gint32);
+	const gchar *tmp;
+	guint32 bucket = xb_silo_strtab_hash(element, 0) % thdr->n_tags;
+	guint32 slot;
+	guint32 off;
+	gint32 displacement;
+
+	memcpy(&displacement, displacements + bucket * sizeof(gint32), sizeof(displacement));
+	if (displacement < 0)
+		slot = (guint32)(-(displacement + 1));
+	else
+		slot = xb_silo_strtab_hash(element, (guint32)displacement) % thdr->n_tags;
+	if (G_UNLIKELY(slot >= thdr->n_tags))
+		return XB_SILO_UNSET;
+
+	/* the hash is only perfect for names that exist */
+	memcpy(&off, offsets + slot * sizeof(guint32), sizeof(off));
+	tmp = xb_silo_from_strtab(self, off, NULL);
+	if (tmp == NULL || strcmp(tmp, element) != 0)
+		return XB_SILO_UNSET;
+	return off;
+}
+
+/* private */
+guint32
+xb_silo_get_strtab_idx(XbSilo *self, const gchar *element)
+{
+	XbSiloPrivate *priv = GET_PRIVATE(self);
+	gpointer value = NULL;
+
+	/* read directly from the mapping */
+	if (priv->tagtab != 0)
+		return xb_silo_get_strtab_idx_blob(self, element);
+	if (!g_hash_table_lookup_extended(priv->strtab_tags, element, NULL, &value))
+		return XB_SILO_UNSET;
+	return GPOINTER_TO_UINT(value);
+}
+
+/* private */
+static guint32
+xb_silo_get_posting_group_idx(const XbSiloPostingEntry *entries,
+			      const XbSiloPostingsHeader *phdr,
+			      guint32 i)
+{
+	if (i >= phdr->n_entries)
+		return phdr->n_groups;
+	return entries[i].group_idx;
+}
+
+/* private */
+static guint32
+xb_silo_get_posting_node_idx(const XbSiloPostingGroup *groups,
+			     const XbSiloPostingsHeader *phdr,
+			     guint32 i)
+{
+	if (i >= phdr->n_groups)
+		return phdr->n_nodes;
+	return groups[i].node_idx;
+}
+
+/* private: returns %FALSE if the silo has no posting lists, in which case the
+ * caller has to walk the ->next chain; otherwise [@idx, @idx_end) is the
+ * (possibly empty) range to use with xb_silo_get_posting() */
+gboolean
+xb_silo_get_postings(XbSilo *self,
+		     guint32 parent,
+		     guint32 element_name,
+		     guint32 *idx,
+		     guint32 *idx_end)
+{
+	XbSiloPrivate *priv = GET_PRIVATE(self);
+	const XbSiloPostingsHeader *phdr;
+	const XbSiloPostingEntry *entries;
+	const XbSiloPostingGroup *groups;
+	guint32 lo;
+	guint32 hi;
+	guint32 group_end;
+
+	/* not supported */
+	if (priv->postings == 0)
+		return FALSE;
+
+	phdr = (const XbSiloPostingsHeader *)(priv->data + priv->postings);
+	entries = (const XbSiloPostingEntry *)(priv->data + priv->postings +
+					       sizeof(XbSiloPostingsHeader));
+	groups = (const XbSiloPostingGroup *)(entries + phdr->n_entries);
+	*idx = 0;
+	*idx_end = 0;
+
+	/* element name not in silo */
+	if (element_name == XB_SILO_UNSET)
+		return TRUE;
+
+	/* find the element name */
+	lo = 0;
+	hi = phdr->n_entries;
+	while (lo < hi) {
+		guint32 mid = lo + (hi - lo) / 2;
+		if (entries[mid].element_name < element_name)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	if (lo >= phdr->n_entries || entries[lo].element_name != element_name)
+		return TRUE;
+
+	/* find the parent in the groups for this element */
+	hi = xb_silo_get_posting_group_idx(entries, phdr, lo + 1);
+	lo = entries[lo].group_idx;
+	if (G_UNLIKELY(lo > hi || hi > phdr->n_groups))
+		return FALSE;
+	group_end = hi;
+	while (lo < hi) {
+		guint32 mid = lo + (hi - lo) / 2;
+		if (groups[mid].parent < parent)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	if (lo >= group_end || groups[lo].parent != parent)
+		return TRUE;
+
+	/* success */
+	*idx = groups[lo].node_idx;
+	*idx_end = xb_silo_get_posting_node_idx(groups, phdr, lo + 1);
+	if (G_UNLIKELY(*idx > *idx_end || *idx_end > phdr->n_nodes))
+		return FALSE;
+	return TRUE;
+}
+
+/* private */
+guint32
+xb_silo_get_posting(XbSilo *self, guint32 idx)
+{
+	XbSiloPrivate *priv = GET_PRIVATE(self);
+	const XbSiloPostingsHeader *phdr =
+	    (const XbSiloPostingsHeader *)(priv->data + priv->postings);
+	guint32 off = priv->postings + sizeof(XbSiloPostingsHeader);
+	guint32 val;
+
+	off += phdr->n_entries * sizeof(XbSiloPostingEntry);
+	off += phdr->n_groups * sizeof(XbSiloPostingGroup);
+	off += idx * sizeof(guint32);
+	memcpy(&val, priv->data + off, sizeof(val));
+	return val;
+}
+
+/* private */
+guint32
+xb_silo_column_find_scalar(const guint16 *ids,
+			   const guint16 *depths,
+			   guint32 idx,
+			   guint32 idx_end,
+			   guint16 id,
+			   guint16 depth)
+{
+	for (; idx < idx_end; idx++) {
+		if (ids[idx] == id && depths[idx] == depth)
+			return idx;
+	}
+	return idx_end;
+}
+
+/* the columns are padded with a spare block, so reading past @idx_end is safe */
+#ifdef __SSE2__
+static guint32
+xb_silo_column_find_sse2(const guint16 *ids,
+			 const guint16 *depths,
+			 guint32 idx,
+			 guint32 idx_end,
+			 guint16 id,
+			 guint16 depth)
+{
+	__m128i id_v = _mm_set1_epi16((gint16)id);
+	__m128i depth_v = _mm_set1_epi16((gint16)depth);
+	for (; idx < idx_end; idx += 8) {
+		__m128i ids_v = _mm_loadu_si128((const __m128i *)(ids + idx));
+		__m128i depths_v = _mm_loadu_si128((const __m128i *)(depths + idx));
+		__m128i match_v =
+		    _mm_and_si128(_mm_cmpeq_epi16(ids_v, id_v), _mm_cmpeq_epi16(depths_v, depth_v));
+		guint mask = (guint)_mm_movemask_epi8(match_v);
+		if (mask != 0) {
+			guint32 hit = idx + (guint32)__builtin_ctz(mask) / 2;
+			return MIN(hit, idx_end);
+		}
+	}
+	return idx_end;
+}
+#endif
+
+#ifdef XB_SILO_HAVE_AVX2
+__attribute__((target("avx2"))) static guint32
+xb_silo_column_find_avx2(const guint16 *ids,
+			 const guint16 *depths,
+			 guint32 idx,
+			 guint32 idx_end,
+			 guint16 id,
+			 guint16 depth)
+{
+	__m256i id_v = _mm256_set1_epi16((gint16)id);
+	__m256i depth_v = _mm256_set1_epi16((gint16)depth);
+	for (; idx < idx_end; idx += 16) {
+		__m256i ids_v = _mm256_loadu_si256((const __m256i *)(ids + idx));
+		__m256i depths_v = _mm256_loadu_si256((const __m256i *)(depths + idx));
+		__m256i match_v = _mm256_and_si256(_mm256_cmpeq_epi16(ids_v, id_v),
+						   _mm256_cmpeq_epi16(depths_v, depth_v));
+		guint mask = (guint)_mm256_movemask_epi8(match_v);
+		if (mask != 0) {
+			guint32 hit = idx + (guint32)__builtin_ctz(mask) / 2;
+			return MIN(hit, idx_end);
+		}
+	}
+	return idx_end;
+}
+#endif
+
+/* private: returns the first index in [@idx, @idx_end) matching both @id and
+ * @depth, or @idx_end if there is none */
+guint32
+xb_silo_column_find(const guint16 *ids,
+		    const guint16 *depths,
+		    guint32 idx,
+		    guint32 idx_end,
+		    guint16 id,
+		    guint16 depth)
+{
+#ifdef XB_SILO_HAVE_AVX2
+	static gsize use_avx2 = 0;
+	if (g_once_init_enter(&use_avx2)) {
+		__builtin_cpu_init();
+		g_once_init_leave(&use_avx2, __builtin_cpu_supports("avx2") ? 1 : 2);
+	}
+	if (use_avx2 == 1)
+		return xb_silo_column_find_avx2(ids, depths, idx, idx_end, id, depth);
+#endif
+#ifdef __SSE2__
+	return xb_silo_column_find_sse2(ids, depths, idx, idx_end, id, depth);
+#else
+	return xb_silo_column_find_scalar(ids, depths, idx, idx_end, id, depth);
+#endif
+}
+
+/* returns the first index in the offsets column that is >= @off */
+static guint32
+xb_silo_column_lower_bound(const guint32 *values, guint32 n_values, guint32 value)
+{
+	guint32 lo = 0;
+	guint32 hi = n_values;
+	while (lo < hi) {
+		guint32 mid = lo + (hi - lo) / 2;
+		if (values[mid] < value)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+/* private: only used if the silo has no postings, as this has to scan every
+ * node in the subtree of @parent; returns %FALSE if the silo has no columns, in
+ * which case the caller has to walk the ->next chain */
+gboolean
+xb_silo_column_iter_init(XbSilo *self,
+			 XbSiloColumnIter *iter,
+			 XbSiloNode *parent,
+			 guint32 element_name)
+{
+	XbSiloPrivate *priv = GET_PRIVATE(self);
+	const XbSiloHeader *hdr = (const XbSiloHeader *)priv->data;
+	const XbSiloColumnsHeader *chdr;
+	const guint32 *offsets;
+	const guint32 *tags;
+	guint32 tag_idx;
+
+	/* not supported */
+	if (priv->columns == 0)
+		return FALSE;
+	if (parent != NULL && parent->depth >= G_MAXUINT16 - 1)
+		return FALSE;
+
+	chdr = (const XbSiloColumnsHeader *)(priv->data + priv->columns);
+	offsets = (const guint32 *)(priv->data + priv->columns + chdr->data +
+				    chdr->n_padded * 2 * sizeof(guint16));
+	tags = offsets + chdr->n_padded;
+	iter->idx = 0;
+	iter->idx_end = 0;
 
-	sn = xb_silo_get_root_node(self, &error_local);
-	if (sn == NULL) {
-		/* if there are no XbSiloNodes, still build a root XbNode */
-		if (!g_error_matches(error_local, G_IO_ERROR, G_IO_ERROR_NOT_FOUND))
-			return NULL;
-		g_debug("ignoring: %s", error_local->message);
+	/* element name not in silo */
+	tag_idx = xb_silo_column_lower_bound(tags, hdr->strtab_ntags, element_name);
+	if (tag_idx >= hdr->strtab_ntags || tags[tag_idx] != element_name)
+		return TRUE;
+	iter->id = (guint16)tag_idx;
+
+	/* only the subtree of the parent needs to be searched */
+	if (parent == NULL) {
+		iter->idx_end = chdr->n_nodes;
+		iter->depth = 0;
+	} else {
+		guint32 off = xb_silo_get_offset_for_node(self, parent);
+		iter->idx = xb_silo_column_lower_bound(offsets, chdr->n_nodes, off) + 1;
+		iter->idx_end = xb_silo_column_lower_bound(offsets,
+							   chdr->n_nodes,
+							   xb_silo_node_get_end(parent));
+		iter->depth = parent->depth + 1;
+		if (iter->idx > iter->idx_end)
+			iter->idx = iter->idx_end;
 	}
-	return xb_silo_create_node(self, sn, FALSE);
+	return TRUE;
 }
 
-/* private */
+/* private: returns the offset of the next matching node, or 0 when done */
 guint32
-xb_silo_get_strtab_idx(XbSilo *self, const gchar *element)
+xb_silo_column_iter_next(XbSilo *self, XbSiloColumnIter *iter)
 {
 	XbSiloPrivate *priv = GET_PRIVATE(self);
-	gpointer value = NULL;
-	if (!g_hash_table_lookup_extended(priv->strtab_tags, element, NULL, &value))
-		return XB_SILO_UNSET;
-	return GPOINTER_TO_UINT(value);
+	const XbSiloColumnsHeader *chdr =
+	    (const XbSiloColumnsHeader *)(priv->data + priv->columns);
+	const guint16 *ids = (const guint16 *)(priv->data + priv->columns + chdr->data);
+	const guint16 *depths = ids + chdr->n_padded;
+	const guint32 *offsets = (const guint32 *)(depths + chdr->n_padded);
+
+	iter->idx = xb_silo_column_find(ids, depths, iter->idx, iter->idx_end, iter->id, iter->depth);
+	if (iter->idx >= iter->idx_end)
+		return 0;
+	return offsets[iter->idx++];
 }
 
 /**
@@ -401,9 +1494,15 @@ xb_silo_to_string(XbSilo *self, GError **error)
 
 	g_string_append_printf(str, "magic:        %08x\n", (guint)hdr->magic);
 	g_string_append_printf(str, "guid:         %s\n", priv->guid);
+	g_string_append_printf(str, "flags:        0x%x\n", (guint)hdr->flags);
 	g_string_append_printf(str, "filesz:       @%" G_GUINT64_FORMAT "\n", hdr->filesz);
 	g_string_append_printf(str, "strtab:       @%" G_GUINT32_FORMAT "\n", hdr->strtab);
 	g_string_append_printf(str, "strtab_ntags: %" G_GUINT16_FORMAT "\n", hdr->strtab_ntags);
+	g_string_append_printf(str, "postings:     @%" G_GUINT32_FORMAT "\n", hdr->postings);
+	g_string_append_printf(str, "strindex:     @%" G_GUINT32_FORMAT "\n", hdr->strindex);
+	g_string_append_printf(str, "tagtab:       @%" G_GUINT32_FORMAT "\n", hdr->tagtab);
+	g_string_append_printf(str, "columns:      @%" G_GUINT32_FORMAT "\n", hdr->columns);
+	g_string_append_printf(str, "checksum:     0x%" G_GINT64_MODIFIER "x\n", hdr->checksum);
 	while (off < priv->strtab) {
 		XbSiloNode *n = xb_silo_get_node(self, off, error);
 		if (n == NULL)
@@ -431,6 +1530,12 @@ xb_silo_to_string(XbSilo *self, GError **error)
 			g_string_append_printf(str,
 					       "parent:       %" G_GUINT32_FORMAT "\n",
 					       n->parent);
+			g_string_append_printf(str,
+					       "end:          %" G_GUINT32_FORMAT "\n",
+					       n->end);
+			g_string_append_printf(str,
+					       "depth:        %" G_GUINT16_FORMAT "\n",
+					       n->depth);
 			idx = xb_silo_node_get_text_idx(n);
 			if (idx != XB_SILO_UNSET) {
 				const gchar *text = xb_silo_from_strtab(self, idx, error);
@@ -483,7 +1588,7 @@ xb_silo_to_string(XbSilo *self, GError **error)
 
 	/* add strtab */
 	g_string_append_printf(str, "STRTAB @%" G_GUINT32_FORMAT "\n", hdr->strtab);
-	for (off = 0; off < priv->datasz - hdr->strtab;) {
+	for (off = 0; off < priv->strtabsz;) {
 		const gchar *tmp = xb_silo_from_strtab(self, off, NULL);
 		if (tmp == NULL)
 			break;
@@ -675,6 +1780,10 @@ xb_silo_get_node_depth(XbSilo *self, XbSiloNode *n)
 {
 	guint depth = 0;
 	guint32 last_off = xb_silo_get_offset_for_node(self, n);
+
+	/* stored by the builder unless very deep */
+	if (n->depth != G_MAXUINT16)
+		return n->depth;
 	while (n->parent != 0) {
 		if (n->parent >= last_off)
 			break;
@@ -687,12 +1796,109 @@ xb_silo_get_node_depth(XbSilo *self, XbSiloNode *n)
 	return depth;
 }
 
+/* shares everything decoded by the last load, so nothing is decoded twice */
+static XbSilo *
+xb_silo_new_snapshot(XbSilo *self)
+{
+	GHashTableIter iter;
+	gpointer key = NULL;
+	gpointer value = NULL;
+	XbSiloPrivate *priv = GET_PRIVATE(self);
+	XbSilo *snapshot = xb_silo_new();
+	XbSiloPrivate *priv_snapshot = GET_PRIVATE(snapshot);
+
+	priv_snapshot->is_snapshot = TRUE;
+	priv_snapshot->enable_node_cache = priv->enable_node_cache;
+	priv_snapshot->profile_flags = priv->profile_flags;
+	priv_snapshot->guid = g_strdup(priv->guid);
+	priv_snapshot->verified = priv->verified;
+	priv_snapshot->blob = g_bytes_ref(priv->blob);
+	if (priv->blob_decoded != NULL)
+		priv_snapshot->blob_decoded = g_bytes_ref(priv->blob_decoded);
+	if (priv->blocks != NULL)
+		priv_snapshot->blocks = xb_silo_blocks_ref(priv->blocks);
+	if (priv->strtab_fc != NULL)
+		priv_snapshot->strtab_fc = xb_silo_strtab_fc_ref(priv->strtab_fc);
+	priv_snapshot->data = priv->data;
+	priv_snapshot->datasz = priv->datasz;
+	priv_snapshot->strtab = priv->strtab;
+	priv_snapshot->strtabsz = priv->strtabsz;
+	priv_snapshot->strtab_fc_sz = priv->strtab_fc_sz;
+	priv_snapshot->postings = priv->postings;
+	priv_snapshot->strindex_off = priv->strindex_off;
+	priv_snapshot->tagtab = priv->tagtab;
+	priv_snapshot->columns = priv->columns;
+	g_hash_table_iter_init(&iter, priv->strtab_tags);
+	while (g_hash_table_iter_next(&iter, &key, &value))
+		g_hash_table_insert(priv_snapshot->strtab_tags, key, value);
+
+	/* nothing can be listening yet */
+	priv_snapshot->valid = TRUE;
+	return snapshot;
+}
+
+/**
+ * xb_silo_get_snapshot:
+ * @self: a #XbSilo
+ * @error: the #GError, or %NULL
+ *
+ * Gets an immutable copy of the silo as it was last successfully loaded.
+ *
+ * The snapshot shares the blob and any decoded or decompressed data with
+ * @self, but is never invalidated or reloaded, so it can be queried from
+ * another thread while @self is being reloaded, e.g. when the file used with
+ * %XB_SILO_LOAD_FLAG_WATCH_BLOB changes. Each successful load publishes a new
+ * snapshot, and the old blob is freed when the last reference to the old
+ * snapshot is dropped.
+ *
+ * The methods, operators and text handlers registered on the #XbMachine of
+ * @self are copied when the snapshot is first returned.
+ *
+ * Returns: (transfer full): a #XbSilo, or %NULL if never loaded
+ *
+ * Since: 0.3.30
+ **/
+XbSilo *
+xb_silo_get_snapshot(XbSilo *self, GError **error)
+{
+	XbSiloPrivate *priv = GET_PRIVATE(self);
+	g_autoptr(GMutexLocker) locker = NULL;
+
+	g_return_val_if_fail(XB_IS_SILO(self), NULL);
+	g_return_val_if_fail(error == NULL || *error == NULL, NULL);
+
+	/* already immutable */
+	if (priv->is_snapshot)
+		return g_object_ref(self);
+
+	locker = g_mutex_locker_new(&priv->snapshot_mutex);
+	if (priv->snapshot == NULL) {
+		g_set_error_literal(error,
+				    G_IO_ERROR,
+				    G_IO_ERROR_NOT_INITIALIZED,
+				    "no silo has been loaded");
+		return NULL;
+	}
+
+	/* methods are usually added after the silo has been loaded */
+	if (!priv->snapshot_bound) {
+		XbSiloPrivate *priv_snapshot = GET_PRIVATE(priv->snapshot);
+		xb_machine_copy(priv_snapshot->machine, priv->machine, self, priv->snapshot);
+		priv->snapshot_bound = TRUE;
+	}
+	return g_object_ref(priv->snapshot);
+}
+
 /**
  * xb_silo_get_bytes:
  * @self: a #XbSilo
  *
  * Gets the backing object that created the blob.
  *
+ * If the silo was loaded from a block-compressed file then this is the
+ * compressed container, which has to be loaded using
+ * %XB_SILO_LOAD_FLAG_COMPRESSED.
+ *
  * You should never *ever* modify this data.
  *
  * Returns: (transfer full): A #GBytes, or %NULL if never set
@@ -735,6 +1941,106 @@ xb_silo_get_machine(XbSilo *self)
 	return priv->machine;
 }
 
+/* expands a compact nodetab back to fixed-size nodes at the same offsets; this
+ * is done for the whole nodetab as every node is found by its decoded offset */
+static GBytes *
+xb_silo_nodetab_decode(const guint8 *data, gsize sz, GError **error)
+{
+	const XbSiloHeader *hdr = (const XbSiloHeader *)data;
+	gsize off = sizeof(XbSiloHeader);
+	gsize buf_off = sizeof(XbSiloHeader);
+	g_autoptr(GByteArray) buf = g_byte_array_new();
+	XbSiloHeader *hdrptr;
+
+	/* a node never grows more than four times when decoded */
+	if (hdr->strtab < sizeof(XbSiloHeader) || hdr->strtab / 4 > sz) {
+		g_set_error_literal(error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA, "strtab incorrect");
+		return NULL;
+	}
+	g_byte_array_set_size(buf, hdr->strtab);
+	memcpy(buf->data, data, sizeof(XbSiloHeader));
+	while (buf_off < hdr->strtab) {
+		XbSiloNode sn = {0x0};
+		guint32 tmp = 0;
+		guint32 nodesz;
+
+		/* the flags and attr_count are copied as-is */
+		if (off >= sz) {
+			g_set_error_literal(error,
+					    G_IO_ERROR,
+					    G_IO_ERROR_INVALID_DATA,
+					    "compact nodetab truncated");
+			return NULL;
+		}
+		memcpy(&sn, data + off++, sizeof(guint8));
+		if (!xb_silo_node_has_flag(&sn, XB_SILO_NODE_FLAG_IS_ELEMENT)) {
+			buf->data[buf_off++] = data[off - 1];
+			continue;
+		}
+		if (off >= sz) {
+			g_set_error_literal(error,
+					    G_IO_ERROR,
+					    G_IO_ERROR_INVALID_DATA,
+					    "compact nodetab truncated");
+			return NULL;
+		}
+		sn.token_count = data[off++];
+		nodesz = xb_silo_node_get_size(&sn);
+		if (hdr->strtab - buf_off < nodesz) {
+			g_set_error_literal(error,
+					    G_IO_ERROR,
+					    G_IO_ERROR_INVALID_DATA,
+					    "compact nodetab overflows strtab");
+			return NULL;
+		}
+		if (!xb_silo_varint_read(data, sz, &off, &tmp, error))
+			return NULL;
+		sn.element_name = tmp - 1;
+		if (!xb_silo_varint_read(data, sz, &off, &tmp, error))
+			return NULL;
+		if (tmp > buf_off) {
+			g_set_error_literal(error,
+					    G_IO_ERROR,
+					    G_IO_ERROR_INVALID_DATA,
+					    "compact nodetab parent invalid");
+			return NULL;
+		}
+		sn.parent = tmp != 0 ? buf_off - tmp : 0;
+		if (!xb_silo_varint_read(data, sz, &off, &tmp, error))
+			return NULL;
+		sn.next = tmp != 0 ? buf_off + tmp : 0;
+		if (!xb_silo_varint_read(data, sz, &off, &tmp, error))
+			return NULL;
+		sn.text = tmp - 1;
+		if (!xb_silo_varint_read(data, sz, &off, &tmp, error))
+			return NULL;
+		sn.tail = tmp - 1;
+		if (!xb_silo_varint_read(data, sz, &off, &tmp, error))
+			return NULL;
+		sn.end = buf_off + tmp;
+		if (!xb_silo_varint_read(data, sz, &off, &tmp, error))
+			return NULL;
+		sn.depth = MIN(tmp, G_MAXUINT16);
+		memcpy(buf->data + buf_off, &sn, sizeof(sn));
+		buf_off += sizeof(sn);
+
+		/* attrs and then tokens are all from the strtab */
+		for (guint i = 0; i < nodesz - sizeof(sn); i += sizeof(guint32)) {
+			if (!xb_silo_varint_read(data, sz, &off, &tmp, error))
+				return NULL;
+			tmp -= 1;
+			memcpy(buf->data + buf_off, &tmp, sizeof(tmp));
+			buf_off += sizeof(tmp);
+		}
+	}
+
+	/* the strtab and every other section are unchanged */
+	g_byte_array_append(buf, data + off, sz - off);
+	hdrptr = (XbSiloHeader *)buf->data;
+	hdrptr->filesz = buf->len;
+	return g_byte_array_free_to_bytes(g_steal_pointer(&buf));
+}
+
 /**
  * xb_silo_load_from_bytes:
  * @self: a #XbSilo
@@ -763,6 +2069,15 @@ xb_silo_load_from_bytes(XbSilo *self, GBytes *blob, XbSiloLoadFlags flags, GErro
 	g_return_val_if_fail(blob != NULL, FALSE);
 	g_return_val_if_fail(error == NULL || *error == NULL, FALSE);
 
+	/* snapshots are immutable */
+	if (priv->is_snapshot) {
+		g_set_error_literal(error,
+				    G_IO_ERROR,
+				    G_IO_ERROR_NOT_SUPPORTED,
+				    "cannot load into a snapshot");
+		return FALSE;
+	}
+
 	/* no longer valid */
 	xb_silo_invalidate(self);
 	if (priv->enable_node_cache) {
@@ -777,6 +2092,8 @@ xb_silo_load_from_bytes(XbSilo *self, GBytes *blob, XbSiloLoadFlags flags, GErro
 	g_hash_table_remove_all(priv->strindex);
 	g_rw_lock_writer_unlock(&priv->strindex_mutex);
 
+	g_clear_pointer(&priv->strtab_fc, xb_silo_strtab_fc_unref);
+
 	g_clear_pointer(&priv->guid, g_free);
 
 	g_rw_lock_writer_lock(&priv->query_cache_mutex);
@@ -787,9 +2104,30 @@ xb_silo_load_from_bytes(XbSilo *self, GBytes *blob, XbSiloLoadFlags flags, GErro
 	if (priv->blob != NULL)
 		g_bytes_unref(priv->blob);
 	priv->blob = g_bytes_ref(blob);
+	g_clear_pointer(&priv->blob_decoded, g_bytes_unref);
+	g_clear_pointer(&priv->blocks, xb_silo_blocks_unref);
 
 	/* update pointers into blob */
 	priv->data = g_bytes_get_data(priv->blob, &sz);
+	priv->strtabsz = 0;
+	priv->strtab_fc_sz = 0;
+	priv->verified = FALSE;
+	priv->postings = 0;
+	priv->strindex_off = 0;
+	priv->tagtab = 0;
+	priv->columns = 0;
+
+	/* only the header is decompressed up front */
+	if ((flags & XB_SILO_LOAD_FLAG_COMPRESSED) > 0 && sz >= sizeof(XbSiloBlocksHeader) &&
+	    ((const XbSiloBlocksHeader *)priv->data)->magic == XB_SILO_BLOCKS_MAGIC) {
+		priv->blocks = xb_silo_blocks_new(priv->data, sz, error);
+		if (priv->blocks == NULL)
+			return FALSE;
+		priv->data = priv->blocks->data;
+		sz = priv->blocks->datasz;
+		if (!xb_silo_blocks_ensure(priv->blocks, 0, sizeof(XbSiloHeader), error))
+			return FALSE;
+	}
 
 	/* check size  */
 	if (sz < sizeof(XbSiloHeader)) {
@@ -830,6 +2168,46 @@ xb_silo_load_from_bytes(XbSilo *self, GBytes *blob, XbSiloLoadFlags flags, GErro
 		return FALSE;
 	}
 
+	/* check the entire file is as it was written */
+	if (flags & XB_SILO_LOAD_FLAG_VERIFY) {
+		guint64 checksum;
+		if (priv->blocks != NULL && !xb_silo_blocks_ensure(priv->blocks, 0, sz, error))
+			return FALSE;
+		checksum = xb_silo_compute_checksum(priv->data, sz);
+		if (checksum != hdr->checksum) {
+			g_set_error(error,
+				    G_IO_ERROR,
+				    G_IO_ERROR_INVALID_DATA,
+				    "checksum incorrect, got 0x%" G_GINT64_MODIFIER
+				    "x, expected 0x%" G_GINT64_MODIFIER "x",
+				    checksum,
+				    hdr->checksum);
+			return FALSE;
+		}
+		xb_silo_add_profile(self, timer, "verify checksum");
+	}
+
+	/* expand the nodetab, keeping the original blob for saving */
+	if (hdr->flags & XB_SILO_HEADER_FLAG_COMPACT_NODETAB) {
+		if (priv->blocks != NULL && !xb_silo_blocks_ensure(priv->blocks, 0, sz, error))
+			return FALSE;
+		priv->blob_decoded = xb_silo_nodetab_decode(priv->data, sz, error);
+		if (priv->blob_decoded == NULL)
+			return FALSE;
+		g_clear_pointer(&priv->blocks, xb_silo_blocks_unref);
+		priv->data = g_bytes_get_data(priv->blob_decoded, &sz);
+		if (sz > G_MAXINT32) {
+			g_set_error_literal(error,
+					    G_IO_ERROR,
+					    G_IO_ERROR_INVALID_DATA,
+					    "blob too large");
+			return FALSE;
+		}
+		priv->datasz = (guint32)sz;
+		hdr = (XbSiloHeader *)priv->data;
+		xb_silo_add_profile(self, timer, "decode nodetab");
+	}
+
 	/* get GUID */
 	memcpy(&guid_tmp, &hdr->guid, sizeof(guid_tmp));
 	priv->guid = xb_guid_to_string(&guid_tmp);
@@ -840,7 +2218,184 @@ xb_silo_load_from_bytes(XbSilo *self, GBytes *blob, XbSiloLoadFlags flags, GErro
 		g_set_error_literal(error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA, "strtab incorrect");
 		return FALSE;
 	}
-	if (hdr->strtab_ntags > 0 && priv->data[sz - 1] != '\0') {
+	priv->strtabsz = priv->datasz - priv->strtab;
+
+	/* the optional sections are read directly, so cannot be lazy */
+	if (priv->blocks != NULL) {
+		guint32 sections = priv->datasz;
+		if (hdr->postings != 0)
+			sections = MIN(sections, hdr->postings);
+		if (hdr->strindex != 0)
+			sections = MIN(sections, hdr->strindex);
+		if (hdr->tagtab != 0)
+			sections = MIN(sections, hdr->tagtab);
+		if (hdr->columns != 0)
+			sections = MIN(sections, hdr->columns);
+
+		/* ...and the trailing NUL of the strtab */
+		if (sections > 0)
+			sections--;
+		if (!xb_silo_blocks_ensure(priv->blocks,
+					   sections,
+					   priv->datasz - sections,
+					   error))
+			return FALSE;
+	}
+
+	/* check optional sections, each of which runs until the next */
+	if (hdr->columns != 0) {
+		const XbSiloColumnsHeader *chdr;
+		guint64 columnsz;
+		if (hdr->columns < priv->strtab || hdr->columns > priv->datasz ||
+		    priv->datasz - hdr->columns < sizeof(XbSiloColumnsHeader)) {
+			g_set_error_literal(error,
+					    G_IO_ERROR,
+					    G_IO_ERROR_INVALID_DATA,
+					    "columns incorrect");
+			return FALSE;
+		}
+		chdr = (const XbSiloColumnsHeader *)(priv->data + hdr->columns);
+		columnsz = (guint64)chdr->data;
+		columnsz += (guint64)chdr->n_padded * (2 * sizeof(guint16) + sizeof(guint32));
+		columnsz += (guint64)hdr->strtab_ntags * sizeof(guint32);
+		if (chdr->data < sizeof(XbSiloColumnsHeader) ||
+		    chdr->n_padded % XB_SILO_COLUMN_PAD != 0 ||
+		    chdr->n_padded < (guint64)chdr->n_nodes + XB_SILO_COLUMN_PAD ||
+		    columnsz != priv->datasz - hdr->columns) {
+			g_set_error_literal(error,
+					    G_IO_ERROR,
+					    G_IO_ERROR_INVALID_DATA,
+					    "columns size incorrect");
+			return FALSE;
+		}
+		priv->strtabsz = hdr->columns - priv->strtab;
+
+		/* only use the columns if the blob is suitably aligned */
+		if (((guintptr)(priv->data + hdr->columns + chdr->data)) % sizeof(guint32) == 0)
+			priv->columns = hdr->columns;
+	}
+	if (hdr->tagtab != 0) {
+		const XbSiloTagtabHeader *thdr;
+		guint64 tagtabsz = sizeof(XbSiloTagtabHeader);
+		guint32 tagtab_end = priv->strtab + priv->strtabsz;
+		if (hdr->tagtab < priv->strtab || hdr->tagtab > tagtab_end ||
+		    tagtab_end - hdr->tagtab < sizeof(XbSiloTagtabHeader)) {
+			g_set_error_literal(error,
+					    G_IO_ERROR,
+					    G_IO_ERROR_INVALID_DATA,
+					    "tagtab incorrect");
+			return FALSE;
+		}
+		thdr = (const XbSiloTagtabHeader *)(priv->data + hdr->tagtab);
+		tagtabsz += (guint64)thdr->n_tags * (sizeof(gint32) + sizeof(guint32));
+		if (thdr->n_tags == 0 || thdr->n_tags != hdr->strtab_ntags ||
+		    tagtabsz != tagtab_end - hdr->tagtab) {
+			g_set_error_literal(error,
+					    G_IO_ERROR,
+					    G_IO_ERROR_INVALID_DATA,
+					    "tagtab size incorrect");
+			return FALSE;
+		}
+		priv->strtabsz = hdr->tagtab - priv->strtab;
+		priv->tagtab = hdr->tagtab;
+	}
+	if (hdr->strindex != 0) {
+		const XbSiloStrindexHeader *ihdr;
+		guint64 strindexsz = sizeof(XbSiloStrindexHeader);
+		guint32 strindex_end = priv->strtab + priv->strtabsz;
+		if (hdr->strindex < priv->strtab || hdr->strindex > strindex_end ||
+		    strindex_end - hdr->strindex < sizeof(XbSiloStrindexHeader)) {
+			g_set_error_literal(error,
+					    G_IO_ERROR,
+					    G_IO_ERROR_INVALID_DATA,
+					    "strindex incorrect");
+			return FALSE;
+		}
+		ihdr = (const XbSiloStrindexHeader *)(priv->data + hdr->strindex);
+		strindexsz += (guint64)ihdr->n_buckets * sizeof(guint32);
+		if (ihdr->n_buckets == 0 || (ihdr->n_buckets & (ihdr->n_buckets - 1)) != 0 ||
+		    strindexsz != strindex_end - hdr->strindex) {
+			g_set_error_literal(error,
+					    G_IO_ERROR,
+					    G_IO_ERROR_INVALID_DATA,
+					    "strindex size incorrect");
+			return FALSE;
+		}
+		priv->strtabsz = hdr->strindex - priv->strtab;
+		priv->strindex_off = hdr->strindex;
+	}
+	if (hdr->postings != 0) {
+		const XbSiloPostingsHeader *phdr;
+		guint64 postingsz = sizeof(XbSiloPostingsHeader);
+		guint32 postings_end = priv->strtab + priv->strtabsz;
+		if (hdr->postings < priv->strtab || hdr->postings > postings_end ||
+		    postings_end - hdr->postings < sizeof(XbSiloPostingsHeader)) {
+			g_set_error_literal(error,
+					    G_IO_ERROR,
+					    G_IO_ERROR_INVALID_DATA,
+					    "postings incorrect");
+			return FALSE;
+		}
+		phdr = (const XbSiloPostingsHeader *)(priv->data + hdr->postings);
+		postingsz += (guint64)phdr->n_entries * sizeof(XbSiloPostingEntry);
+		postingsz += (guint64)phdr->n_groups * sizeof(XbSiloPostingGroup);
+		postingsz += (guint64)phdr->n_nodes * sizeof(guint32);
+		if (postingsz != postings_end - hdr->postings) {
+			g_set_error_literal(error,
+					    G_IO_ERROR,
+					    G_IO_ERROR_INVALID_DATA,
+					    "postings size incorrect");
+			return FALSE;
+		}
+		priv->strtabsz = hdr->postings - priv->strtab;
+		priv->postings = hdr->postings;
+	}
+	if (hdr->flags & XB_SILO_HEADER_FLAG_FRONT_CODED_STRTAB) {
+		const XbSiloStrtabFcHeader *fchdr;
+		const XbSiloStrtabFcRestart *restarts;
+		guint64 restartsz;
+		if (priv->strtabsz < sizeof(XbSiloStrtabFcHeader)) {
+			g_set_error_literal(error,
+					    G_IO_ERROR,
+					    G_IO_ERROR_INVALID_DATA,
+					    "front-coded strtab incorrect");
+			return FALSE;
+		}
+		fchdr = (const XbSiloStrtabFcHeader *)(priv->data + priv->strtab);
+		restarts = (const XbSiloStrtabFcRestart *)(priv->data + priv->strtab +
+							    sizeof(XbSiloStrtabFcHeader));
+		restartsz = sizeof(XbSiloStrtabFcHeader) +
+			    (guint64)fchdr->n_restarts * sizeof(XbSiloStrtabFcRestart);
+		if (restartsz > priv->strtabsz || (fchdr->size > 0 && fchdr->n_restarts == 0)) {
+			g_set_error_literal(error,
+					    G_IO_ERROR,
+					    G_IO_ERROR_INVALID_DATA,
+					    "front-coded strtab restarts incorrect");
+			return FALSE;
+		}
+		for (guint32 i = 0; i < fchdr->n_restarts; i++) {
+			if ((i == 0 && restarts[i].offset != 0) ||
+			    (i > 0 && restarts[i].offset <= restarts[i - 1].offset) ||
+			    restarts[i].offset >= fchdr->size ||
+			    restarts[i].data >= priv->strtabsz - restartsz) {
+				g_set_error(error,
+					    G_IO_ERROR,
+					    G_IO_ERROR_INVALID_DATA,
+					    "front-coded strtab restart %u incorrect",
+					    i);
+				return FALSE;
+			}
+		}
+		if (priv->blocks != NULL &&
+		    !xb_silo_blocks_ensure(priv->blocks, priv->strtab, priv->strtabsz, error))
+			return FALSE;
+		priv->strtab_fc_sz = priv->strtabsz;
+		priv->strtabsz = fchdr->size;
+		priv->strtab_fc = xb_silo_strtab_fc_new(fchdr->size, fchdr->n_restarts);
+	}
+	if ((hdr->strtab_ntags > 0 && priv->strtabsz == 0) ||
+	    (priv->strtab_fc_sz == 0 && priv->strtabsz > 0 &&
+	     priv->data[priv->strtab + priv->strtabsz - 1] != '\0')) {
 		g_set_error_literal(error,
 				    G_IO_ERROR,
 				    G_IO_ERROR_INVALID_DATA,
@@ -848,8 +2403,8 @@ xb_silo_load_from_bytes(XbSilo *self, GBytes *blob, XbSiloLoadFlags flags, GErro
 		return FALSE;
 	}
 
-	/* load strtab_tags */
-	for (guint16 i = 0; i < hdr->strtab_ntags; i++) {
+	/* load strtab_tags if the perfect hash is not available */
+	for (guint16 i = 0; priv->tagtab == 0 && i < hdr->strtab_ntags; i++) {
 		const gchar *tmp = xb_silo_from_strtab(self, off, error);
 		if (tmp == NULL) {
 			g_prefix_error(error, "strtab_ntags incorrect: ");
@@ -862,6 +2417,21 @@ xb_silo_load_from_bytes(XbSilo *self, GBytes *blob, XbSiloLoadFlags flags, GErro
 	/* profile */
 	xb_silo_add_profile(self, timer, "parse blob");
 
+	/* check every node */
+	if (flags & XB_SILO_LOAD_FLAG_VERIFY) {
+		if (!xb_silo_verify(self, error))
+			return FALSE;
+		priv->verified = TRUE;
+		xb_silo_add_profile(self, timer, "verify nodes");
+	}
+
+	/* publish for the next snapshot; existing snapshots keep the old blob */
+	g_mutex_lock(&priv->snapshot_mutex);
+	g_clear_object(&priv->snapshot);
+	priv->snapshot = xb_silo_new_snapshot(self);
+	priv->snapshot_bound = FALSE;
+	g_mutex_unlock(&priv->snapshot_mutex);
+
 	/* success */
 	xb_silo_uninvalidate(self);
 	return TRUE;
@@ -1117,6 +2687,15 @@ xb_silo_load_from_file(XbSilo *self,
 	g_return_val_if_fail(cancellable == NULL || G_IS_CANCELLABLE(cancellable), FALSE);
 	g_return_val_if_fail(error == NULL || *error == NULL, FALSE);
 
+	/* snapshots are immutable */
+	if (priv->is_snapshot) {
+		g_set_error_literal(error,
+				    G_IO_ERROR,
+				    G_IO_ERROR_NOT_SUPPORTED,
+				    "cannot load into a snapshot");
+		return FALSE;
+	}
+
 	/* no longer valid (@nodes is cleared by xb_silo_load_from_bytes()) */
 	g_hash_table_remove_all(priv->file_monitors);
 	g_clear_pointer(&file_monitors_locker, g_mutex_locker_free);
@@ -1153,6 +2732,10 @@ xb_silo_load_from_file(XbSilo *self,
  *
  * Saves a silo to a file.
  *
+ * If the silo was loaded from a block-compressed file then the compressed
+ * container is saved, which has to be loaded using
+ * %XB_SILO_LOAD_FLAG_COMPRESSED.
+ *
  * Returns: %TRUE for success, otherwise @error is set.
  *
  * Since: 0.1.0
@@ -1185,12 +2768,140 @@ xb_silo_save_to_file(XbSilo *self, GFile *file, GCancellable *cancellable, GErro
 			return FALSE;
 	}
 
+	/* save and then rename, keeping any compact nodetab */
+	if (!xb_file_set_contents(file,
+				  g_bytes_get_data(priv->blob, NULL),
+				  g_bytes_get_size(priv->blob),
+				  cancellable,
+				  error))
+		return FALSE;
+
+	xb_silo_add_profile(self, timer, "save file");
+	return TRUE;
+}
+
+/**
+ * xb_silo_save_to_file_compressed:
+ * @self: a #XbSilo
+ * @file: a #GFile
+ * @cancellable: a #GCancellable, or %NULL
+ * @error: the #GError, or %NULL
+ *
+ * Saves a silo to a file as independently compressed blocks, which are only
+ * decompressed when required if loaded using %XB_SILO_LOAD_FLAG_COMPRESSED.
+ *
+ * Decompressed blocks are kept until the silo is reloaded, so the memory used
+ * is not bounded and grows up to the uncompressed size as more is queried.
+ *
+ * Returns: %TRUE for success, otherwise @error is set.
+ *
+ * Since: 0.3.30
+ **/
+gboolean
+xb_silo_save_to_file_compressed(XbSilo *self,
+				GFile *file,
+				GCancellable *cancellable,
+				GError **error)
+{
+	XbSiloPrivate *priv = GET_PRIVATE(self);
+#ifdef HAVE_ZSTD
+	const guint8 *data;
+	gsize datasz;
+	gsize bufsz;
+	g_autoptr(GByteArray) buf = g_byte_array_new();
+	g_autoptr(GFile) file_parent = NULL;
+	g_autoptr(GTimer) timer = xb_silo_start_profile(self);
+	g_autofree guint8 *block = NULL;
+	ZSTD_CCtx *cctx;
+	XbSiloBlocksHeader bhdr = {
+	    .magic = XB_SILO_BLOCKS_MAGIC,
+	    .block_size = XB_SILO_BLOCK_SIZE,
+	};
+#endif
+
+	g_return_val_if_fail(XB_IS_SILO(self), FALSE);
+	g_return_val_if_fail(G_IS_FILE(file), FALSE);
+	g_return_val_if_fail(cancellable == NULL || G_IS_CANCELLABLE(cancellable), FALSE);
+	g_return_val_if_fail(error == NULL || *error == NULL, FALSE);
+
+#ifdef HAVE_ZSTD
+	/* invalid */
+	if (priv->data == NULL) {
+		g_set_error_literal(error,
+				    G_IO_ERROR,
+				    G_IO_ERROR_NOT_INITIALIZED,
+				    "no data to save");
+		return FALSE;
+	}
+
+	/* the blob as it would be saved uncompressed */
+	if (priv->blocks != NULL) {
+		if (!xb_silo_blocks_ensure(priv->blocks, 0, priv->blocks->datasz, error))
+			return FALSE;
+		data = priv->blocks->data;
+		datasz = priv->blocks->datasz;
+	} else {
+		data = g_bytes_get_data(priv->blob, &datasz);
+	}
+	bhdr.datasz = datasz;
+	bhdr.n_blocks = (datasz + XB_SILO_BLOCK_SIZE - 1) / XB_SILO_BLOCK_SIZE;
+
+	/* header and index, which is fixed up as each block is added */
+	g_byte_array_append(buf, (const guint8 *)&bhdr, sizeof(bhdr));
+	g_byte_array_set_size(buf, sizeof(bhdr) + (bhdr.n_blocks + 1) * sizeof(guint32));
+	bufsz = ZSTD_compressBound(XB_SILO_BLOCK_SIZE);
+	block = g_malloc(bufsz);
+
+	/* a checksum per block so corruption is found when decompressing */
+	cctx = ZSTD_createCCtx();
+	ZSTD_CCtx_setParameter(cctx, ZSTD_c_compressionLevel, XB_SILO_BLOCK_ZSTD_LEVEL);
+	ZSTD_CCtx_setParameter(cctx, ZSTD_c_checksumFlag, 1);
+	for (guint32 i = 0; i <= bhdr.n_blocks; i++) {
+		guint32 off = buf->len;
+		gsize rc;
+		memcpy(buf->data + sizeof(bhdr) + i * sizeof(guint32), &off, sizeof(off));
+		if (i == bhdr.n_blocks)
+			break;
+		rc = ZSTD_compress2(cctx,
+				    block,
+				    bufsz,
+				    data + (gsize)i * XB_SILO_BLOCK_SIZE,
+				    MIN(XB_SILO_BLOCK_SIZE, datasz - (gsize)i * XB_SILO_BLOCK_SIZE));
+		if (ZSTD_isError(rc)) {
+			ZSTD_freeCCtx(cctx);
+			g_set_error(error,
+				    G_IO_ERROR,
+				    G_IO_ERROR_FAILED,
+				    "failed to compress block %u: %s",
+				    i,
+				    ZSTD_getErrorName(rc));
+			return FALSE;
+		}
+		g_byte_array_append(buf, block, rc);
+	}
+	ZSTD_freeCCtx(cctx);
+	xb_silo_add_profile(self, timer, "compress blocks");
+
+	/* ensure parent directories exist */
+	file_parent = g_file_get_parent(file);
+	if (file_parent != NULL && !g_file_query_exists(file_parent, cancellable)) {
+		if (!g_file_make_directory_with_parents(file_parent, cancellable, error))
+			return FALSE;
+	}
+
 	/* save and then rename */
-	if (!xb_file_set_contents(file, priv->data, (gsize)priv->datasz, cancellable, error))
+	if (!xb_file_set_contents(file, buf->data, buf->len, cancellable, error))
 		return FALSE;
 
 	xb_silo_add_profile(self, timer, "save file");
 	return TRUE;
+#else
+	g_set_error_literal(error,
+			    G_IO_ERROR,
+			    G_IO_ERROR_NOT_SUPPORTED,
+			    "no zstd support");
+	return FALSE;
+#endif
 }
 
 /**
@@ -1777,6 +3488,7 @@ xb_silo_init(XbSilo *self)
 	g_mutex_init(&priv->nodes_mutex);
 
 	priv->context = g_main_context_ref_thread_default();
+	g_mutex_init(&priv->snapshot_mutex);
 
 #ifdef HAVE_LIBSTEMMER
 	g_mutex_init(&priv->stemmer_mutex);
@@ -1837,6 +3549,9 @@ xb_silo_finalize(GObject *obj)
 
 	g_clear_pointer(&priv->context, g_main_context_unref);
 
+	g_clear_object(&priv->snapshot);
+	g_mutex_clear(&priv->snapshot_mutex);
+
 	g_free(priv->guid);
 	g_string_free(priv->profile_str, TRUE);
 	g_hash_table_unref(priv->query_cache);
@@ -1844,6 +3559,8 @@ xb_silo_finalize(GObject *obj)
 	g_object_unref(priv->machine);
 	g_hash_table_unref(priv->strindex);
 	g_rw_lock_clear(&priv->strindex_mutex);
+	if (priv->strtab_fc != NULL)
+		xb_silo_strtab_fc_unref(priv->strtab_fc);
 	g_hash_table_unref(priv->file_monitors);
 	g_mutex_clear(&priv->file_monitors_mutex);
 	g_hash_table_unref(priv->strtab_tags);
@@ -1851,6 +3568,10 @@ xb_silo_finalize(GObject *obj)
 		g_mapped_file_unref(priv->mmap);
 	if (priv->blob != NULL)
 		g_bytes_unref(priv->blob);
+	if (priv->blob_decoded != NULL)
+		g_bytes_unref(priv->blob_decoded);
+	if (priv->blocks != NULL)
+		xb_silo_blocks_unref(priv->blocks);
 	G_OBJECT_CLASS(xb_silo_parent_class)->finalize(obj);
 }
 
@@ -34,6 +34,8 @@ struct _XbSiloClass {
  * @XB_SILO_LOAD_FLAG_NONE:			No extra flags to use
  * @XB_SILO_LOAD_FLAG_NO_MAGIC:			No not check header signature
  * @XB_SILO_LOAD_FLAG_WATCH_BLOB:		Watch the XMLB file for changes
+ * @XB_SILO_LOAD_FLAG_COMPRESSED:		Allow a block-compressed XMLB file
+ * @XB_SILO_LOAD_FLAG_VERIFY:			Verify the checksum and every node up front
  *
  * The flags for loading a silo.
  **/
@@ -41,6 +43,8 @@ typedef enum {
 	XB_SILO_LOAD_FLAG_NONE = 0,	       /* Since: 0.1.0 */
 	XB_SILO_LOAD_FLAG_NO_MAGIC = 1 << 0,   /* Since: 0.1.0 */
 	XB_SILO_LOAD_FLAG_WATCH_BLOB = 1 << 1, /* Since: 0.1.0 */
+	XB_SILO_LOAD_FLAG_COMPRESSED = 1 << 2, /* Since: 0.3.30 */
+	XB_SILO_LOAD_FLAG_VERIFY = 1 << 3,     /* Since: 0.3.30 */
 	/*< private >*/
 	XB_SILO_LOAD_FLAG_LAST
 } XbSiloLoadFlags;
@@ -71,6 +75,8 @@ XbSilo *
 xb_silo_new_from_xml(const gchar *xml, GError **error) G_GNUC_NON_NULL(1);
 GBytes *
 xb_silo_get_bytes(XbSilo *self) G_GNUC_NON_NULL(1);
+XbSilo *
+xb_silo_get_snapshot(XbSilo *self, GError **error) G_GNUC_NON_NULL(1);
 gboolean
 xb_silo_load_from_bytes(XbSilo *self, GBytes *blob, XbSiloLoadFlags flags, GError **error)
     G_GNUC_NON_NULL(1, 2);
@@ -83,6 +89,11 @@ xb_silo_load_from_file(XbSilo *self,
 gboolean
 xb_silo_save_to_file(XbSilo *self, GFile *file, GCancellable *cancellable, GError **error)
     G_GNUC_NON_NULL(1, 2);
+gboolean
+xb_silo_save_to_file_compressed(XbSilo *self,
+				GFile *file,
+				GCancellable *cancellable,
+				GError **error) G_GNUC_NON_NULL(1, 2);
 gchar *
 xb_silo_to_string(XbSilo *self, GError **error) G_GNUC_NON_NULL(1);
 guint
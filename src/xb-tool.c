@@ -373,7 +373,7 @@ xb_tool_builder_tokenize_cb(XbBuilderFixup *self,
 	XbToolPrivate *priv = (XbToolPrivate *)user_data;
 	for (guint i = 0; priv->tokenize != NULL && priv->tokenize[i] != NULL; i++) {
 		if (g_strcmp0(xb_builder_node_get_element(bn), priv->tokenize[i]) == 0) {
-			xb_builder_node_tokenize_text(bn);
+			xb_builder_node_add_flag(bn, XB_BUILDER_NODE_FLAG_TOKENIZE_TEXT);
 			break;
 		}
 	}